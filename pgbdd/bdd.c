@@ -20,6 +20,16 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <math.h>
+#include <time.h>
+#ifndef PG_CONFIG
+#include <pthread.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "utils.h"
 #include "vector.h"
@@ -31,13 +41,6 @@
  * + bdd2str may fail because of print buffer problems, should check
  */
 
-/* There may be an 'error' during probability computation due to a very tiny 
- * rounding problem where a very small negative number is returned. We have
- * to look better into the problem but for now when this occurs we set the
- * return value to 0.0. 
- */
-#define TINY_ROUNDING_FRACTION 1e-40
-
 int cmpRva(rva* l, rva* r) {  
     int res = COMPARE_VAR(l->var,r->var);
     if ( res == 0 )
@@ -47,6 +50,8 @@ int cmpRva(rva* l, rva* r) {
 
 DefVectorC(rva_node);
 
+DefVectorC(rva);
+
 DefVectorC(rva_order);
 
 int cmpRva_order(rva_order* l, rva_order* r) {  
@@ -340,50 +345,75 @@ static int add2rva_order(bdd_runtime* bctx, char* var, int var_len, char* valp,
 
 #define ADD2E_STACK(BCTX,C)   (BCTX)->e_stack[(BCTX)->e_stack_len++] = (C)
 
-static int _compute_order(bdd_runtime* bctx, char* expr, char** _errmsg) {
-    char *p = expr;
-    
-    while ( *p ) {
-        while ( *p && !isalnum(*p) ) {
-            if ( !isspace(*p) )
-                ADD2E_STACK(bctx,*p);
+/*
+ * The tokenizer of rva expressions. Whitespace is skipped, 0 and 1 are
+ * constants, var=val is an rva and every other character is an operator
+ * token, the parser using the tokens checks them.
+ */
+
+int expr_next_token(char** pp, expr_token* tok, char** _errmsg) {
+    char *p = *pp;
+
+    tok->type    = TOKEN_END;
+    tok->c       = 0;
+    tok->var     = tok->valp = NULL;
+    tok->var_len = 0;
+    while ( isspace(*p) )
+        p++;
+    if ( !*p ) {
+    } else if ( !isalnum(*p) ) {
+        tok->type = TOKEN_OP;
+        tok->c    = *p++;
+    } else if ( isdigit(*p) ) {
+        if ( ((*p=='0') || (*p=='1')) && !isalnum(p[1]) ) {
+            tok->type = TOKEN_CONST;
+            tok->c    = *p++;
+        } else 
+            return pg_error(_errmsg,"varnames cannot start with a digit: \"%s\"",p);
+    } else {
+        char* start = p;
+
+        while ( isalnum(*p) )
             p++;
-        }
-        if ( isalnum(*p) ) {
-            char* start = p;
-            //
-            if ( isdigit(*p) ) {
-                if ( (*p=='0') || (*p=='1') ) {
-                    if ( isalnum(p[1]) )
-                        return pg_error(_errmsg,"varnames cannot start with a digit: \"%s\"",p);
-                    else {
-                        ADD2E_STACK(bctx,*p);
-                        p++;
-                    }
-                } else 
-                    return pg_error(_errmsg,"varnames cannot start with a digit: \"%s\"",p);
-            } else {
-                int len;
+        tok->type    = TOKEN_RVA;
+        tok->var     = start;
+        tok->var_len = p-start;
+        while ( *p && *p != '=' )
+            p++;
+        if ( !(*p++ == '=') )
+            return pg_error(_errmsg,"missing \'=\' in expr: \"%s\"",start);
+        while ( isspace(*p) ) 
+            p++;
+        if ( !isdigit(*p) ) 
+            return pg_error(_errmsg,"missing value after \'=\' in expr: \"%s\"",start);
+        tok->valp = p;
+        while (isdigit(*p) )
+            p++;
+    }
+    *pp = p;
+    return BDD_OK;
+}
 
-                while ( isalnum(*p) )
-                    p++;
-                len = p-start;;
-                while ( *p && *p != '=' )
-                    p++;
-                if ( !(*p++ == '=') )
-                    return pg_error(_errmsg,"missing \'=\' in expr: \"%s\"",start);
-                while ( isspace(*p) ) 
-                    p++;
-                if ( !isdigit(*p) ) 
-                    return pg_error(_errmsg,"missing value after \'=\' in expr: \"%s\"",start);
-                if ( !add2rva_order(bctx,start,len,p,_errmsg) )
-                    return BDD_FAIL;
-                while (isdigit(*p) )
-                    p++;
-            }
+static int _compute_order(bdd_runtime* bctx, char* expr, char** _errmsg) {
+    char       *p = expr;
+    expr_token  tok;
+    
+    for(;;) {
+        if ( !expr_next_token(&p,&tok,_errmsg) )
+            return BDD_FAIL;
+        switch ( tok.type ) {
+         case TOKEN_END:
+            return 1;
+         case TOKEN_OP:
+         case TOKEN_CONST:
+            ADD2E_STACK(bctx,tok.c);
+            break;
+         case TOKEN_RVA:
+            if ( !add2rva_order(bctx,tok.var,tok.var_len,tok.valp,_errmsg) )
+                return BDD_FAIL;
+            break;
         }
     }
-    return 1;
 }
 
 static int compute_rva_order(bdd_runtime* bctx, char* bdd_expr, char** _errmsg) {
@@ -465,6 +495,12 @@ static nodei bdd_mk(bdd_runtime* bdd_rt, rva *v, nodei l, nodei h, char** _errms
     }
     bdd_rt->mk_calls++;
 #endif
+    while ( h >= 2 ) {
+        rva_node* h_node = BDD_NODE(&bdd_rt->core,h);
+        if ( !IS_SAMEVAR(v,&h_node->rva) || (v->val == h_node->rva.val) )
+            break;
+        h = h_node->low; // v is TRUE so all other values of var are FALSE
+    }
     if ( l == h )
         return h;
     node = lookup_bdd_node(bdd_rt,v,l,h);
@@ -614,27 +650,6 @@ static int _bdd_equiv(int l_depth, bdd_runtime* l_ctx, int r_depth, bdd_runtime*
     return 1;
 }
  
-// #define USE_FAST_EQUIV
-
-#ifdef USE_FAST_EQUIV
-
-int bdd_test_equivalence(char* l_expr, char* r_expr, char** _errmsg) {
-    bdd *l_bdd;
-    bdd *r_bdd;
-
-    if ( !(l_bdd = create_bdd(BDD_DEFAULT,l_expr,_errmsg,0)) )
-        return 0;
-    if ( !(r_bdd = create_bdd(BDD_DEFAULT,r_expr,_errmsg,0)) )
-        return 0;
-    int eqv = bdd_fast_quivalence(l_bdd, r_bdd, _errmsg);
-    FREE(l_bdd);
-    FREE(r_bdd);
-    //
-    return eqv;
-}
-
-#else
-
 /*
  * This function checks if two expressions result in two equivalent BDD trees.
  * That is two graphs which, with all '0 and 1' permutations of their rva's
@@ -657,260 +672,6 @@ int bdd_test_equivalence(char* l_expr, char* r_expr, char** _errmsg) {
     return res;
 }
 
-#endif
-
-/*
- *
- * FAST equivalent experiment
- *
- *
- */
-
-// #define EQV_DEBUG
-// #define EQV_ASSERT
-
-#define EQV_COLUMNS     6
-
-#define EQV_COL_FALSE   0
-#define EQV_COL_TRUE    1
-#define EQV_COL_VAR_I   2
-#define EQV_COL_VAR_V   3
-#define EQV_COL_PERM_V  4
-#define EQV_COL_PERM_NV 5
-
-#define EQV_EMPTY        -1
-#define EQV_LEAF_FALSE   -8
-#define EQV_LEAF_TRUE    -9
-
-typedef short (*EQV_TREE)[EQV_COLUMNS];
-
-DefVectorH(rva);
-DefVectorC(rva);
-
-#ifdef EQV_DEBUG
-
-static void _print_rva_vector(V_rva* rva_vector) {
-    fprintf(stdout,"  * rva Vector:\n");
-    fprintf(stdout,"  -------------\n");
-    for (int i=0; i<V_rva_size(rva_vector); i++) {
-        rva* v_rva = V_rva_getp(rva_vector, i);
-        fprintf(stdout, "  [%d] <%s=%d>\n", i, v_rva->var, v_rva->val);
-    }
-    fprintf(stdout,"\n");
-}
-
-#endif
-
-static int handle_new_rva(int eqv_tree_i, rva* new_rva, EQV_TREE eqv_tree, V_rva* rva_vector, int* p_n_var) {
-    int i = 0;
-    int vsz = V_rva_size(rva_vector);
-    
-    rva* last_rva = NULL;
-
-    int var_count = 0;
-
-#ifdef EQV_DEBUG
-    fprintf(stdout,"* handle_new_rva: <%s=%d>\n",new_rva->var, new_rva->val);
-#endif
-    while ( i < vsz ) {
-        rva* v_rva = V_rva_getp(rva_vector, i);
-
-        if ( IS_SAMEVAR(v_rva, new_rva) )
-            break;
-        else if ( !(last_rva && IS_SAMEVAR(v_rva, last_rva) ) ) 
-                var_count++;
-        last_rva = v_rva;
-        i++;
-    }
-    //
-    if ( i < vsz ) {
-        // found var
-        int val_count = 0;
-
-        while ( i < vsz ) {
-            rva* v_rva = V_rva_getp(rva_vector, i);
-
-            val_count++;
-            if ( ! IS_SAMEVAR(v_rva, new_rva) )
-                break;
-            else if (cmpRva(v_rva, new_rva) == 0) {
-                    eqv_tree[eqv_tree_i][EQV_COL_VAR_I] = var_count;
-                    eqv_tree[eqv_tree_i][EQV_COL_VAR_V] = val_count;
-#ifdef EQV_DEBUG
-                    fprintf(stdout,"  + MATCH var-val -> var_i=%d, var_pv=%d\n", var_count, val_count);
-                    _print_rva_vector(rva_vector);
-#endif
-                    return BDD_OK;
-            }
-            i++;
-        }
-        if ( V_rva_insert_at(rva_vector, i, new_rva) < 0 )
-            return -1;
-        //
-        val_count = eqv_tree[var_count][EQV_COL_PERM_NV] + 1;
-#ifdef EQV_ASSERT
-        if ( eqv_tree[var_count][EQV_COL_PERM_NV] != (val_count-1) ) {
-            pg_fatal("ASSERT 1");
-        }
-#endif
-        eqv_tree[var_count][EQV_COL_PERM_NV] = val_count;
-        eqv_tree[eqv_tree_i][EQV_COL_VAR_I] = var_count;
-        eqv_tree[eqv_tree_i][EQV_COL_VAR_V] = val_count;
-#ifdef EQV_DEBUG
-        fprintf(stdout,"  + inserted var/new_val -> vector_i=%d, var_i=%d, var_pv=%d\n", i-1, var_count, val_count);
-        _print_rva_vector(rva_vector);
-#endif
-        return BDD_OK;
-    } else {
-        // not found var
-#ifdef EQV_ASSERT
-        if ( *p_n_var != var_count )
-            pg_fatal("ASSERT 2");
-#endif
-        var_count = *p_n_var; // assert ???
-        *p_n_var = var_count + 1;
-
-        if ( V_rva_add(rva_vector, new_rva) < 0)
-            return -1;
-#ifdef EQV_DEBUG
-        fprintf(stdout,"  + appended new var -> var_i=%d, var_pv=%d\n", var_count, 1);
-#endif
-        //
-        eqv_tree[var_count][EQV_COL_PERM_V]  = EQV_EMPTY;
-        eqv_tree[var_count][EQV_COL_PERM_NV] = 1;
-        //
-        eqv_tree[eqv_tree_i][EQV_COL_VAR_I] = var_count;
-        eqv_tree[eqv_tree_i][EQV_COL_VAR_V] = 1;
-        //
-#ifdef EQV_DEBUG
-        _print_rva_vector(rva_vector);
-#endif
-    }
-    return BDD_OK;
-}
-
-static int bdd_eqv_gen(bdd* bdd, int offset, EQV_TREE eqv_tree, V_rva* rva_vector, int* p_n_var) {
-    int tree_sz = BDD_TREESIZE(bdd);
-    for(int i=0; i<tree_sz; i++) {
-        rva_node* bdd_node = BDD_NODE(bdd, i);
-
-        if ( bdd_node->rva.val < 0 ) {
-            eqv_tree[offset+i][EQV_COL_FALSE] = EQV_EMPTY;
-            eqv_tree[offset+i][EQV_COL_TRUE]  = EQV_EMPTY;
-            eqv_tree[offset+i][EQV_COL_VAR_I]  = EQV_EMPTY;
-            if (LEAF_BOOLVALUE(bdd_node))
-                eqv_tree[offset+i][EQV_COL_VAR_I]  = EQV_LEAF_TRUE;
-            else
-                eqv_tree[offset+i][EQV_COL_VAR_I]  = EQV_LEAF_FALSE;
-        } else {
-            if ( handle_new_rva(offset+i, &bdd_node->rva, eqv_tree, rva_vector, p_n_var) < 0)
-                return -1;
-            eqv_tree[offset+i][EQV_COL_FALSE] = bdd_node->low+offset;
-            eqv_tree[offset+i][EQV_COL_TRUE]  = bdd_node->high+offset;
-        }
-    }
-    return BDD_OK;
-}
-
-static int bdd_eqv_run_one_permutation(EQV_TREE eqv_tree, int tree_i) {
-    int res;
-
-    while( eqv_tree[tree_i][EQV_COL_VAR_I] >= 0 ) {
-        int state = eqv_tree[tree_i][EQV_COL_VAR_V] == eqv_tree[eqv_tree[tree_i][EQV_COL_VAR_I]][EQV_COL_PERM_V];
-#ifdef EQV_DEBUG
-        fprintf(stdout,"    @ [%d] F[%d] T[%d] V[%d] VV[%D]\n",
-                       tree_i,
-                       eqv_tree[tree_i][EQV_COL_FALSE],
-                       eqv_tree[tree_i][EQV_COL_TRUE],
-                       eqv_tree[tree_i][EQV_COL_VAR_I],
-                       eqv_tree[tree_i][EQV_COL_VAR_V]);
-        fprintf(stdout,"    > state = %d\n",state);
-#endif
-        tree_i = state ? eqv_tree[tree_i][EQV_COL_TRUE] :
-                         eqv_tree[tree_i][EQV_COL_FALSE];
-    }
-    res = eqv_tree[tree_i][EQV_COL_VAR_I] == EQV_LEAF_TRUE;
-#ifdef EQV_DEBUG
-    fprintf(stdout,"    = res %d\n",res);
-#endif
-    return res;
-}
-
-static int bdd_eqv_run_permutations(EQV_TREE eqv_tree, int level, int max, int l_root, int r_root) {
-    if (level == max) {
-#ifdef EQV_DEBUG
-        fprintf(stdout, "+ running permutations : [");
-        for (int i=0; i<max; i++)
-            fprintf(stdout, "%d ", eqv_tree[i][EQV_COL_PERM_V]);
-        fprintf(stdout, "]\n");
-#endif
-        //
-        if ( ! ( bdd_eqv_run_one_permutation(eqv_tree, l_root) ==
-                 bdd_eqv_run_one_permutation(eqv_tree, r_root) ) )
-            return 0;
-    } else {
-        int count = eqv_tree[level][EQV_COL_PERM_NV];
-        for (int poss_val=0; poss_val < (count+1); poss_val++) {
-            eqv_tree[level][EQV_COL_PERM_V] = poss_val;
-            if ( bdd_eqv_run_permutations(eqv_tree, level+1, max, l_root, r_root) == 0)
-                return 0;
-        }
-    }
-    return 1;
-}
-
-#ifdef EQV_DEBUG
-static void _print_eqv_tree(EQV_TREE eqv_tree, int n_var, int tree_sz, int l_root, int r_root) {
-    fprintf(stdout, "* EQV_TREE n_var=%d:\n", n_var);
-    fprintf(stdout, "   i   F   T  Vi  Vv PVi PVn\n");
-    fprintf(stdout, " --- --- --- --- --- --- ---\n");
-    for(int i=0; i<tree_sz; i++) {
-        fprintf(stdout,"%c",(i==l_root || i==r_root)?'>':' ');
-        fprintf(stdout,"%3d %3d %3d %3d %3d",
-                       i,
-                       eqv_tree[i][EQV_COL_FALSE],
-                       eqv_tree[i][EQV_COL_TRUE],
-                       eqv_tree[i][EQV_COL_VAR_I],
-                       eqv_tree[i][EQV_COL_VAR_V]);
-        if ( i < n_var )
-            fprintf(stdout," %3d %3d",
-                       eqv_tree[i][EQV_COL_PERM_V],
-                       eqv_tree[i][EQV_COL_PERM_NV]);
-        fprintf(stdout,"\n");
-    }
-}
-#endif
-
-int bdd_fast_quivalence(bdd* l_bdd, bdd* r_bdd, char** _errmsg) {
-    int l_tree_sz = BDD_TREESIZE(l_bdd);
-    int r_tree_sz = BDD_TREESIZE(r_bdd);
-    int eqv_tree_sz = l_tree_sz + r_tree_sz;
-    int l_tree_root = BDD_ROOT(l_bdd);
-    int r_tree_root = BDD_ROOT(r_bdd) + l_tree_sz;
-    V_rva rva_vector;
-    int n_var =  0; // number of vars to permute
-    int res;
-
-    EQV_TREE eqv_tree = MALLOC(sizeof(short[EQV_COLUMNS])*eqv_tree_sz);
-    if (eqv_tree == NULL)
-        return -1;
-
-    if ( !V_rva_init_estsz(&rva_vector, l_tree_sz+r_tree_sz))
-        return -1;
-
-
-    if ( bdd_eqv_gen(l_bdd, 0, eqv_tree, &rva_vector, &n_var) < 0 ||
-         bdd_eqv_gen(r_bdd, l_tree_sz, eqv_tree, &rva_vector, &n_var) < 0)
-        return -1;
-    V_rva_free(&rva_vector); // only necessary during build
-#ifdef EQV_DEBUG
-    _print_eqv_tree(eqv_tree, n_var, eqv_tree_sz, l_tree_root, r_tree_root);
-#endif
-    res = bdd_eqv_run_permutations(eqv_tree, 0, n_var, l_tree_root, r_tree_root);
-    FREE(eqv_tree);
-    return res;
-}
-
 /*
  *
  *
@@ -1015,6 +776,124 @@ bdd* relocate_bdd(bdd* tbr) {
     return tbr;
 }
 
+/*
+ * BDD support section. The support of a bdd is the sorted set of variables
+ * used in the bdd, stored as rva's with val -1.
+ */
+
+int bdd_support(bdd* bdd, V_rva* support, char** _errmsg) {
+    rva var = {.val = -1};
+    int n   = 0;
+
+    V_rva_reset(support);
+    for(nodei i=0; i<BDD_TREESIZE(bdd); i++) {
+        rva_node* node = BDD_NODE(bdd,i);
+        if ( !IS_LEAF(node) && ((support->size == 0) || !IS_SAMEVAR(&node->rva,&support->items[support->size-1])) ) {
+            strcpy(var.var,node->rva.var);
+            if ( V_rva_add(support,&var) < 0 )
+                return pg_error(_errmsg,"bdd_support: add fails");
+        }
+    }
+    V_rva_quicksort(support,cmpRva);
+    for(int i=0; i<support->size; i++)
+        if ( (n == 0) || !IS_SAMEVAR(&support->items[i],&support->items[n-1]) )
+            support->items[n++] = support->items[i];
+    support->size = n;
+    return BDD_OK;
+}
+
+int bdd_support_disjoint(V_rva* l, V_rva* r) {
+    int li = 0, ri = 0;
+
+    while ( (li < l->size) && (ri < r->size) ) {
+        int cmp = COMPARE_VAR(l->items[li].var,r->items[ri].var);
+        if ( cmp == 0 )
+            return 0;
+        else if ( cmp < 0 )
+            li++;
+        else
+            ri++;
+    }
+    return 1;
+}
+
+/*
+ * Return true when all variables of l precede all variables of r in the rva
+ * order, l can then be put on top of r without breaking the order.
+ */
+static int support_precedes(V_rva* l, V_rva* r) {
+    return (l->size == 0) || (r->size == 0) || 
+           (COMPARE_VAR(l->items[l->size-1].var,r->items[0].var) < 0);
+}
+
+/*
+ * The smallest and largest var of a bdd in one scan, no support set is
+ * built. Returns 0 for a constant bdd.
+ */
+static int bdd_var_range(bdd* bdd, char** lo, char** hi) {
+    *lo = *hi = NULL;
+    for(nodei i=0; i<BDD_TREESIZE(bdd); i++) {
+        rva_node* node = BDD_NODE(bdd,i);
+        if ( !IS_LEAF(node) ) {
+            if ( !*lo || (COMPARE_VAR(node->rva.var,*lo) < 0) )
+                *lo = node->rva.var;
+            if ( !*hi || (COMPARE_VAR(node->rva.var,*hi) > 0) )
+                *hi = node->rva.var;
+        }
+    }
+    return (*lo != NULL);
+}
+
+/*
+ * support_precedes() on the var ranges of the bdd's, for operands without a
+ * (cached) support. Cheaper than building and sorting both supports.
+ */
+static int bdd_precedes(bdd* l, bdd* r) {
+    char *l_lo, *l_hi, *r_lo, *r_hi;
+
+    return !bdd_var_range(l,&l_lo,&l_hi) || !bdd_var_range(r,&r_lo,&r_hi) ||
+           (COMPARE_VAR(l_hi,r_lo) < 0);
+}
+
+/*
+ * Apply for operands with disjoint ordered supports. The top bdd is put on
+ * top of the bottom bdd by redirecting its edges to the terminal which does
+ * not decide the operation ('1' for '&', '0' for '|') to the root of the
+ * bottom bdd. Both operands are reduced and share no nodes, so the result is
+ * reduced as well and is built in linear time without a G table.
+ */
+static bdd* bdd_stitch(char op, bdd* top, bdd* bottom, int verbose, char** _errmsg) {
+    bdd_runtime bdd_rt_struct, *bdd_rt;
+    nodei offset = BDD_TREESIZE(bottom) - 2;
+    nodei target = BDD_ROOT(bottom);
+    nodei redirect = (op == '&') ? 1 : 0;
+    bdd*  res;
+
+#define STITCH_MAP(I) (((I) < 2) ? (((I) == redirect) ? target : (I)) : (I)+offset)
+    if ( !(bdd_rt = bdd_rt_init(&bdd_rt_struct,NULL,verbose/*verbose*/,_errmsg)) )
+        return NULL;
+    for(nodei i=0; i<BDD_TREESIZE(bottom); i++) {
+        rva_node* node = BDD_NODE(bottom,i);
+        if ( bdd_create_node(&bdd_rt->core,&node->rva,node->low,node->high) == NODEI_NONE ) {
+            pg_error(_errmsg,"bdd_stitch: create node fails");
+            bdd_rt_free(bdd_rt);
+            return NULL;
+        }
+    }
+    for(nodei i=2; i<BDD_TREESIZE(top); i++) {
+        rva_node* node = BDD_NODE(top,i);
+        if ( bdd_create_node(&bdd_rt->core,&node->rva,STITCH_MAP(node->low),STITCH_MAP(node->high)) == NODEI_NONE ) {
+            pg_error(_errmsg,"bdd_stitch: create node fails");
+            bdd_rt_free(bdd_rt);
+            return NULL;
+        }
+    }
+#undef STITCH_MAP
+    res = serialize_bdd(&bdd_rt->core);
+    bdd_rt_free(bdd_rt);
+    return res;
+}
+
 /*
  * BDD apply() and &,|,! operator section
  */
@@ -1130,10 +1009,30 @@ static hash_matrix* store_G(hash_matrix *hm, nodei l, nodei r, nodei val, char**
  * }
  */
 
-static nodei _bdd_apply(bdd_runtime* bdd_rt, char op, bdd* b1, nodei u1, bdd* b2, nodei u2, char** _errmsg)
+/*
+ * When apply follows the high edge of x=v the rva x=v is known to be TRUE so
+ * all other x=* nodes are FALSE. These are skipped by following their low
+ * edge before the G lookup, so the result never contains paths where two
+ * values of the same var hold. Because x=* nodes are adjacent in the rva
+ * order the skipped (u1,u2) pair does not depend on the known rva anymore
+ * and the G table stays valid.
+ */
+static nodei skip_known_var(bdd* b, nodei u, rva* known) {
+    rva_node* n;
+
+    while ( !IS_LEAF(n = BDD_NODE(b,u)) && IS_SAMEVAR(&n->rva,known) )
+        u = n->low;
+    return u;
+}
+
+static nodei _bdd_apply(bdd_runtime* bdd_rt, char op, bdd* b1, nodei u1, bdd* b2, nodei u2, rva* known, char** _errmsg)
 {
-    nodei u;
+    nodei u, l, h;
 
+    if ( known ) {
+        u1 = skip_known_var(b1,u1,known);
+        u2 = skip_known_var(b2,u2,known);
+    }
 #ifdef BDD_VERBOSE
     if ( bdd_rt->verbose ) {
         pbuff pbuff_struct, *pbuff=pbuff_init(&pbuff_struct);
@@ -1157,22 +1056,23 @@ static nodei _bdd_apply(bdd_runtime* bdd_rt, char op, bdd* b1, nodei u1, bdd* b2
             u = (op=='&') ? (bv_u1 & bv_u2) : (bv_u1 | bv_u2);
         } else {
             int cmp = cmpRva(&n_u1->rva,&n_u2->rva);
+            rva* top;
             if ( cmp == 0 ) {
-                u = bdd_mk(bdd_rt, &n_u1->rva,
-                        _bdd_apply(bdd_rt,op,b1,n_u1->low,b2,n_u2->low,_errmsg),
-                        _bdd_apply(bdd_rt,op,b1,n_u1->high,b2,n_u2->high,_errmsg),
-                        _errmsg);
-            } else if ( IS_LEAF(n_u1) || (cmp < 0) ) {
-                u = bdd_mk(bdd_rt, &n_u2->rva,
-                        _bdd_apply(bdd_rt,op,b1,u1,b2,n_u2->low,_errmsg),
-                        _bdd_apply(bdd_rt,op,b1,u1,b2,n_u2->high,_errmsg),
-                        _errmsg);
-            } else { /* IS_LEAF(n_u2) || (cmp > 0) */
-                u = bdd_mk(bdd_rt, &n_u1->rva,
-                        _bdd_apply(bdd_rt,op,b1,n_u1->low, b2,u2,_errmsg),
-                        _bdd_apply(bdd_rt,op,b1,n_u1->high,b2,u2,_errmsg),
-                        _errmsg);
+                top = &n_u1->rva;
+                l = _bdd_apply(bdd_rt,op,b1,n_u1->low,b2,n_u2->low,NULL,_errmsg);
+                h = _bdd_apply(bdd_rt,op,b1,n_u1->high,b2,n_u2->high,top,_errmsg);
+            } else if ( IS_LEAF(n_u1) || (!IS_LEAF(n_u2) && (cmp > 0)) ) {
+                top = &n_u2->rva;
+                l = _bdd_apply(bdd_rt,op,b1,u1,b2,n_u2->low,NULL,_errmsg);
+                h = _bdd_apply(bdd_rt,op,b1,u1,b2,n_u2->high,top,_errmsg);
+            } else { /* IS_LEAF(n_u2) || (cmp < 0), smallest rva on top like bdd_build() */
+                top = &n_u1->rva;
+                l = _bdd_apply(bdd_rt,op,b1,n_u1->low, b2,u2,NULL,_errmsg);
+                h = _bdd_apply(bdd_rt,op,b1,n_u1->high,b2,u2,top,_errmsg);
             }
+            if ( (l == NODEI_NONE) || (h == NODEI_NONE) )
+                return NODEI_NONE;
+            u = bdd_mk(bdd_rt,top,l,h,_errmsg);
         }
 #ifdef BDD_VERBOSE
         if ( bdd_rt->verbose ) {
@@ -1227,7 +1127,7 @@ bdd* bdd_apply(char op,bdd* b1,bdd* b2,int verbose, char** _errmsg) {
     bdd_rt->call_depth   = 0;
     bdd_rt->G_cache_hits = 0;
 #endif
-    ares = _bdd_apply(bdd_rt,op,b1,BDD_ROOT(b1),b2,BDD_ROOT(b2),_errmsg);
+    ares = _bdd_apply(bdd_rt,op,b1,BDD_ROOT(b1),b2,BDD_ROOT(b2),NULL,_errmsg);
     if (ares == NODEI_NONE) {
         bdd_rt_free(bdd_rt);
         return NULL;
@@ -1247,6 +1147,23 @@ bdd* bdd_apply(char op,bdd* b1,bdd* b2,int verbose, char** _errmsg) {
     return res;
 }
 
+/*
+ * Apply with the supports of the operands. When the supports are disjoint and
+ * ordered the result is stitched together, otherwise a full apply is done.
+ * Callers having the supports (cached) can pass them, when one is NULL only
+ * the var ranges of the operands are compared, the supports are not built.
+ */
+bdd* bdd_apply_support(char op, bdd* b1, V_rva* s1, bdd* b2, V_rva* s2, int verbose, char** _errmsg) {
+    if ( (BDD_TREESIZE(b1) <= 2) || (BDD_TREESIZE(b2) <= 2) ) // constant
+        return bdd_apply(op,b1,b2,verbose,_errmsg);
+    if ( (s1 && s2) ? support_precedes(s1,s2) : bdd_precedes(b1,b2) )
+        return bdd_stitch(op,b1,b2,verbose,_errmsg);
+    else if ( (s1 && s2) ? support_precedes(s2,s1) : bdd_precedes(b2,b1) )
+        return bdd_stitch(op,b2,b1,verbose,_errmsg);
+    else
+        return bdd_apply(op,b1,b2,verbose,_errmsg);
+}
+
 static bdd* _bdd_not(bdd* par_bdd, char** _errmsg) {
     /* bdd ! operation. Could be even faster by switching node 0 and 1. But 
      * I think is is safer to have '0' at 0 and '1' at 1 so I only switch the
@@ -1299,7 +1216,7 @@ bdd* bdd_operator(char operator, op_mode m, bdd* lhs, bdd* rhs, char** _errmsg)
              return NULL;
         }
         if ( m == BY_APPLY )
-            return bdd_apply(operator,lhs,rhs,0,_errmsg);
+            return bdd_apply_support(operator,lhs,NULL,rhs,NULL,0,_errmsg);
         else
             return _bdd_binary_op_by_text(operator,lhs,rhs,_errmsg);
     } else {
@@ -1439,129 +1356,3092 @@ void bdd2string(pbuff* pb, bdd* bdd, int encapsulate) {
  * BDD probability function
  */
 
-static double bdd_probability_node(bdd_dictionary* dict, bdd* bdd, nodei T, char** extra,int verbose,char** _errmsg) {
-    nodei TT;
-    rva_node *n_T, *n_TT;
-    double m;
-    double p, P_n;
+/*
+ * Bind the dictionary probabilities to the nodes of a bdd. The node rva's are
+ * sorted so each distinct rva is looked up in the dictionary only once. All
+ * rva's missing in the dictionary are reported in one error message. After
+ * binding, prob[i] is the probability of the rva of node i (-1 for leafs).
+ * Only the nodes reachable from the root are looked up, a garbage node of
+ * the tree gets probability 0 so it can not fail a valid bdd.
+ */
 
-    n_T = n_TT = BDD_NODE(bdd,T);
-    if ( IS_LEAF(n_T) ) {
-        p = P_n = LEAF_BOOLVALUE(n_T) ? 1.0 : 0.0;
-#ifdef BDD_VERBOSE
-        if ( verbose )
-            fprintf(stdout,"+NODE[#%d]:LEAF=%f)\n",T,p);
-#endif
-    } else {
-        double P_check = -1.0;
-
-        P_n = lookup_probability(dict,&n_T->rva);
-        if ( P_n < 0.0 ) {
-            char *str_rep;
-
-            pbuff pbuff_struct, *pbuff=pbuff_init(&pbuff_struct);
-            bdd2string(pbuff,bdd,0);
-            str_rep = MALLOC(pbuff->size+1);
-            memcpy(str_rep, pbuff->buffer, pbuff->size+1);
-            pbuff_free(pbuff);
-            pg_error(_errmsg,"dictionary_lookup: rva[\'%s\'] not found in %s.",n_T->rva.var, str_rep);
-            return -1.0;
-        }
-        m = 1.0 - P_n;
-        P_check = bdd_probability_node(dict,bdd,n_TT->high,extra,verbose,_errmsg) * P_n;
-        if ( P_check < 0 )
-            return P_check;
-        p = P_check;
-#ifdef BDD_VERBOSE
-        if ( verbose )
-            fprintf(stdout,"+NODE[#%d]:START: %s=%d, m=%f, p=%f\n",T,n_T->rva.var,n_T->rva.val,m,p);
-#endif
-        if ( IS_SAMEVAR(BDD_RVA(bdd,n_TT->high),&n_T->rva) ) {
-            pg_error(_errmsg,"probabilty_alg:loop: unexpected var \'%s\' high branch",n_T->rva.var);
-            return -1.0;
-        }
-        while ( IS_SAMEVAR(BDD_RVA(bdd,n_TT->low),&n_T->rva) ) {
-            TT = n_TT->low;
-            n_TT = BDD_NODE(bdd,TT);
-            if ( IS_SAMEVAR(BDD_RVA(bdd,n_TT->high),&n_T->rva) ) {
-                pg_error(_errmsg,"probabilty_alg: unexpected var \'%s\' high branch",n_T->rva.var);
-                return -1.0;
-            }
-            P_n = lookup_probability(dict,&n_TT->rva);
-            if ( P_n < 0.0 ) {
-                pg_error(_errmsg,"dictionary_lookup: rva[\'%s\'] not found.",n_TT->rva.var);
-                return -1.0;
-            }
-            m = m - P_n;
-            P_check = bdd_probability_node(dict,bdd,n_TT->high,extra,verbose,_errmsg);
-            if ( P_check < 0 )
-                return P_check;
-            p =  p + P_check * P_n;
-#ifdef BDD_VERBOSE
-            if ( verbose )
-                fprintf(stdout,"+NODE[#%d]:SAMEVAR-LOOP: %s=%d, P_n=%f, m=%f, p=%f\n",T,n_TT->rva.var, n_TT->rva.val, P_n, m, p);
-#endif
-        }
-        p =  p + bdd_probability_node(dict,bdd,n_TT->low,extra,verbose,_errmsg) * m;
-#ifdef BDD_VERBOSE
-        if ( verbose )
-            fprintf(stdout,"+NODE[#%d]:END: p=%f\n",T, p);
-#endif
-   }
-   if ( extra )
-       sprintf(extra[T],"<i>(%.3f)<br/>%.3f<br/>%d</i>",lookup_probability(dict,BDD_RVA(bdd,T)),p,T);
-#ifdef BDD_VERBOSE
-        if ( verbose )
-            fprintf(stdout, "+**NODE[#%d]:result=%f\n",T,p);
-#endif
-   /* INCOMPLETE: check if prob is a very small negative number and if soo make it 0
-    */
-   if ( p < 0.0 || p > 1.0 ) {
-       char *str_rep;
-
-       pbuff pbuff_struct, *pbuff=pbuff_init(&pbuff_struct);
-       bdd2string(pbuff,bdd,0);
-       str_rep = MALLOC(pbuff->size+1);
-       memcpy(str_rep, pbuff->buffer, pbuff->size+1);
-       pbuff_free(pbuff);
-       pg_error(_errmsg,"probability_check: probvalue %f out of range: %s", p, str_rep);
-       return -1.0;
-   }
-   if ((p < 0.0) && (p > -TINY_ROUNDING_FRACTION))
-      p = 0.0;
-   return p;
+typedef struct node_ref {
+    rva*  rva;
+    nodei i;
+} node_ref;
+
+static int cmpNodeRef(const void* l, const void* r) {
+    return cmpRva(((node_ref*)l)->rva,((node_ref*)r)->rva);
 }
 
-double bdd_probability(bdd_dictionary* dict, bdd* bdd,char** extra, int verbose, char** _errmsg) {
-    return bdd_probability_node(dict,bdd,BDD_ROOT(bdd),extra,verbose,_errmsg);
+/*
+ * Returns the MALLOC'd flags of the nodes reachable from the root of bdd, or
+ * NULL when malloc fails.
+ */
+static char* bdd_reachable(bdd* bdd) {
+    nodei root = BDD_ROOT(bdd);
+    char* reach;
+
+    if ( !(reach = (char*)MALLOC(root+1)) )
+        return NULL;
+    memset(reach,0,root);
+    reach[root] = 1;
+    for(nodei i=root; i>=0; i--) {
+        rva_node* n_i = BDD_NODE(bdd,i);
+        if ( reach[i] && !IS_LEAF(n_i) )
+            reach[n_i->low] = reach[n_i->high] = 1;
+    }
+    return reach;
 }
 
-/* 
- * BDD contains function to check if a bdd contains an rva
+/*
+ * The binding of an array of rva_node's, shared with the ddnnf and the
+ * probability of a vector of bdd's. Only nodes with an rva are bound, leafs
+ * and the operator nodes of a ddnnf get -1. When reach is not NULL only the
+ * nodes i with reach[i] are bound, the others get 0. The k dictionaries are
+ * bound in one go, prob[i*stride+j] is the probability in dicts[j], so the
+ * nodes are sorted once for all scenarios. Returns the number of distinct
+ * rva's missing in a dictionary, they are listed in missing, and -1 on
+ * error.
  */
+static int nodes_bind_probabilities_k(bdd_dictionary** dicts, int k, rva_node* nodes, nodei n_nodes, char* reach, double* prob, int stride, pbuff* missing, char** _errmsg) {
+    node_ref* refs;
+    int       n_refs = 0, n_missing = 0;
 
-static int _contains_rva(bdd* bdd, char* var, int val) {
-    for (int i=0; i<V_rva_node_size(&bdd->tree); i++) {
-        rva_node* node = BDD_NODE(bdd,i);
-        if ( !IS_LEAF(node)) {
-            if ( COMPARE_VAR(var,node->rva.var) == 0) {
-                 if ( (val < 0) || (val == node->rva.val) )
-                     return 1;
-            }
+    if ( !(refs = (node_ref*)MALLOC((n_nodes+1)*sizeof(node_ref))) ) {
+        pg_error(_errmsg,"bdd_bind_probabilities: malloc fails");
+        return -1;
+    }
+    for(nodei i=0; i<n_nodes; i++) {
+        rva_node* node = &nodes[i];
+        if ( !IS_RVA_NODE(node) || (reach && !reach[i]) ) {
+            for(int j=0; j<k; j++)
+                prob[(size_t)i*stride+j] = IS_RVA_NODE(node) ? 0.0 : -1.0;
+        } else {
+            refs[n_refs].rva = &node->rva;
+            refs[n_refs++].i = i;
         }
     }
-    return 0;
+    qsort(refs,n_refs,sizeof(node_ref),cmpNodeRef);
+    for(int r=0; r<n_refs; ) {
+        int e, listed = 0;
+
+        for(e=r; (e<n_refs) && (cmpRva(refs[e].rva,refs[r].rva) == 0); e++)
+            ;
+        for(int j=0; j<k; j++) {
+            double p = lookup_probability(dicts[j],refs[r].rva);
+
+            if ( (p < 0.0) && !listed++ )
+                bprintf(missing,"%s\'%s=%d\'",(n_missing++ ? "," : ""),refs[r].rva->var,refs[r].rva->val);
+            for(int rr=r; rr<e; rr++)
+                prob[(size_t)refs[rr].i*stride+j] = p;
+        }
+        r = e;
+    }
+    FREE(refs);
+    return n_missing;
 }
 
-int bdd_contains(bdd* bdd, char* var, int val, char** _errmsg) {
-    return _contains_rva(bdd,var,val);
+static int nodes_bind_probabilities(bdd_dictionary* dict, rva_node* nodes, nodei n_nodes, char* reach, double* prob, pbuff* missing, char** _errmsg) {
+    return nodes_bind_probabilities_k(&dict,1,nodes,n_nodes,reach,prob,1,missing,_errmsg);
 }
 
-/* 
- * BDD property check function 
- */
+int tree_bind_probabilities(bdd_dictionary* dict, V_rva_node* tree, double* prob, pbuff* missing, char** _errmsg) {
+    return nodes_bind_probabilities(dict,tree->items,V_rva_node_size(tree),NULL,prob,missing,_errmsg);
+}
 
-// INCOMPLETE, no parsing in this fun, var and val must be seperate args
+static int bdd_bind_probabilities_k(bdd_dictionary** dicts, int k, bdd* bdd, double* prob, int stride, char** _errmsg) {
+    pbuff pbuff_struct, *missing = pbuff_init(&pbuff_struct);
+    char* reach;
+    int   n_missing;
+
+    if ( !(reach = bdd_reachable(bdd)) )
+        return pg_error(_errmsg,"bdd_bind_probabilities: malloc fails");
+    n_missing = nodes_bind_probabilities_k(dicts,k,bdd->tree.items,BDD_TREESIZE(bdd),reach,prob,stride,missing,_errmsg);
+    FREE(reach);
+    if ( n_missing > 0 ) {
+        pbuff bdd_pbuff_struct, *bdd_pbuff=pbuff_init(&bdd_pbuff_struct);
+
+        bdd2string(bdd_pbuff,bdd,0);
+        pg_error(_errmsg,"dictionary_lookup: rva[%s] not found in %s.",missing->buffer,bdd_pbuff->buffer);
+        pbuff_free(bdd_pbuff);
+    }
+    pbuff_free(missing);
+    return (n_missing == 0) ? BDD_OK : BDD_FAIL;
+}
+
+int bdd_bind_probabilities(bdd_dictionary* dict, bdd* bdd, double* prob, char** _errmsg) {
+    return bdd_bind_probabilities_k(&dict,1,bdd,prob,1,_errmsg);
+}
+
+/*
+ * The probability of all nodes is computed in one ascending pass over the
+ * tree, children always have a lower index than their parents. A chain of
+ * nodes with the same var on the low edges contains the alternatives x=v1,
+ * x=v2,... of var x. For node i with probability p_i of its rva:
+ *
+ *      S(i) = p_i * P(high) + (low has same var ? S(low) : 0)
+ *      M(i) = p_i           + (low has same var ? M(low) : 0)
+ *      E(i) = (low has same var ? E(low) : low)
+ *      P(i) = S(i) + (1 - M(i)) * P(E(i))
+ *
+ * so every node is computed exactly once, also when it is shared. This is
+ * the semiring pass (see bdd.h) in (+,*), only the scenarios compute it
+ * themselves on k lanes at once.
+ */
+
+#define PROB_UNREACHED  -1
+#define PROB_REACHED    -2
+
+static int bdd_probability_error(bdd* bdd, double p, char** _errmsg) {
+    char *str_rep;
+
+    pbuff pbuff_struct, *pbuff=pbuff_init(&pbuff_struct);
+    bdd2string(pbuff,bdd,0);
+    str_rep = MALLOC(pbuff->size+1);
+    memcpy(str_rep, pbuff->buffer, pbuff->size+1);
+    pbuff_free(pbuff);
+    return pg_error(_errmsg,"probability_check: probvalue %f out of range: %s", p, str_rep);
+}
+
+/*
+ * The probability pass is the semiring pass (see bdd.h) in (+,*) with lit
+ * p_i and rest 1-M(i), the most probable world is the pass in (max,*).
+ */
+
+#define SR_PLUS(A,B)    ((A)+(B))
+#define SR_TIMES(A,B)   ((A)*(B))
+#define SR_MAX(A,B)     (((A)>(B))?(A):(B))
+
+DefBddSemiringH(prob,double)
+DefBddSemiringC(prob,double,0.0,1.0,SR_PLUS,SR_TIMES)
+
+DefBddSemiringH(maxp,double)
+DefBddSemiringC(maxp,double,0.0,1.0,SR_MAX,SR_TIMES)
+
+/*
+ * Bind lit to p_i and rest to M(i), then rest to 1-M(i), for an array of
+ * nodes with children before parents.
+ */
+static void prob_sr_bind(rva_node* nodes, nodei n_nodes, double* prob, prob_sr* sr) {
+    for(nodei i=0; i<n_nodes; i++) {
+        rva_node* n_i = &nodes[i];
+
+        if ( IS_LEAF(n_i) )
+            continue;
+        sr[i].lit = sr[i].rest = prob[i];
+        if ( !IS_LEAF(&nodes[n_i->low]) && IS_SAMEVAR(&nodes[n_i->low].rva,&n_i->rva) )
+            sr[i].rest += sr[n_i->low].rest;
+    }
+    for(nodei i=0; i<n_nodes; i++)
+        if ( !IS_LEAF(&nodes[i]) )
+            sr[i].rest = 1.0 - sr[i].rest;
+}
+
+static double bdd_probability_pass(bdd* bdd, double* prob, prob_sr* sr, char** extra, int verbose, char** _errmsg) {
+    nodei root = BDD_ROOT(bdd);
+
+    prob_sr_bind(bdd->tree.items,root+1,prob,sr);
+    prob_sr_pass(bdd,sr);
+    for(nodei i=0; i<=root; i++) {
+        rva_node* n_i = BDD_NODE(bdd,i);
+        prob_sr*  s   = &sr[i];
+
+        if ( s->end == BDD_SR_UNREACHED )
+            continue;
+        if ( IS_LEAF(n_i) ) {
+#ifdef BDD_VERBOSE
+            if ( verbose )
+                fprintf(stdout,"+NODE[#%d]:LEAF=%f)\n",i,s->val);
+#endif
+        } else {
+            if ( IS_SAMEVAR(BDD_RVA(bdd,n_i->high),&n_i->rva) ) {
+                pg_error(_errmsg,"probabilty_alg: unexpected var \'%s\' high branch",n_i->rva.var);
+                return -1.0;
+            }
+#ifdef BDD_VERBOSE
+            if ( verbose )
+                fprintf(stdout,"+NODE[#%d]: %s=%d, p=%f, S=%f, M=%f, E=%d, P=%f\n",i,n_i->rva.var,n_i->rva.val,s->lit,s->sum,1.0-s->rest,s->end,s->val);
+#endif
+            if ( s->val < 0.0 || s->val > 1.0 ) {
+                bdd_probability_error(bdd,s->val,_errmsg);
+                return -1.0;
+            }
+        }
+        if ( extra )
+            sprintf(extra[i],"<i>(%.3f)<br/>%.3f<br/>%d</i>",prob[i],s->val,i);
+    }
+    return sr[root].val;
+}
+
+double bdd_probability(bdd_dictionary* dict, bdd* bdd,char** extra, int verbose, char** _errmsg) {
+    prob_sr* sr;
+    double*  prob;
+    double   res = -1.0;
+
+    if ( !(sr = (prob_sr*)MALLOC(BDD_TREESIZE(bdd)*(sizeof(prob_sr)+sizeof(double)))) ) {
+        pg_error(_errmsg,"bdd_probability: scratch malloc fails");
+        return -1.0;
+    }
+    prob = (double*)&sr[BDD_TREESIZE(bdd)];
+    if ( bdd_bind_probabilities(dict,bdd,prob,_errmsg) )
+        res = bdd_probability_pass(bdd,prob,sr,extra,verbose,_errmsg);
+    FREE(sr);
+#ifdef BDD_VERBOSE
+    if ( verbose && (res >= 0.0) )
+        fprintf(stdout, "+**ROOT[#%d]:result=%f\n",BDD_ROOT(bdd),res);
+#endif
+    return res;
+}
+
+#ifndef PG_CONFIG
+/*
+ * Parallel probability for very large bdd's, only in the standalone build,
+ * in the backend the processes are managed by Postgres. A node depends on
+ * its high and low child only, so with level(leaf) = 0 and
+ *
+ *      level(i) = 1 + max(level(high),level(low))
+ *
+ * the nodes of a level are independent. The nodes are bucketed by level and
+ * a level is computed by n_threads workers on disjoint slices of it. A worker
+ * only writes the prob_sr of its own nodes so no locks are needed, a barrier
+ * separates the levels. Runs of levels smaller than min_level nodes are
+ * computed by worker 0 alone, they are not worth a barrier each. The
+ * probabilities are bound in parallel on slices of the node array, the
+ * dictionary is only read. Unreachable nodes are computed too, they do not
+ * change the result.
+ */
+
+#define PAR_MIN_LEVEL 1024
+
+typedef struct par_barrier { // pthread_barrier_t is not available everywhere
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    int             n, waiting, generation;
+} par_barrier;
+
+static void par_barrier_init(par_barrier* b, int n) {
+    pthread_mutex_init(&b->mutex,NULL);
+    pthread_cond_init(&b->cond,NULL);
+    b->n          = n;
+    b->waiting    = 0;
+    b->generation = 0;
+}
+
+static void par_barrier_wait(par_barrier* b) {
+    int generation;
+
+    pthread_mutex_lock(&b->mutex);
+    generation = b->generation;
+    if ( ++b->waiting == b->n ) {
+        b->waiting = 0;
+        b->generation++;
+        pthread_cond_broadcast(&b->cond);
+    } else {
+        while ( generation == b->generation )
+            pthread_cond_wait(&b->cond,&b->mutex);
+    }
+    pthread_mutex_unlock(&b->mutex);
+}
+
+static void par_barrier_destroy(par_barrier* b) {
+    pthread_cond_destroy(&b->cond);
+    pthread_mutex_destroy(&b->mutex);
+}
+
+typedef struct par_prob {
+    bdd*            bdd;
+    bdd_dictionary* dict;
+    prob_sr*        sr;
+    double*         M;       // M(i) of bdd_probability_pass()
+    char*           reach;   // the nodes reachable from the root
+    nodei*          order;   // the nodes ordered on level
+    int*            seg;     // segment s is order[seg[s]..seg[s+1])
+    char*           seg_par; // 1 when segment s is one level done in parallel
+    int             n_seg;
+    int             n_threads;
+    par_barrier     barrier;
+} par_prob;
+
+typedef struct par_worker {
+    par_prob* pp;
+    int       id;
+    int       missing; // an rva not in the dictionary
+    nodei     bad;     // a node with probability out of range
+} par_worker;
+
+static void par_prob_node(par_prob* pp, par_worker* w, nodei i) {
+    rva_node* n_i = BDD_NODE(pp->bdd,i);
+    prob_sr*  s   = &pp->sr[i];
+
+    if ( !IS_LEAF(n_i) ) { // same arithmetic as bdd_probability_pass()
+        pp->M[i] = s->lit;
+        if ( !IS_LEAF_I(pp->bdd,n_i->low) && IS_SAMEVAR(BDD_RVA(pp->bdd,n_i->low),&n_i->rva) )
+            pp->M[i] += pp->M[n_i->low];
+        s->rest = 1.0 - pp->M[i];
+    }
+    prob_sr_step(pp->bdd->tree.items,pp->sr,i);
+    if ( s->val < 0.0 || s->val > 1.0 )
+        w->bad = i;
+}
+
+static void* par_prob_worker(void* arg) {
+    par_worker* w  = (par_worker*)arg;
+    par_prob*   pp = w->pp;
+    int64_t     sz;
+
+    par_barrier_wait(&pp->barrier); // all workers started, n_threads is final
+    sz = BDD_TREESIZE(pp->bdd);
+    for(nodei i=(nodei)(sz*w->id/pp->n_threads); i<(nodei)(sz*(w->id+1)/pp->n_threads); i++) {
+        if ( IS_LEAF_I(pp->bdd,i) )
+            continue;
+        if ( !pp->reach[i] )
+            pp->sr[i].lit = 0.0; // garbage, like bdd_bind_probabilities()
+        else if ( (pp->sr[i].lit = lookup_probability(pp->dict,BDD_RVA(pp->bdd,i))) < 0.0 )
+            w->missing = 1;
+    }
+    par_barrier_wait(&pp->barrier);
+    for(int s=0; s<pp->n_seg; s++) {
+        int64_t from = pp->seg[s], n = pp->seg[s+1] - pp->seg[s];
+
+        if ( pp->seg_par[s] ) {
+            for(int64_t k=from+n*w->id/pp->n_threads; k<from+n*(w->id+1)/pp->n_threads; k++)
+                par_prob_node(pp,w,pp->order[k]);
+        } else if ( w->id == 0 ) {
+            for(int64_t k=from; k<from+n; k++)
+                par_prob_node(pp,w,pp->order[k]);
+        }
+        par_barrier_wait(&pp->barrier);
+    }
+    return NULL;
+}
+
+/*
+ * The probability of bdd computed by n_threads threads, min_level <= 0 is
+ * PAR_MIN_LEVEL. Returns -1.0 on error.
+ */
+double bdd_probability_parallel(bdd_dictionary* dict, bdd* bdd, int n_threads, int min_level, char** _errmsg) {
+    nodei       sz = BDD_TREESIZE(bdd);
+    par_prob    pp;
+    par_worker* workers = NULL;
+    pthread_t*  threads = NULL;
+    int        *level = NULL, *start = NULL, n_lev = 1, n_created = 1;
+    double      res = -1.0;
+
+    if ( n_threads < 1 )
+        n_threads = 1;
+    if ( min_level <= 0 )
+        min_level = PAR_MIN_LEVEL;
+    memset(&pp,0,sizeof(par_prob));
+    if ( !(pp.sr      = (prob_sr*)MALLOC(sz*sizeof(prob_sr))) ||
+         !(pp.M       = (double*)MALLOC(sz*sizeof(double))) ||
+         !(pp.reach   = bdd_reachable(bdd)) ||
+         !(pp.order   = (nodei*)MALLOC(sz*sizeof(nodei))) ||
+         !(pp.seg     = (int*)MALLOC((sz+1)*sizeof(int))) ||
+         !(pp.seg_par = (char*)MALLOC(sz*sizeof(char))) ||
+         !(level      = (int*)MALLOC(sz*sizeof(int))) ||
+         !(workers    = (par_worker*)MALLOC(n_threads*sizeof(par_worker))) ||
+         !(threads    = (pthread_t*)MALLOC(n_threads*sizeof(pthread_t))) ) {
+        pg_error(_errmsg,"bdd_probability_parallel: malloc fails");
+        goto cleanup;
+    }
+    for(nodei i=0; i<sz; i++) {
+        rva_node* n_i = BDD_NODE(bdd,i);
+
+        if ( IS_LEAF(n_i) )
+            level[i] = 0;
+        else {
+            if ( IS_SAMEVAR(BDD_RVA(bdd,n_i->high),&n_i->rva) ) {
+                pg_error(_errmsg,"probabilty_alg: unexpected var \'%s\' high branch",n_i->rva.var);
+                goto cleanup;
+            }
+            level[i] = 1 + ((level[n_i->high] > level[n_i->low]) ? level[n_i->high] : level[n_i->low]);
+            if ( level[i] >= n_lev )
+                n_lev = level[i] + 1;
+        }
+    }
+    if ( !(start = (int*)MALLOC((n_lev+1)*sizeof(int))) ) {
+        pg_error(_errmsg,"bdd_probability_parallel: malloc fails");
+        goto cleanup;
+    }
+    memset(start,0,(n_lev+1)*sizeof(int));
+    for(nodei i=0; i<sz; i++) // bucket sort on level
+        start[level[i]+1]++;
+    for(int l=0; l<n_lev; l++)
+        start[l+1] += start[l];
+    for(nodei i=0; i<sz; i++)
+        pp.order[start[level[i]]++] = i;
+    for(int l=n_lev; l>0; l--) // start[l] was moved to the end of level l
+        start[l] = start[l-1];
+    start[0] = 0;
+    for(int l=0; l<n_lev; l++) {
+        int par = (n_threads > 1) && (start[l+1]-start[l] >= min_level);
+
+        if ( par || (pp.n_seg == 0) || pp.seg_par[pp.n_seg-1] ) {
+            pp.seg[pp.n_seg]       = start[l];
+            pp.seg_par[pp.n_seg++] = par;
+        }
+    }
+    pp.seg[pp.n_seg] = sz;
+    pp.bdd       = bdd;
+    pp.dict      = dict;
+    pp.n_threads = n_threads;
+    par_barrier_init(&pp.barrier,n_threads);
+    for(int t=0; t<n_threads; t++) {
+        workers[t].pp      = &pp;
+        workers[t].id      = t;
+        workers[t].missing = 0;
+        workers[t].bad     = NODEI_NONE;
+    }
+    for(; n_created<n_threads; n_created++)
+        if ( pthread_create(&threads[n_created],NULL,par_prob_worker,&workers[n_created]) != 0 )
+            break;
+    if ( n_created < n_threads ) { // continue with the threads there are
+        pthread_mutex_lock(&pp.barrier.mutex);
+        pp.barrier.n = pp.n_threads = n_created;
+        pthread_mutex_unlock(&pp.barrier.mutex);
+    }
+    par_prob_worker(&workers[0]);
+    for(int t=1; t<n_created; t++)
+        pthread_join(threads[t],NULL);
+    par_barrier_destroy(&pp.barrier);
+    for(int t=0; t<n_created; t++)
+        if ( workers[t].missing ) {
+            bdd_bind_probabilities(dict,bdd,pp.M,_errmsg); // fails with the message
+            goto cleanup;
+        }
+    for(int t=0; t<n_created; t++)
+        if ( workers[t].bad != NODEI_NONE ) {
+            bdd_probability_error(bdd,pp.sr[workers[t].bad].val,_errmsg);
+            goto cleanup;
+        }
+    res = pp.sr[BDD_ROOT(bdd)].val;
+cleanup:
+    if ( pp.sr )      FREE(pp.sr);
+    if ( pp.M )       FREE(pp.M);
+    if ( pp.reach )   FREE(pp.reach);
+    if ( pp.order )   FREE(pp.order);
+    if ( pp.seg )     FREE(pp.seg);
+    if ( pp.seg_par ) FREE(pp.seg_par);
+    if ( level )      FREE(level);
+    if ( start )      FREE(start);
+    if ( workers )    FREE(workers);
+    if ( threads )    FREE(threads);
+    return res;
+}
+#endif
+
+/*
+ * Probability of (a op b). Operands without common variables are
+ * independent, then P(a&b) = P(a)P(b) and P(a|b) = P(a)+P(b)-P(a)P(b) and
+ * no bdd for the combination is created.
+ */
+double bdd_probability_op(bdd_dictionary* dict, char op, bdd* a, bdd* b, int verbose, char** _errmsg) {
+    return bdd_probability_op_support(dict,op,a,NULL,NULL,b,NULL,NULL,verbose,_errmsg);
+}
+
+/*
+ * bdd_probability_op() with the supports and probabilities of the operands.
+ * Supports not passed are computed once, and only when the var ranges of the
+ * operands overlap, ordered operands are disjoint anyway. When pa/pb are
+ * not NULL and >= 0.0 they are used as the probability of the operand,
+ * when < 0.0 and the probability is computed it is stored there.
+ */
+double bdd_probability_op_support(bdd_dictionary* dict, char op, bdd* a, V_rva* sa, double* pa, bdd* b, V_rva* sb, double* pb, int verbose, char** _errmsg) {
+    V_rva  sa_struct, sb_struct;
+    double res = -1.0;
+    int    disjoint;
+
+    if ( (op != '&') && (op != '|') ) {
+        pg_error(_errmsg,"bdd_probability_op: bad operator (%c)",op);
+        return -1.0;
+    }
+    if ( (sa && sb) || !(disjoint = (bdd_precedes(a,b) || bdd_precedes(b,a))) ) {
+        if ( !sa ) {
+            sa = V_rva_init(&sa_struct);
+            if ( !bdd_support(a,sa,_errmsg) )
+                goto cleanup;
+        }
+        if ( !sb ) {
+            sb = V_rva_init(&sb_struct);
+            if ( !bdd_support(b,sb,_errmsg) )
+                goto cleanup;
+        }
+        disjoint = bdd_support_disjoint(sa,sb);
+    }
+    if ( disjoint ) {
+        double a_prob = (pa && (*pa >= 0.0)) ? *pa : bdd_probability(dict,a,NULL,verbose,_errmsg);
+        double b_prob;
+
+        if ( a_prob < 0.0 )
+            goto cleanup;
+        if ( pa )
+            *pa = a_prob;
+        if ( (b_prob = (pb && (*pb >= 0.0)) ? *pb : bdd_probability(dict,b,NULL,verbose,_errmsg)) < 0.0 )
+            goto cleanup;
+        if ( pb )
+            *pb = b_prob;
+        res = (op == '&') ? a_prob*b_prob : a_prob+b_prob-a_prob*b_prob;
+    } else {
+        bdd* ab;
+
+        if ( !(ab = bdd_apply_support(op,a,sa,b,sb,verbose,_errmsg)) )
+            goto cleanup;
+        res = bdd_probability(dict,ab,NULL,verbose,_errmsg);
+        FREE(ab);
+    }
+cleanup:
+    if ( sa == &sa_struct ) V_rva_free(sa);
+    if ( sb == &sb_struct ) V_rva_free(sb);
+    return res;
+}
+
+/*
+ * Decide P(bdd) > t (strict) or P(bdd) >= t without computing P exactly
+ * when possible. The paths from the root are disjoint events, paths are
+ * expanded best first from a heap on their probability. A path reaching
+ * TRUE adds to the lower bound, a path reaching FALSE lowers the upper bound,
+ * and the walk stops as soon as the bounds decide the comparison. Along a
+ * chain of the same var m is the probability of the values already excluded,
+ * so from node (x=v) with probability p the path continues with
+ *
+ *     high: q * p / (1-m)           low: q * (1-m-p) / (1-m)
+ *
+ * The number of paths can grow exponentially, after BDD_EXCEEDS_BUDGET
+ * expansions the exact probability is computed.
+ */
+
+#define BDD_EXCEEDS_BUDGET(N) (4*(N)+64)
+
+typedef struct exceeds_path {
+    double q; // probability of the path
+    double m; // excluded probability of the current chain var
+    nodei  node;
+} exceeds_path;
+
+static void exceeds_push(exceeds_path* heap, int* n, double q, double m, nodei node) {
+    int i = (*n)++;
+
+    while ( i > 0 && heap[(i-1)/2].q < q ) {
+        heap[i] = heap[(i-1)/2];
+        i = (i-1)/2;
+    }
+    heap[i].q    = q;
+    heap[i].m    = m;
+    heap[i].node = node;
+}
+
+static exceeds_path exceeds_pop(exceeds_path* heap, int* n) {
+    exceeds_path top  = heap[0];
+    exceeds_path last = heap[--(*n)];
+    int          i    = 0;
+
+    for(;;) {
+        int c = 2*i+1;
+
+        if ( c >= *n )
+            break;
+        if ( (c+1 < *n) && (heap[c+1].q > heap[c].q) )
+            c++;
+        if ( heap[c].q <= last.q )
+            break;
+        heap[i] = heap[c];
+        i = c;
+    }
+    if ( *n > 0 )
+        heap[i] = last;
+    return top;
+}
+
+static int exceeds_decided(double lower, double upper, double t, int strict) {
+    if ( strict ? (lower > t) : (lower >= t) )
+        return 1;
+    if ( strict ? (upper <= t) : (upper < t) )
+        return 0;
+    return -1;
+}
+
+/*
+ * Returns 1 when P(bdd) > t (strict) or P(bdd) >= t, 0 when not and -1 on
+ * error.
+ */
+int bdd_probability_exceeds(bdd_dictionary* dict, bdd* bdd, double t, int strict, char** _errmsg) {
+    double*       prob = NULL;
+    exceeds_path* heap = NULL;
+    int           n_heap = 0, budget = BDD_EXCEEDS_BUDGET(BDD_TREESIZE(bdd));
+    double        lower = 0.0, false_mass = 0.0;
+    int           res;
+
+    if ( (res = exceeds_decided(0.0,1.0,t,strict)) >= 0 )
+        return res;
+    if ( !(prob = (double*)MALLOC(BDD_TREESIZE(bdd)*sizeof(double))) ||
+         !(heap = (exceeds_path*)MALLOC((budget+2)*sizeof(exceeds_path))) ) {
+        res = pg_error(_errmsg,"bdd_probability_exceeds: malloc fails") - 1;
+        goto done;
+    }
+    if ( !bdd_bind_probabilities(dict,bdd,prob,_errmsg) ) {
+        res = -1;
+        goto done;
+    }
+    exceeds_push(heap,&n_heap,1.0,0.0,BDD_ROOT(bdd));
+    while ( n_heap > 0 && budget-- > 0 ) {
+        exceeds_path e    = exceeds_pop(heap,&n_heap);
+        rva_node*    node = BDD_NODE(bdd,e.node);
+        double       rest = 1.0 - e.m, p, q_low;
+
+        if ( IS_LEAF(node) ) {
+            if ( LEAF_BOOLVALUE(node) )
+                lower      += e.q;
+            else
+                false_mass += e.q;
+            if ( (res = exceeds_decided(lower,1.0-false_mass,t,strict)) >= 0 )
+                goto done;
+            continue;
+        }
+        if ( rest <= 0.0 ) // all values excluded, unreachable
+            continue;
+        p = prob[e.node];
+        if ( e.q*p > 0.0 )
+            exceeds_push(heap,&n_heap,e.q*p/rest,0.0,node->high);
+        if ( (q_low = e.q*(rest-p)/rest) > 0.0 ) {
+            if ( !IS_LEAF_I(bdd,node->low) && IS_SAMEVAR(BDD_RVA(bdd,node->low),&node->rva) )
+                exceeds_push(heap,&n_heap,q_low,e.m+p,node->low);
+            else
+                exceeds_push(heap,&n_heap,q_low,0.0,node->low);
+        }
+    }
+    if ( n_heap == 0 ) { // all paths done, lower is P
+        res = strict ? (lower > t) : (lower >= t);
+    } else { // budget exhausted
+        prob_sr* sr;
+        double   P;
+
+        if ( !(sr = (prob_sr*)MALLOC(BDD_TREESIZE(bdd)*sizeof(prob_sr))) ) {
+            res = pg_error(_errmsg,"bdd_probability_exceeds: malloc fails") - 1;
+            goto done;
+        }
+        P = bdd_probability_pass(bdd,prob,sr,NULL,0,_errmsg);
+        FREE(sr);
+        res = (P < 0.0) ? -1 : (strict ? (P > t) : (P >= t));
+    }
+done:
+    if ( heap ) FREE(heap);
+    if ( prob ) FREE(prob);
+    return res;
+}
+
+/*
+ * The k most probable of a stream of bdd's. A min-heap keeps the k best
+ * probabilities, once it is full a new bdd is first tested with
+ * bdd_probability_exceeds() against the smallest probability in the heap,
+ * only when it can enter the heap its exact probability is computed. Every
+ * heap entry has a slot 0..k-1 for the payload of the caller, the slot of
+ * an evicted entry is reused by the entry replacing it.
+ */
+
+bdd_prob_heap* bdd_prob_heap_create(int k, char** _errmsg) {
+    bdd_prob_heap* h;
+
+    if ( k < 1 ) {
+        pg_error(_errmsg,"bdd_prob_heap: k must be positive (%d)",k);
+        return NULL;
+    }
+    if ( !(h = (bdd_prob_heap*)MALLOC(sizeof(bdd_prob_heap)+k*(sizeof(double)+sizeof(int)))) ) {
+        pg_error(_errmsg,"bdd_prob_heap: malloc fails");
+        return NULL;
+    }
+    h->k        = k;
+    h->n        = 0;
+    h->pruned   = 0;
+    h->computed = 0;
+    h->prob     = (double*)&h[1];
+    h->slot     = (int*)&h->prob[k];
+    return h;
+}
+
+static void prob_heap_down(bdd_prob_heap* h, int i) {
+    double p = h->prob[i];
+    int    s = h->slot[i];
+
+    for(;;) {
+        int c = 2*i+1;
+
+        if ( c >= h->n )
+            break;
+        if ( (c+1 < h->n) && (h->prob[c+1] < h->prob[c]) )
+            c++;
+        if ( h->prob[c] >= p )
+            break;
+        h->prob[i] = h->prob[c];
+        h->slot[i] = h->slot[c];
+        i = c;
+    }
+    h->prob[i] = p;
+    h->slot[i] = s;
+}
+
+/*
+ * Offer bdd to the heap. Returns the payload slot of bdd when it enters the
+ * heap, -1 when it is pruned and -2 on error.
+ */
+int bdd_prob_heap_offer(bdd_prob_heap* h, bdd_dictionary* dict, bdd* bdd, char** _errmsg) {
+    double P;
+    int    i, slot;
+
+    if ( h->n == h->k ) {
+        int exceeds;
+
+        if ( IS_LEAF_I(bdd,BDD_ROOT(bdd)) && !LEAF_BOOLVALUE(BDD_NODE(bdd,BDD_ROOT(bdd))) )
+            exceeds = 0;
+        else if ( (exceeds = bdd_probability_exceeds(dict,bdd,h->prob[0],1/*strict*/,_errmsg)) < 0 )
+            return -2;
+        if ( !exceeds ) {
+            h->pruned++;
+            return -1;
+        }
+    }
+    if ( (P = bdd_probability(dict,bdd,NULL,0,_errmsg)) < 0.0 )
+        return -2;
+    h->computed++;
+    if ( h->n < h->k ) { // sift up
+        slot = i = h->n++;
+        while ( (i > 0) && (h->prob[(i-1)/2] > P) ) {
+            h->prob[i] = h->prob[(i-1)/2];
+            h->slot[i] = h->slot[(i-1)/2];
+            i = (i-1)/2;
+        }
+        h->prob[i] = P;
+        h->slot[i] = slot;
+    } else { // replace the smallest
+        slot       = h->slot[0];
+        h->prob[0] = P;
+        prob_heap_down(h,0);
+    }
+    return slot;
+}
+
+/*
+ * Sets slots[] and probs[] to the heap entries in descending probability
+ * and returns their number. The heap itself is left untouched, the entries
+ * are copied to slots[]/probs[] and heap sorted in place there, so the
+ * final function of an aggregate may call this on its transition state.
+ */
+int bdd_prob_heap_sorted(bdd_prob_heap* h, int* slots, double* probs) {
+    bdd_prob_heap s = *h; // a heap on the output arrays
+
+    memcpy(probs,h->prob,h->n*sizeof(double));
+    memcpy(slots,h->slot,h->n*sizeof(int));
+    s.prob = probs;
+    s.slot = slots;
+    while ( s.n > 1 ) { // swap the smallest to the end
+        double p = s.prob[0];
+        int    i = s.slot[0];
+
+        s.n--;
+        s.prob[0]   = s.prob[s.n];
+        s.slot[0]   = s.slot[s.n];
+        s.prob[s.n] = p;
+        s.slot[s.n] = i;
+        prob_heap_down(&s,0);
+    }
+    return h->n;
+}
+
+/*
+ * Probability of n bdd's with one dictionary. The nodes of all bdd's are
+ * hash-consed in one table, so a sub-bdd occurring in more than one bdd is
+ * bound and computed once. This is possible because the P/S/M/E values of a
+ * node only depend on the nodes below it. The table is built first, then
+ * each distinct rva of the whole batch is looked up once by the sorted
+ * binding of tree_bind_probabilities() and finally one ascending pass
+ * computes all nodes. NULL entries of bdds are skipped, res[i] is the
+ * probability of bdds[i].
+ */
+
+typedef struct prob_table {
+    rva_node*     nodes;    // low and high are indices in nodes
+    int*          owner;    // the first bdd containing nodes[i]
+    nodei         n_nodes;
+    nodei         max_nodes;
+    nodei*        hash;     // node index+1, 0 is empty
+    uint32_t      hash_mask;
+} prob_table;
+
+static uint32_t prob_node_hash(rva_node* n) {
+    uint32_t h = 2166136261u; // FNV-1a
+
+    for(char* c=n->rva.var; *c; c++) {
+        h ^= (unsigned char)*c;
+        h *= 16777619u;
+    }
+    h ^= (uint32_t)n->rva.val;  h *= 16777619u;
+    h ^= (uint32_t)n->low;      h *= 16777619u;
+    h ^= (uint32_t)n->high;     h *= 16777619u;
+    return h;
+}
+
+static int prob_table_rehash(prob_table* pt, uint32_t hash_sz, char** _errmsg) {
+    if ( pt->hash )
+        FREE(pt->hash);
+    if ( !(pt->hash = (nodei*)MALLOC(hash_sz*sizeof(nodei))) )
+        return pg_error(_errmsg,"bdd_probability_vector: malloc fails");
+    memset(pt->hash,0,hash_sz*sizeof(nodei));
+    pt->hash_mask = hash_sz-1;
+    for(nodei i=2; i<pt->n_nodes; i++) {
+        uint32_t h;
+        for(h=prob_node_hash(&pt->nodes[i])&pt->hash_mask; pt->hash[h]; h=(h+1)&pt->hash_mask)
+            ;
+        pt->hash[h] = i+1;
+    }
+    return BDD_OK;
+}
+
+static nodei prob_table_node(prob_table* pt, int owner, rva_node* key, char** _errmsg) {
+    uint32_t h;
+    nodei    i;
+
+    for(h=prob_node_hash(key)&pt->hash_mask; pt->hash[h]; h=(h+1)&pt->hash_mask) {
+        rva_node* n = &pt->nodes[pt->hash[h]-1];
+        if ( (n->low == key->low) && (n->high == key->high) && (cmpRva(&n->rva,&key->rva) == 0) )
+            return pt->hash[h]-1;
+    }
+    if ( !IS_LEAF(&pt->nodes[key->high]) && IS_SAMEVAR(&pt->nodes[key->high].rva,&key->rva) ) {
+        pg_error(_errmsg,"probabilty_alg: unexpected var \'%s\' high branch",key->rva.var);
+        return NODEI_NONE;
+    }
+    if ( pt->n_nodes == pt->max_nodes ) {
+        rva_node* nodes;
+        int*      owners;
+
+        if ( !(nodes = (rva_node*)REALLOC(pt->nodes,2*pt->max_nodes*sizeof(rva_node))) ) {
+            pg_error(_errmsg,"bdd_probability_vector: realloc fails");
+            return NODEI_NONE;
+        }
+        pt->nodes = nodes;
+        if ( !(owners = (int*)REALLOC(pt->owner,2*pt->max_nodes*sizeof(int))) ) {
+            pg_error(_errmsg,"bdd_probability_vector: realloc fails");
+            return NODEI_NONE;
+        }
+        pt->owner      = owners;
+        pt->max_nodes *= 2;
+    }
+    i = pt->n_nodes;
+    pt->nodes[i] = *key;
+    pt->owner[i] = owner;
+    pt->hash[h]  = ++pt->n_nodes;
+    if ( (uint32_t)(2*pt->n_nodes) > pt->hash_mask ) {
+        if ( !prob_table_rehash(pt,2*(pt->hash_mask+1),_errmsg) )
+            return NODEI_NONE;
+    }
+    return i;
+}
+
+int bdd_probability_vector(bdd_dictionary* dict, bdd** bdds, int n, double* res, char** _errmsg) {
+    prob_table    pt = {.nodes = NULL, .owner = NULL, .hash = NULL};
+    pbuff         pbuff_struct, *missing = pbuff_init(&pbuff_struct);
+    nodei        *map = NULL, *roots = NULL;
+    nodei         max_tree = 1;
+    double*       prob = NULL;
+    prob_sr*      sr = NULL;
+    int           n_missing, ok = BDD_FAIL;
+
+    for(int k=0; k<n; k++)
+        if ( bdds[k] && (BDD_TREESIZE(bdds[k]) > max_tree) )
+            max_tree = BDD_TREESIZE(bdds[k]);
+    pt.max_nodes = 64;
+    if ( !(map = (nodei*)MALLOC(max_tree*sizeof(nodei))) ||
+         !(roots = (nodei*)MALLOC((n>0?n:1)*sizeof(nodei))) ||
+         !(pt.nodes = (rva_node*)MALLOC(pt.max_nodes*sizeof(rva_node))) ||
+         !(pt.owner = (int*)MALLOC(pt.max_nodes*sizeof(int))) ) {
+        pg_error(_errmsg,"bdd_probability_vector: malloc fails");
+        goto cleanup;
+    }
+    for(int leaf=0; leaf<2; leaf++) {
+        rva_node* node = &pt.nodes[leaf];
+
+        node->low = node->high = NODEI_NONE;
+        node->rva.var[0] = '0'+leaf;
+        node->rva.var[1] = 0;
+        node->rva.val    = -1;
+        pt.owner[leaf]   = -1;
+    }
+    pt.n_nodes = 2;
+    if ( !prob_table_rehash(&pt,256,_errmsg) )
+        goto cleanup;
+    for(int k=0; k<n; k++) { // hash-cons the nodes of all bdd's
+        bdd* b = bdds[k];
+
+        if ( !b )
+            continue;
+        for(nodei i=0; i<BDD_TREESIZE(b); i++) {
+            rva_node* node = BDD_NODE(b,i);
+
+            if ( IS_LEAF(node) )
+                map[i] = LEAF_BOOLVALUE(node);
+            else {
+                rva_node key = *node;
+
+                key.low  = map[node->low];
+                key.high = map[node->high];
+                if ( (map[i] = prob_table_node(&pt,k,&key,_errmsg)) == NODEI_NONE )
+                    goto cleanup;
+            }
+        }
+        roots[k] = map[BDD_ROOT(b)];
+    }
+    if ( !(prob = (double*)MALLOC(pt.n_nodes*sizeof(double))) ||
+         !(sr = (prob_sr*)MALLOC(pt.n_nodes*sizeof(prob_sr))) ) {
+        pg_error(_errmsg,"bdd_probability_vector: malloc fails");
+        goto cleanup;
+    }
+    if ( (n_missing = nodes_bind_probabilities(dict,pt.nodes,pt.n_nodes,NULL,prob,missing,_errmsg)) != 0 ) {
+        if ( n_missing > 0 )
+            pg_error(_errmsg,"dictionary_lookup: rva[%s] not found.",missing->buffer);
+        goto cleanup;
+    }
+    // every node in the table is reachable from a root, step all of them
+    prob_sr_bind(pt.nodes,pt.n_nodes,prob,sr);
+    for(nodei i=0; i<pt.n_nodes; i++) {
+        prob_sr_step(pt.nodes,sr,i);
+        if ( sr[i].val < 0.0 || sr[i].val > 1.0 ) {
+            bdd_probability_error(bdds[pt.owner[i]],sr[i].val,_errmsg);
+            goto cleanup;
+        }
+    }
+    for(int k=0; k<n; k++)
+        if ( bdds[k] )
+            res[k] = sr[roots[k]].val;
+    ok = BDD_OK;
+cleanup:
+    pbuff_free(missing);
+    if ( map )      FREE(map);
+    if ( roots )    FREE(roots);
+    if ( prob )     FREE(prob);
+    if ( sr )       FREE(sr);
+    if ( pt.nodes ) FREE(pt.nodes);
+    if ( pt.owner ) FREE(pt.owner);
+    if ( pt.hash )  FREE(pt.hash);
+    return ok;
+}
+
+/*
+ * Probability of one bdd with k dictionaries (scenarios). The bdd is walked
+ * once, every node carries a vector of k probabilities, one lane per
+ * scenario. The structure of the pass (reachability and the E of a chain)
+ * does not depend on the probabilities, only S/M/P are computed per lane
+ * with the formulas above. The lanes are computed with AVX2 (4 doubles) or
+ * SSE2 (2 doubles) when the compiler targets them, otherwise with a scalar
+ * loop. res[j] is the probability with dicts[j]. This is not a semiring
+ * instance, the semiring type has a fixed size and the number of lanes is
+ * only known per call.
+ */
+
+#if defined(__AVX2__)
+#define PROB_LANES 4
+#elif defined(__SSE2__)
+#define PROB_LANES 2
+#else
+#define PROB_LANES 1
+#endif
+
+static void prob_step_lanes(int K, double* S, double* M, double* P, const double* p, const double* P_high, const double* S_low, const double* M_low, const double* P_E) {
+    int l = 0;
+
+#if defined(__AVX2__)
+    const __m256d one = _mm256_set1_pd(1.0);
+    for(; l<K; l+=4) {
+        __m256d vp = _mm256_loadu_pd(p+l);
+        __m256d vS = _mm256_mul_pd(vp,_mm256_loadu_pd(P_high+l));
+        __m256d vM = vp;
+        if ( S_low ) {
+            vS = _mm256_add_pd(vS,_mm256_loadu_pd(S_low+l));
+            vM = _mm256_add_pd(vM,_mm256_loadu_pd(M_low+l));
+        }
+        _mm256_storeu_pd(S+l,vS);
+        _mm256_storeu_pd(M+l,vM);
+        _mm256_storeu_pd(P+l,_mm256_add_pd(vS,_mm256_mul_pd(_mm256_sub_pd(one,vM),_mm256_loadu_pd(P_E+l))));
+    }
+#elif defined(__SSE2__)
+    const __m128d one = _mm_set1_pd(1.0);
+    for(; l<K; l+=2) {
+        __m128d vp = _mm_loadu_pd(p+l);
+        __m128d vS = _mm_mul_pd(vp,_mm_loadu_pd(P_high+l));
+        __m128d vM = vp;
+        if ( S_low ) {
+            vS = _mm_add_pd(vS,_mm_loadu_pd(S_low+l));
+            vM = _mm_add_pd(vM,_mm_loadu_pd(M_low+l));
+        }
+        _mm_storeu_pd(S+l,vS);
+        _mm_storeu_pd(M+l,vM);
+        _mm_storeu_pd(P+l,_mm_add_pd(vS,_mm_mul_pd(_mm_sub_pd(one,vM),_mm_loadu_pd(P_E+l))));
+    }
+#endif
+    for(; l<K; l++) {
+        S[l] = p[l] * P_high[l] + (S_low ? S_low[l] : 0.0);
+        M[l] = p[l]             + (S_low ? M_low[l] : 0.0);
+        P[l] = S[l] + (1.0 - M[l]) * P_E[l];
+    }
+}
+
+int bdd_probability_scenarios(bdd_dictionary** dicts, int k, bdd* bdd, double* res, char** _errmsg) {
+    nodei   n    = BDD_TREESIZE(bdd);
+    nodei   root = BDD_ROOT(bdd);
+    int     K    = ((k+PROB_LANES-1)/PROB_LANES)*PROB_LANES; // lanes padded
+    double *prob, *S, *M, *P;
+    nodei  *E;
+    int     ok   = BDD_FAIL;
+
+    if ( k <= 0 )
+        return BDD_OK;
+    if ( !(prob = (double*)MALLOC(4*(size_t)n*K*sizeof(double) + n*sizeof(nodei))) )
+        return pg_error(_errmsg,"bdd_probability_scenarios: malloc fails");
+    S    = prob + (size_t)n*K;
+    M    = S    + (size_t)n*K;
+    P    = M    + (size_t)n*K;
+    E    = (nodei*)(P + (size_t)n*K);
+    // bind all dictionaries at once, one lane per scenario
+    memset(prob,0,(size_t)n*K*sizeof(double));
+    if ( !bdd_bind_probabilities_k(dicts,k,bdd,prob,K,_errmsg) )
+        goto cleanup;
+    for(nodei i=0; i<root; i++)
+        E[i] = PROB_UNREACHED;
+    E[root] = PROB_REACHED;
+    for(nodei i=root; i>=0; i--) {
+        rva_node* n_i = BDD_NODE(bdd,i);
+        if ( (E[i] == PROB_REACHED) && !IS_LEAF(n_i) )
+            E[n_i->low] = E[n_i->high] = PROB_REACHED;
+    }
+    for(nodei i=0; i<=root; i++) {
+        rva_node* n_i = BDD_NODE(bdd,i);
+        size_t    o   = (size_t)i*K;
+
+        if ( E[i] == PROB_UNREACHED )
+            continue;
+        if ( IS_LEAF(n_i) ) {
+            for(int l=0; l<K; l++) {
+                P[o+l] = S[o+l] = LEAF_BOOLVALUE(n_i) ? 1.0 : 0.0;
+                M[o+l] = 0.0;
+            }
+            E[i] = i;
+        } else {
+            rva_node* n_low   = BDD_NODE(bdd,n_i->low);
+            int       samevar = !IS_LEAF(n_low) && IS_SAMEVAR(&n_low->rva,&n_i->rva);
+            size_t    o_low   = (size_t)n_i->low*K;
+
+            if ( IS_SAMEVAR(BDD_RVA(bdd,n_i->high),&n_i->rva) ) {
+                pg_error(_errmsg,"probabilty_alg: unexpected var \'%s\' high branch",n_i->rva.var);
+                goto cleanup;
+            }
+            E[i] = samevar ? E[n_i->low] : n_i->low;
+            prob_step_lanes(K,S+o,M+o,P+o,prob+o,P+(size_t)n_i->high*K,
+                            samevar ? S+o_low : NULL,M+o_low,P+(size_t)E[i]*K);
+            for(int l=0; l<k; l++) {
+                if ( P[o+l] < 0.0 || P[o+l] > 1.0 ) {
+                    bdd_probability_error(bdd,P[o+l],_errmsg);
+                    goto cleanup;
+                }
+            }
+        }
+    }
+    for(int j=0; j<k; j++)
+        res[j] = P[(size_t)root*K+j];
+    ok = BDD_OK;
+cleanup:
+    FREE(prob);
+    return ok;
+}
+
+/*
+ * Sensitivity of the probability of a bdd for all its rva's in one forward
+ * and one backward pass. The forward pass is bdd_probability_pass(), the
+ * backward pass is prob_sr_adjoint() (see bdd.h), node i is finished before
+ * its children. p_i is the lit of node i and is subtracted from the rest of
+ * i and of the nodes above i in its chain, so
+ *
+ *      ap(i) = adj(i).lit - (adj(i).rest + adj(parents in the chain).rest)
+ *
+ * and dP/dp(rva) is the sum of ap(i) over the nodes with rva. Because a var
+ * occurs in at most one chain on every path P is affine in the probabilities
+ * of the values of a var x: P = B + sum(p_v*dP/dp_v) with B the probability
+ * when x has none of the values in the bdd. So P(f|x=v) = B + dP/dp_v and the
+ * Banzhaf value P(f|x=v) - P(f|x!=v) = (P(f|x=v) - P)/(1-p_v). When p_v is 1
+ * x!=v is impossible and the derivative is used. Returns a MALLOC'ed array
+ * of *n entries ordered on rva, *P is set to the probability of bdd.
+ */
+bdd_sensitivity* bdd_probability_gradient(bdd_dictionary* dict, bdd* bdd, int* n, double* P, char** _errmsg) {
+    nodei            sz = BDD_TREESIZE(bdd);
+    prob_sr*         sr;
+    prob_sr_adj*     adj;
+    double          *prob, *ap;
+    node_ref*        refs  = NULL;
+    bdd_sensitivity* res   = NULL;
+    int              n_refs = 0, n_res = 0, ok = 0;
+    double           p_root;
+
+    *n = 0;
+    if ( !(sr = (prob_sr*)MALLOC(sz*(sizeof(prob_sr)+sizeof(prob_sr_adj)+2*sizeof(double)))) ) {
+        pg_error(_errmsg,"bdd_probability_gradient: scratch malloc fails");
+        return NULL;
+    }
+    adj  = (prob_sr_adj*)&sr[sz];
+    prob = (double*)&adj[sz];
+    ap   = prob + sz;
+    if ( !bdd_bind_probabilities(dict,bdd,prob,_errmsg) ||
+         ((p_root = bdd_probability_pass(bdd,prob,sr,NULL,0,_errmsg)) < 0.0) )
+        goto cleanup;
+    prob_sr_adjoint(bdd,sr,adj);
+    for(nodei i=BDD_ROOT(bdd); i>=0; i--) {
+        rva_node* n_i = BDD_NODE(bdd,i);
+
+        if ( (sr[i].end == BDD_SR_UNREACHED) || IS_LEAF(n_i) )
+            continue;
+        ap[i] = adj[i].lit - adj[i].rest;
+        if ( !IS_LEAF_I(bdd,n_i->low) && IS_SAMEVAR(BDD_RVA(bdd,n_i->low),&n_i->rva) )
+            adj[n_i->low].rest += adj[i].rest;
+    }
+    if ( !(refs = (node_ref*)MALLOC((sz+1)*sizeof(node_ref))) ||
+         !(res  = (bdd_sensitivity*)MALLOC((sz+1)*sizeof(bdd_sensitivity))) ) {
+        pg_error(_errmsg,"bdd_probability_gradient: malloc fails");
+        goto cleanup;
+    }
+    for(nodei i=0; i<sz; i++) {
+        if ( (sr[i].end != BDD_SR_UNREACHED) && !IS_LEAF_I(bdd,i) ) {
+            refs[n_refs].rva = BDD_RVA(bdd,i);
+            refs[n_refs++].i = i;
+        }
+    }
+    qsort(refs,n_refs,sizeof(node_ref),cmpNodeRef);
+    for(int r=0; r<n_refs; ) {
+        bdd_sensitivity* s = &res[n_res++];
+        int rr;
+
+        s->rva        = *refs[r].rva;
+        s->prob       = prob[refs[r].i];
+        s->derivative = 0.0;
+        for(rr=r; (rr<n_refs) && (cmpRva(refs[rr].rva,refs[r].rva) == 0); rr++)
+            s->derivative += ap[refs[rr].i];
+        r = rr;
+    }
+    for(int v=0; v<n_res; ) { // per var, B = P - sum(p_v*dP/dp_v)
+        double B = p_root;
+        int    vv;
+
+        for(vv=v; (vv<n_res) && IS_SAMEVAR(&res[vv].rva,&res[v].rva); vv++)
+            B -= res[vv].prob * res[vv].derivative;
+        for(; v<vv; v++) {
+            bdd_sensitivity* s = &res[v];
+
+            s->cond    = B + s->derivative;
+            s->banzhaf = (s->prob < 1.0) ? (s->cond - p_root)/(1.0 - s->prob) : s->derivative;
+        }
+    }
+    *n = n_res;
+    if ( P )
+        *P = p_root;
+    ok = 1;
+cleanup:
+    if ( refs ) FREE(refs);
+    FREE(sr);
+    if ( res && !ok ) {
+        FREE(res);
+        res = NULL;
+    }
+    return res;
+}
+
+/*
+ * Most probable worlds of a bdd. A world assigns one value of the dictionary
+ * to every var in the support of the bdd, its probability is the product of
+ * these value probabilities. The k best worlds are computed by a k-best
+ * dynamic program over states (L,c): the vars from level L on (the sorted
+ * support) when the bdd is at node c. A state keeps its k best (prob, value,
+ * child rank) entries:
+ *
+ *  - level(c) > L or c is a leaf: var L is not tested here, every value u
+ *    of var L leads to state (L+1,c)
+ *  - level(c) == L: value u leads to (L+1,high) of the chain node with
+ *    value u or, when the chain does not test u, to (L+1,E)
+ *
+ * mpe is k=1. Worlds are reconstructed one at a time from the entries by
+ * bdd_topk_world(), so the caller streams them without materializing all.
+ */
+
+typedef struct topk_entry {
+    double  prob;
+    nodei   child; // node of the next state, level is L+1
+    int32_t u;     // index of the value of var L
+    int32_t rank;  // rank in the list of the next state
+} topk_entry;
+
+typedef struct topk_state {
+    int32_t count;
+    int32_t first; // index in entries
+} topk_state;
+
+struct bdd_topk {
+    bdd*          bdd;
+    int           k;
+    V_rva         support;
+    int           n_lev;
+    int*          lvl;       // level of node i, n_lev for leafs
+    dict_val**    vals;      // dictionary values of level L
+    int*          card;      // number of values of level L
+    hash_matrix*  G;         // (node,L+1) -> state index
+    topk_state*   states;
+    int           n_states, max_states;
+    topk_entry*   entries;
+    int           n_entries, max_entries;
+    topk_entry*   cand;      // candidate scratch
+    int           root_state;
+};
+
+static int cmpTopkEntry(const void* l, const void* r) {
+    const topk_entry* le = (const topk_entry*)l;
+    const topk_entry* re = (const topk_entry*)r;
+
+    if ( le->prob != re->prob )
+        return (le->prob > re->prob) ? -1 : 1;
+    if ( le->u != re->u )
+        return (le->u < re->u) ? -1 : 1;
+    return (le->rank < re->rank) ? -1 : ((le->rank > re->rank) ? 1 : 0);
+}
+
+/*
+ * Returns the position of var in the sorted support or -1 when not found.
+ */
+static int support_level(V_rva* support, char* var) {
+    rva  key = {.val = -1};
+    rva* found;
+
+    strcpy(key.var,var);
+    if ( !(found = (rva*)bsearch(&key,support->items,support->size,sizeof(rva),(int (*)(const void*,const void*))cmpRva)) )
+        return -1;
+    return (int)(found - support->items);
+}
+
+/*
+ * Returns the node reached from node c when the var of level L has value. When
+ * c does not test level L this is c, otherwise it is the high child of the
+ * node testing value in the chain of c or, when the chain does not test
+ * value, the end of the chain.
+ */
+static nodei value_child(bdd* bdd, int* lvl, nodei c, int L, int value) {
+    rva_node* n_c;
+
+    if ( IS_LEAF_I(bdd,c) || (lvl[c] > L) )
+        return c;
+    for(n_c = BDD_NODE(bdd,c); ; n_c = BDD_NODE(bdd,n_c->low)) {
+        if ( n_c->rva.val == value )
+            return n_c->high;
+        if ( IS_LEAF_I(bdd,n_c->low) || !IS_SAMEVAR(BDD_RVA(bdd,n_c->low),&n_c->rva) )
+            return n_c->low;
+    }
+}
+
+static nodei topk_child(bdd_topk* tk, int L, nodei c, int u) {
+    return value_child(tk->bdd,tk->lvl,c,L,tk->vals[L][u].value);
+}
+
+static int topk_state_of(bdd_topk* tk, int L, nodei c, char** _errmsg) {
+    int         si, n_cand = 0;
+    topk_state* st;
+
+    if ( (si = lookup_G(tk->G,c,L)) != NODEI_NONE )
+        return si;
+    if ( IS_LEAF_I(tk->bdd,c) && !LEAF_BOOLVALUE(BDD_NODE(tk->bdd,c)) ) {
+        // FALSE has no worlds
+    } else if ( L == tk->n_lev ) {
+        tk->cand[n_cand].prob  = 1.0;
+        tk->cand[n_cand].child = NODEI_NONE;
+        tk->cand[n_cand].u     = -1;
+        tk->cand[n_cand].rank  = -1;
+        n_cand++;
+    } else {
+        // resolve the next states first, the recursion reuses tk->cand
+        for(int u=0; u<tk->card[L]; u++)
+            if ( (tk->vals[L][u].prob > 0.0) &&
+                 (topk_state_of(tk,L+1,topk_child(tk,L,c,u),_errmsg) < 0) )
+                return -1;
+        for(int u=0; u<tk->card[L]; u++) {
+            double      p = tk->vals[L][u].prob;
+            nodei       child;
+            topk_state* cst;
+
+            if ( p <= 0.0 )
+                continue;
+            child = topk_child(tk,L,c,u);
+            cst   = &tk->states[lookup_G(tk->G,child,L+1)];
+            for(int r=0; r<cst->count; r++) {
+                topk_entry* e = &tk->cand[n_cand++];
+
+                e->prob  = p * tk->entries[cst->first+r].prob;
+                e->child = child;
+                e->u     = u;
+                e->rank  = r;
+            }
+            if ( n_cand >= tk->k ) { // keep the k best candidates
+                qsort(tk->cand,n_cand,sizeof(topk_entry),cmpTopkEntry);
+                n_cand = tk->k;
+            }
+        }
+        qsort(tk->cand,n_cand,sizeof(topk_entry),cmpTopkEntry);
+    }
+    if ( tk->n_states == tk->max_states ) {
+        topk_state* states;
+
+        if ( !(states = (topk_state*)REALLOC(tk->states,2*tk->max_states*sizeof(topk_state))) ) {
+            pg_error(_errmsg,"bdd_topk: realloc fails");
+            return -1;
+        }
+        tk->states      = states;
+        tk->max_states *= 2;
+    }
+    while ( tk->n_entries + n_cand > tk->max_entries ) {
+        topk_entry* entries;
+
+        if ( !(entries = (topk_entry*)REALLOC(tk->entries,2*tk->max_entries*sizeof(topk_entry))) ) {
+            pg_error(_errmsg,"bdd_topk: realloc fails");
+            return -1;
+        }
+        tk->entries      = entries;
+        tk->max_entries *= 2;
+    }
+    si        = tk->n_states++;
+    st        = &tk->states[si];
+    st->count = n_cand;
+    st->first = tk->n_entries;
+    memcpy(&tk->entries[tk->n_entries],tk->cand,n_cand*sizeof(topk_entry));
+    tk->n_entries += n_cand;
+    if ( !(tk->G = store_G(tk->G,c,L,si,_errmsg)) )
+        return -1;
+    return si;
+}
+
+void bdd_topk_free(bdd_topk* tk) {
+    V_rva_free(&tk->support);
+    if ( tk->lvl )     FREE(tk->lvl);
+    if ( tk->vals )    FREE(tk->vals);
+    if ( tk->card )    FREE(tk->card);
+    if ( tk->G )       FREE(tk->G);
+    if ( tk->states )  FREE(tk->states);
+    if ( tk->entries ) FREE(tk->entries);
+    if ( tk->cand )    FREE(tk->cand);
+    FREE(tk);
+}
+
+bdd_topk* bdd_topk_create(bdd_dictionary* dict, bdd* bdd, int k, char** _errmsg) {
+    bdd_topk* tk;
+    int       max_card = 1;
+
+    if ( k < 1 ) {
+        pg_error(_errmsg,"bdd_topk: k must be positive (%d)",k);
+        return NULL;
+    }
+    if ( !(tk = (bdd_topk*)MALLOC(sizeof(bdd_topk))) ) {
+        pg_error(_errmsg,"bdd_topk: malloc fails");
+        return NULL;
+    }
+    memset(tk,0,sizeof(bdd_topk));
+    V_rva_init(&tk->support);
+    tk->bdd = bdd;
+    tk->k   = k;
+    if ( !bdd_support(bdd,&tk->support,_errmsg) )
+        goto error;
+    tk->n_lev = tk->support.size;
+    if ( !(tk->lvl  = (int*)MALLOC(BDD_TREESIZE(bdd)*sizeof(int))) ||
+         !(tk->vals = (dict_val**)MALLOC((tk->n_lev+1)*sizeof(dict_val*))) ||
+         !(tk->card = (int*)MALLOC((tk->n_lev+1)*sizeof(int))) ) {
+        pg_error(_errmsg,"bdd_topk: malloc fails");
+        goto error;
+    }
+    for(int L=0; L<tk->n_lev; L++) {
+        if ( !(tk->vals[L] = lookup_var_values(dict,tk->support.items[L].var,&tk->card[L])) ) {
+            pg_error(_errmsg,"dictionary_lookup: var \'%s\' not found",tk->support.items[L].var);
+            goto error;
+        }
+        if ( tk->card[L] > max_card )
+            max_card = tk->card[L];
+    }
+    for(nodei i=0; i<BDD_TREESIZE(bdd); i++) {
+        rva_node* node = BDD_NODE(bdd,i);
+
+        if ( IS_LEAF(node) )
+            tk->lvl[i] = tk->n_lev;
+        else {
+            tk->lvl[i] = support_level(&tk->support,node->rva.var);
+            if ( IS_SAMEVAR(BDD_RVA(bdd,node->high),&node->rva) ) {
+                pg_error(_errmsg,"probabilty_alg: unexpected var \'%s\' high branch",node->rva.var);
+                goto error;
+            }
+        }
+    }
+    tk->max_states  = 64;
+    tk->max_entries = 64;
+    if ( !(tk->G       = create_G(BDD_TREESIZE(bdd),tk->n_lev+1,_errmsg)) ||
+         !(tk->states  = (topk_state*)MALLOC(tk->max_states*sizeof(topk_state))) ||
+         !(tk->entries = (topk_entry*)MALLOC(tk->max_entries*sizeof(topk_entry))) ||
+         !(tk->cand    = (topk_entry*)MALLOC((k+1)*max_card*sizeof(topk_entry))) ) {
+        pg_error(_errmsg,"bdd_topk: malloc fails");
+        goto error;
+    }
+    if ( (tk->root_state = topk_state_of(tk,0,BDD_ROOT(bdd),_errmsg)) < 0 )
+        goto error;
+    return tk;
+error:
+    bdd_topk_free(tk);
+    return NULL;
+}
+
+int bdd_topk_count(bdd_topk* tk) {
+    return tk->states[tk->root_state].count;
+}
+
+/*
+ * Set world to the r-th best world (r < bdd_topk_count()) and return its
+ * probability.
+ */
+double bdd_topk_world(bdd_topk* tk, int r, V_rva* world, char** _errmsg) {
+    topk_state* st    = &tk->states[tk->root_state];
+    double      prob  = tk->entries[st->first+r].prob;
+    nodei       c     = BDD_ROOT(tk->bdd);
+
+    V_rva_reset(world);
+    for(int L=0; L<tk->n_lev; L++) {
+        topk_entry* e = &tk->entries[st->first+r];
+        rva         a;
+
+        strcpy(a.var,tk->support.items[L].var);
+        a.val = tk->vals[L][e->u].value;
+        if ( V_rva_add(world,&a) < 0 ) {
+            pg_error(_errmsg,"bdd_topk_world: add fails");
+            return -1.0;
+        }
+        c  = e->child;
+        r  = e->rank;
+        st = &tk->states[lookup_G(tk->G,c,L+1)];
+    }
+    return prob;
+}
+
+/*
+ * Probability of the most probable world of a bdd, the semiring pass in
+ * (max,*). The weights of var x are divided by m(x), the max probability of
+ * a value of x, so a var skipped on an edge has weight 1 (its best value).
+ * lit is p_v/m(x) and rest is the best value of x not in the chain from the
+ * node down divided by m(x). The result is val(root) times m(x) of all vars
+ * in the support, the probability of the first world of bdd_topk_create()
+ * with k=1 without the k-best states.
+ *
+ * The values of every var of the support are sorted once on descending
+ * probability (byp) and on value (byv). A chain is bound bottom up, every
+ * node marks its value and the best unmarked value is the rest, so a chain
+ * costs its length and not its length times the domain of the var.
+ */
+typedef struct mpe_val {
+    double prob;
+    int    value;
+    int    pos;   // position in byp
+} mpe_val;
+
+typedef struct mpe_var {
+    mpe_val* byp;
+    mpe_val* byv;
+    char*    mark; // values in the chain, by position in byp
+    int      card;
+} mpe_var;
+
+static int cmpMpeProb(const void* l, const void* r) {
+    const mpe_val* lv = (const mpe_val*)l;
+    const mpe_val* rv = (const mpe_val*)r;
+
+    if ( lv->prob != rv->prob )
+        return (lv->prob > rv->prob) ? -1 : 1;
+    return (lv->value < rv->value) ? -1 : ((lv->value > rv->value) ? 1 : 0);
+}
+
+static int cmpMpeValue(const void* l, const void* r) {
+    const mpe_val* lv = (const mpe_val*)l;
+    const mpe_val* rv = (const mpe_val*)r;
+
+    return (lv->value < rv->value) ? -1 : ((lv->value > rv->value) ? 1 : 0);
+}
+
+static void mpe_bind_chain(bdd* bdd, mpe_var* mv, nodei* chain, int n_chain, double* prob, maxp_sr* sr) {
+    double m   = (mv->card > 0) ? mv->byp[0].prob : 0.0;
+    int    ptr = 0;
+
+    for(int c=n_chain-1; c>=0; c--) {
+        mpe_val  key = {.value = BDD_RVA(bdd,chain[c])->val};
+        mpe_val* found;
+
+        if ( (found = (mpe_val*)bsearch(&key,mv->byv,mv->card,sizeof(mpe_val),cmpMpeValue)) )
+            mv->mark[found->pos] = 1;
+        while ( (ptr < mv->card) && mv->mark[ptr] )
+            ptr++;
+        if ( m > 0.0 ) {
+            sr[chain[c]].lit  = prob[chain[c]] / m;
+            sr[chain[c]].rest = (ptr < mv->card) ? mv->byp[ptr].prob / m : 0.0;
+        } else
+            sr[chain[c]].lit = sr[chain[c]].rest = 0.0;
+    }
+    for(int c=0; c<n_chain; c++) { // unmark, the next chain starts clean
+        mpe_val  key = {.value = BDD_RVA(bdd,chain[c])->val};
+        mpe_val* found;
+
+        if ( (found = (mpe_val*)bsearch(&key,mv->byv,mv->card,sizeof(mpe_val),cmpMpeValue)) )
+            mv->mark[found->pos] = 0;
+    }
+}
+
+double bdd_probability_mpe(bdd_dictionary* dict, bdd* bdd, char** _errmsg) {
+    nodei    sz = BDD_TREESIZE(bdd);
+    maxp_sr* sr;
+    double*  prob;
+    nodei*   chain;
+    char*    done;
+    V_rva    support;
+    mpe_var* vars = NULL;
+    mpe_val* vbuf = NULL;
+    char*    mbuf = NULL;
+    int      n_vals = 0;
+    double   res = -1.0, M = 1.0;
+
+    if ( !(sr = (maxp_sr*)MALLOC(sz*(sizeof(maxp_sr)+sizeof(double)+sizeof(nodei)+sizeof(char)))) ) {
+        pg_error(_errmsg,"bdd_probability_mpe: scratch malloc fails");
+        return -1.0;
+    }
+    prob  = (double*)&sr[sz];
+    chain = (nodei*)&prob[sz];
+    done  = (char*)&chain[sz];
+    memset(done,0,sz);
+    V_rva_init(&support);
+    if ( !bdd_bind_probabilities(dict,bdd,prob,_errmsg) || !bdd_support(bdd,&support,_errmsg) )
+        goto cleanup;
+    if ( !(vars = (mpe_var*)MALLOC((support.size+1)*sizeof(mpe_var))) ) {
+        pg_error(_errmsg,"bdd_probability_mpe: malloc fails");
+        goto cleanup;
+    }
+    for(int v=0; v<support.size; v++) {
+        if ( !lookup_var_values(dict,support.items[v].var,&vars[v].card) ) {
+            pg_error(_errmsg,"dictionary_lookup: var \'%s\' not found",support.items[v].var);
+            goto cleanup;
+        }
+        n_vals += vars[v].card;
+    }
+    if ( !(vbuf = (mpe_val*)MALLOC((2*n_vals+1)*sizeof(mpe_val))) || !(mbuf = (char*)MALLOC(n_vals+1)) ) {
+        pg_error(_errmsg,"bdd_probability_mpe: malloc fails");
+        goto cleanup;
+    }
+    memset(mbuf,0,n_vals+1);
+    for(int v=0, o=0; v<support.size; v++) {
+        mpe_var*  mv   = &vars[v];
+        dict_val* vals = lookup_var_values(dict,support.items[v].var,&mv->card);
+
+        mv->byp  = &vbuf[2*o];
+        mv->byv  = &vbuf[2*o+mv->card];
+        mv->mark = &mbuf[o];
+        o       += mv->card;
+        for(int u=0; u<mv->card; u++) {
+            mv->byp[u].prob  = vals[u].prob;
+            mv->byp[u].value = vals[u].value;
+        }
+        qsort(mv->byp,mv->card,sizeof(mpe_val),cmpMpeProb);
+        for(int u=0; u<mv->card; u++)
+            mv->byp[u].pos = u;
+        memcpy(mv->byv,mv->byp,mv->card*sizeof(mpe_val));
+        qsort(mv->byv,mv->card,sizeof(mpe_val),cmpMpeValue);
+        M *= (mv->card > 0) ? mv->byp[0].prob : 0.0;
+    }
+    // parents come after their children, so a chain is met at its top first
+    for(nodei i=sz-1; i>=0; i--) {
+        rva_node* n_i = BDD_NODE(bdd,i);
+        int       n_chain = 0;
+
+        if ( IS_LEAF(n_i) || done[i] )
+            continue;
+        for(nodei c=i; ; c=BDD_NODE(bdd,c)->low) {
+            chain[n_chain++] = c;
+            done[c] = 1;
+            if ( IS_LEAF_I(bdd,BDD_NODE(bdd,c)->low) || !IS_SAMEVAR(BDD_RVA(bdd,BDD_NODE(bdd,c)->low),&n_i->rva) )
+                break;
+        }
+        mpe_bind_chain(bdd,&vars[support_level(&support,n_i->rva.var)],chain,n_chain,prob,sr);
+    }
+    res = maxp_sr_pass(bdd,sr) * M;
+cleanup:
+    V_rva_free(&support);
+    if ( vars ) FREE(vars);
+    if ( vbuf ) FREE(vbuf);
+    if ( mbuf ) FREE(mbuf);
+    FREE(sr);
+    return res;
+}
+
+/*
+ * Number of worlds over the support of a bdd in which the bdd is true. The
+ * domain of a var are its values in dict or, when dict is NULL, its values
+ * in the bdd plus one value for all others. The count is the semiring pass
+ * in (+,*) over int64_t without normalized weights, the vars skipped on an
+ * edge are counted by the product of their domain sizes gap(L,M) of the
+ * levels between L and M:
+ *
+ *      lit(i)  = gap(level(i),level(high))
+ *      rest(i) = (card - values in chain) * gap(level(i),level(end))
+ *
+ * A negative count is an overflow, it propagates through plus and times.
+ * Returns the count or -1 on error, also when it does not fit in an int64.
+ */
+
+static int64_t count_plus(int64_t a, int64_t b) {
+    int64_t r;
+
+    return ((a < 0) || (b < 0) || __builtin_add_overflow(a,b,&r)) ? -1 : r;
+}
+
+static int64_t count_times(int64_t a, int64_t b) {
+    int64_t r;
+
+    return ((a < 0) || (b < 0) || __builtin_mul_overflow(a,b,&r)) ? -1 : r;
+}
+
+DefBddSemiringH(count,int64_t)
+DefBddSemiringC(count,int64_t,0,1,count_plus,count_times)
+
+// suf[L] is the product of card of the levels from L on, -1 on overflow
+static int64_t count_gap(int* card, int64_t* suf, int L, int M) {
+    int64_t g = 1;
+
+    if ( (suf[L+1] >= 0) && (suf[M] > 0) )
+        return suf[L+1] / suf[M];
+    for(int l=L+1; l<M; l++)
+        g = count_times(g,card[l]);
+    return g;
+}
+
+int64_t bdd_count_worlds(bdd_dictionary* dict, bdd* bdd, char** _errmsg) {
+    nodei    sz = BDD_TREESIZE(bdd), root = BDD_ROOT(bdd);
+    count_sr *sr;
+    int      *lvl, *card = NULL;
+    int64_t  *suf = NULL, res = -1;
+    double   *prob;
+    V_rva    support, values;
+
+    if ( !(sr = (count_sr*)MALLOC(sz*(sizeof(count_sr)+sizeof(int)+sizeof(double)))) ) {
+        pg_error(_errmsg,"bdd_count_worlds: scratch malloc fails");
+        return -1;
+    }
+    prob = (double*)&sr[sz];
+    lvl  = (int*)&prob[sz];
+    V_rva_init(&support);
+    V_rva_init(&values);
+    if ( !bdd_support(bdd,&support,_errmsg) )
+        goto cleanup;
+    if ( dict && !bdd_bind_probabilities(dict,bdd,prob,_errmsg) )
+        goto cleanup; // rva's not in the domain
+    if ( !(card = (int*)MALLOC((support.size+1)*sizeof(int))) ||
+         !(suf  = (int64_t*)MALLOC((support.size+1)*sizeof(int64_t))) ) {
+        pg_error(_errmsg,"bdd_count_worlds: malloc fails");
+        goto cleanup;
+    }
+    for(int L=0; L<support.size; L++) {
+        if ( dict ) {
+            if ( !lookup_var_values(dict,support.items[L].var,&card[L]) ) {
+                pg_error(_errmsg,"dictionary_lookup: var \'%s\' not found",support.items[L].var);
+                goto cleanup;
+            }
+        } else
+            card[L] = 1; // the other values, the values in the bdd are added below
+    }
+    for(nodei i=0; i<sz; i++) {
+        lvl[i] = IS_LEAF_I(bdd,i) ? support.size : support_level(&support,BDD_RVA(bdd,i)->var);
+        if ( !dict && !IS_LEAF_I(bdd,i) && (V_rva_add(&values,BDD_RVA(bdd,i)) < 0) ) {
+            pg_error(_errmsg,"bdd_count_worlds: add fails");
+            goto cleanup;
+        }
+    }
+    V_rva_quicksort(&values,cmpRva);
+    for(int v=0; v<values.size; v++)
+        if ( (v == 0) || (cmpRva(&values.items[v],&values.items[v-1]) != 0) )
+            card[support_level(&support,values.items[v].var)]++;
+    suf[support.size] = 1;
+    for(int L=support.size-1; L>=0; L--)
+        suf[L] = count_times(card[L],suf[L+1]);
+    // chain length in rest and the end of the chain in end, then the weights
+    for(nodei i=0; i<sz; i++) {
+        rva_node* n_i = BDD_NODE(bdd,i);
+
+        if ( IS_LEAF(n_i) )
+            continue;
+        if ( !IS_LEAF_I(bdd,n_i->low) && IS_SAMEVAR(BDD_RVA(bdd,n_i->low),&n_i->rva) ) {
+            sr[i].rest = sr[n_i->low].rest + 1;
+            sr[i].end  = sr[n_i->low].end;
+        } else {
+            sr[i].rest = 1;
+            sr[i].end  = n_i->low;
+        }
+    }
+    for(nodei i=0; i<sz; i++) {
+        rva_node* n_i = BDD_NODE(bdd,i);
+
+        if ( IS_LEAF(n_i) )
+            continue;
+        sr[i].lit  = count_gap(card,suf,lvl[i],lvl[n_i->high]);
+        sr[i].rest = count_times(card[lvl[i]] - sr[i].rest,count_gap(card,suf,lvl[i],lvl[sr[i].end]));
+    }
+    if ( (res = count_times(count_gap(card,suf,-1,lvl[root]),count_sr_pass(bdd,sr))) < 0 )
+        pg_error(_errmsg,"bdd_count_worlds: number of worlds does not fit in a bigint");
+cleanup:
+    if ( card ) FREE(card);
+    if ( suf )  FREE(suf);
+    V_rva_free(&support);
+    V_rva_free(&values);
+    FREE(sr);
+    return res;
+}
+
+/*
+ * Streams the paths from the root to the TRUE leaf of a bdd, one at a time
+ * by a depth first walk with an explicit stack, high edges first. A path is
+ * a partial assignment, high edges are x=v and low edges !x=v when the path
+ * leaves the chain of x, the paths are disjoint and together are the bdd.
+ * Every node except the FALSE leaf reaches the TRUE leaf, so between two
+ * paths the walk only visits one FALSE leaf per step back. The memory is the
+ * stack, at most the size of the bdd.
+ */
+
+struct bdd_paths {
+    bdd*   bdd;
+    int    depth;
+    int    started;
+    nodei* node;
+    char*  high; // 1 while high branch of node is walked
+};
+
+bdd_paths* bdd_paths_create(bdd* bdd, char** _errmsg) {
+    bdd_paths* p;
+
+    if ( !(p = (bdd_paths*)MALLOC(sizeof(bdd_paths)+BDD_TREESIZE(bdd)*(sizeof(nodei)+sizeof(char)))) ) {
+        pg_error(_errmsg,"bdd_paths: malloc fails");
+        return NULL;
+    }
+    p->bdd     = bdd;
+    p->depth   = 0;
+    p->started = 0;
+    p->node    = (nodei*)&p[1];
+    p->high    = (char*)&p->node[BDD_TREESIZE(bdd)];
+    return p;
+}
+
+void bdd_paths_free(bdd_paths* p) {
+    FREE(p);
+}
+
+// continue the walk with the low branch of the deepest high edge
+static nodei paths_backtrack(bdd_paths* p) {
+    while ( p->depth > 0 ) {
+        int t = p->depth - 1;
+
+        if ( p->high[t] ) {
+            p->high[t] = 0;
+            return BDD_NODE(p->bdd,p->node[t])->low;
+        }
+        p->depth--;
+    }
+    return NODEI_NONE;
+}
+
+static void paths2string(bdd_paths* p, pbuff* pbuff) {
+    int n = 0;
+
+    for(int t=0; t<p->depth; t++) {
+        rva* r = BDD_RVA(p->bdd,p->node[t]);
+
+        if ( !p->high[t] ) { // implied when the chain ends in a high edge
+            int u;
+
+            for(u=t+1; (u<p->depth) && IS_SAMEVAR(BDD_RVA(p->bdd,p->node[u]),r) && !p->high[u]; u++)
+                ;
+            if ( (u<p->depth) && IS_SAMEVAR(BDD_RVA(p->bdd,p->node[u]),r) )
+                continue;
+        }
+        bprintf(pbuff,"%s%s%s=%d",(n++ ? "&" : ""),(p->high[t] ? "" : "!"),r->var,r->val);
+    }
+    if ( n == 0 )
+        bprintf(pbuff,"1"); // the empty conjunction
+}
+
+/*
+ * Adds the next path to pbuff, returns 0 when all paths are done.
+ */
+int bdd_paths_next(bdd_paths* p, pbuff* pbuff) {
+    nodei c;
+
+    if ( p->started && (p->depth == 0) )
+        return 0;
+    c = p->started ? paths_backtrack(p) : BDD_ROOT(p->bdd);
+    p->started = 1;
+    while ( c != NODEI_NONE ) {
+        rva_node* n = BDD_NODE(p->bdd,c);
+
+        if ( IS_LEAF(n) ) {
+            if ( LEAF_BOOLVALUE(n) ) {
+                paths2string(p,pbuff);
+                return 1;
+            }
+            c = paths_backtrack(p);
+        } else {
+            p->node[p->depth]   = c;
+            p->high[p->depth++] = 1;
+            c = n->high;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Conditional probability P(a|b) = P(a&b)/P(b) in one walk over the product
+ * of a and b, without building the bdd of a&b. The levels are the sorted
+ * union of the supports, a state (ca,cb) is at the smallest level L tested
+ * by ca or cb and
+ *
+ *     P(ca & cb) = sum over values v of L: p(v) * P(child_a(v) & child_b(v))
+ *
+ * where only the values tested in the chains of ca and cb are visited, the
+ * other values all go to the chain ends with the remaining probability mass.
+ * P(b) is the same walk with a replaced by a virtual TRUE node, so both
+ * share the computed table.
+ */
+
+typedef struct cond_walk {
+    bdd*          a;
+    bdd*          b;
+    nodei         true_a;  // virtual TRUE node of a
+    V_rva         support; // union of the supports of a and b
+    int*          lvl_a;
+    int*          lvl_b;
+    dict_val**    vals;
+    int*          card;
+    hash_matrix*  G;       // (ca,cb) -> index in P
+    double*       P;
+    int           n_P, max_P;
+} cond_walk;
+
+static int cond_level_a(cond_walk* cw, nodei ca) {
+    return ((ca == cw->true_a) || IS_LEAF_I(cw->a,ca)) ? cw->support.size : cw->lvl_a[ca];
+}
+
+static int cond_value_prob(cond_walk* cw, int L, int value, double* p, char** _errmsg) {
+    for(int u=0; u<cw->card[L]; u++)
+        if ( cw->vals[L][u].value == value ) {
+            *p = cw->vals[L][u].prob;
+            return BDD_OK;
+        }
+    return pg_error(_errmsg,"dictionary_lookup: rva[\'%s=%d\'] not found",cw->support.items[L].var,value);
+}
+
+static double cond_and(cond_walk* cw, nodei ca, nodei cb, char** _errmsg);
+
+static int cond_visit(cond_walk* cw, int L, nodei ca, nodei cb, int value, double* sum, double* mass, char** _errmsg) {
+    double p = 0.0, P;
+
+    if ( !cond_value_prob(cw,L,value,&p,_errmsg) )
+        return BDD_FAIL;
+    if ( ca != cw->true_a )
+        ca = value_child(cw->a,cw->lvl_a,ca,L,value);
+    if ( (P = cond_and(cw,ca,value_child(cw->b,cw->lvl_b,cb,L,value),_errmsg)) < 0.0 )
+        return BDD_FAIL;
+    *sum  += p*P;
+    *mass += p;
+    return BDD_OK;
+}
+
+static nodei cond_chain_end(bdd* bdd, int* lvl, nodei c, int L) {
+    rva_node* n_c;
+
+    if ( IS_LEAF_I(bdd,c) || (lvl[c] > L) )
+        return c;
+    for(n_c = BDD_NODE(bdd,c); !IS_LEAF_I(bdd,n_c->low) && IS_SAMEVAR(BDD_RVA(bdd,n_c->low),&n_c->rva); )
+        n_c = BDD_NODE(bdd,n_c->low);
+    return n_c->low;
+}
+
+static double cond_and(cond_walk* cw, nodei ca, nodei cb, char** _errmsg) {
+    int    la, lb, L, i;
+    double sum = 0.0, mass = 0.0, P;
+
+    if ( (ca != cw->true_a) && IS_LEAF_I(cw->a,ca) && !LEAF_BOOLVALUE(BDD_NODE(cw->a,ca)) )
+        return 0.0;
+    if ( IS_LEAF_I(cw->b,cb) && !LEAF_BOOLVALUE(BDD_NODE(cw->b,cb)) )
+        return 0.0;
+    la = cond_level_a(cw,ca);
+    lb = IS_LEAF_I(cw->b,cb) ? cw->support.size : cw->lvl_b[cb];
+    if ( (la == cw->support.size) && (lb == cw->support.size) )
+        return 1.0;
+    if ( (i = lookup_G(cw->G,ca,cb)) != NODEI_NONE )
+        return cw->P[i];
+    L = (la < lb) ? la : lb;
+    if ( la == L ) {
+        for(nodei n=ca; ; n=bdd_low(cw->a,n)) {
+            if ( !cond_visit(cw,L,ca,cb,BDD_RVA(cw->a,n)->val,&sum,&mass,_errmsg) )
+                return -1.0;
+            if ( IS_LEAF_I(cw->a,bdd_low(cw->a,n)) || !IS_SAMEVAR(BDD_RVA(cw->a,bdd_low(cw->a,n)),BDD_RVA(cw->a,n)) )
+                break;
+        }
+    }
+    if ( lb == L ) {
+        for(nodei n=cb; ; n=bdd_low(cw->b,n)) {
+            int value = BDD_RVA(cw->b,n)->val, tested = 0;
+
+            if ( la == L ) // skip the values visited in the chain of ca
+                for(nodei m=ca; !tested; m=bdd_low(cw->a,m)) {
+                    tested = (BDD_RVA(cw->a,m)->val == value);
+                    if ( IS_LEAF_I(cw->a,bdd_low(cw->a,m)) || !IS_SAMEVAR(BDD_RVA(cw->a,bdd_low(cw->a,m)),BDD_RVA(cw->a,m)) )
+                        break;
+                }
+            if ( !tested && !cond_visit(cw,L,ca,cb,value,&sum,&mass,_errmsg) )
+                return -1.0;
+            if ( IS_LEAF_I(cw->b,bdd_low(cw->b,n)) || !IS_SAMEVAR(BDD_RVA(cw->b,bdd_low(cw->b,n)),BDD_RVA(cw->b,n)) )
+                break;
+        }
+    }
+    if ( mass < 1.0 ) { // all other values of L
+        if ( (P = cond_and(cw,(ca == cw->true_a) ? ca : cond_chain_end(cw->a,cw->lvl_a,ca,L),
+                              cond_chain_end(cw->b,cw->lvl_b,cb,L),_errmsg)) < 0.0 )
+            return -1.0;
+        sum += (1.0-mass)*P;
+    }
+    if ( cw->n_P == cw->max_P ) {
+        double* P_new;
+
+        if ( !(P_new = (double*)REALLOC(cw->P,2*cw->max_P*sizeof(double))) ) {
+            pg_error(_errmsg,"bdd_probability_cond: realloc fails");
+            return -1.0;
+        }
+        cw->P      = P_new;
+        cw->max_P *= 2;
+    }
+    cw->P[cw->n_P] = sum;
+    if ( !(cw->G = store_G(cw->G,ca,cb,cw->n_P++,_errmsg)) )
+        return -1.0;
+    return sum;
+}
+
+/*
+ * Computes P(a&b) and P(b), P(a|b) is *p_ab / *p_b when *p_b > 0.
+ */
+int bdd_probability_cond(bdd_dictionary* dict, bdd* a, bdd* b, double* p_ab, double* p_b, char** _errmsg) {
+    cond_walk cw;
+    V_rva     sb;
+    int       n = 0, res = BDD_FAIL;
+
+    memset(&cw,0,sizeof(cond_walk));
+    cw.a      = a;
+    cw.b      = b;
+    cw.true_a = BDD_TREESIZE(a);
+    V_rva_init(&cw.support);
+    V_rva_init(&sb);
+    if ( !bdd_support(a,&cw.support,_errmsg) || !bdd_support(b,&sb,_errmsg) )
+        goto done;
+    for(int i=0; i<sb.size; i++)
+        if ( V_rva_add(&cw.support,&sb.items[i]) < 0 ) {
+            pg_error(_errmsg,"bdd_probability_cond: add fails");
+            goto done;
+        }
+    V_rva_quicksort(&cw.support,cmpRva);
+    for(int i=0; i<cw.support.size; i++) // merge, remove the doubles
+        if ( (n == 0) || !IS_SAMEVAR(&cw.support.items[i],&cw.support.items[n-1]) )
+            cw.support.items[n++] = cw.support.items[i];
+    cw.support.size = n;
+    if ( !(cw.lvl_a = (int*)MALLOC(BDD_TREESIZE(a)*sizeof(int))) ||
+         !(cw.lvl_b = (int*)MALLOC(BDD_TREESIZE(b)*sizeof(int))) ||
+         !(cw.vals  = (dict_val**)MALLOC((cw.support.size+1)*sizeof(dict_val*))) ||
+         !(cw.card  = (int*)MALLOC((cw.support.size+1)*sizeof(int))) ||
+         !(cw.P     = (double*)MALLOC(64*sizeof(double))) ) {
+        pg_error(_errmsg,"bdd_probability_cond: malloc fails");
+        goto done;
+    }
+    cw.max_P = 64;
+    for(int L=0; L<cw.support.size; L++)
+        if ( !(cw.vals[L] = lookup_var_values(dict,cw.support.items[L].var,&cw.card[L])) ) {
+            pg_error(_errmsg,"dictionary_lookup: var \'%s\' not found",cw.support.items[L].var);
+            goto done;
+        }
+    for(nodei i=0; i<BDD_TREESIZE(a); i++)
+        cw.lvl_a[i] = IS_LEAF_I(a,i) ? cw.support.size : support_level(&cw.support,BDD_RVA(a,i)->var);
+    for(nodei i=0; i<BDD_TREESIZE(b); i++)
+        cw.lvl_b[i] = IS_LEAF_I(b,i) ? cw.support.size : support_level(&cw.support,BDD_RVA(b,i)->var);
+    if ( !(cw.G = create_G(BDD_TREESIZE(a)+1,BDD_TREESIZE(b),_errmsg)) )
+        goto done;
+    if ( ((*p_ab = cond_and(&cw,BDD_ROOT(a),BDD_ROOT(b),_errmsg)) < 0.0) ||
+         ((*p_b  = cond_and(&cw,cw.true_a,BDD_ROOT(b),_errmsg)) < 0.0) )
+        goto done;
+    res = BDD_OK;
+done:
+    if ( cw.lvl_a ) FREE(cw.lvl_a);
+    if ( cw.lvl_b ) FREE(cw.lvl_b);
+    if ( cw.vals )  FREE(cw.vals);
+    if ( cw.card )  FREE(cw.card);
+    if ( cw.P )     FREE(cw.P);
+    if ( cw.G )     FREE(cw.G);
+    V_rva_free(&cw.support);
+    V_rva_free(&sb);
+    return res;
+}
+
+/*
+ * Distribution of the number of true bdd's of n bdd's. Bdd's are grouped in
+ * components of bdd's connected by common variables. Components are
+ * independent so the distribution is the convolution of the component
+ * distributions, for components of one bdd this is the Poisson-binomial dp.
+ * A component with more bdd's is computed exactly by building the bdd's
+ * B[k] = "exactly k of the bdd's so far are true":
+ *
+ *     B'[k] = (B[k] & !f) | (B[k-1] & f)
+ *
+ * and computing P(B[k]), a NULL B[k] is FALSE.
+ */
+
+static int count_find(int* parent, int i) {
+    while ( parent[i] != i )
+        i = parent[i] = parent[parent[i]];
+    return i;
+}
+
+static bdd* count_false2null(bdd* b) {
+    if ( b && IS_LEAF_I(b,BDD_ROOT(b)) && !LEAF_BOOLVALUE(BDD_NODE(b,BDD_ROOT(b))) ) {
+        FREE(b);
+        return NULL;
+    }
+    return b;
+}
+
+static bdd* count_and(bdd* l, bdd* r, char** _errmsg, int* err) {
+    bdd* res;
+
+    if ( !l || !r )
+        return NULL;
+    if ( !(res = bdd_apply('&',l,r,0,_errmsg)) )
+        *err = 1;
+    return count_false2null(res);
+}
+
+/*
+ * Sets dist[0..m] to the count distribution of the m bdd's of a component.
+ */
+static int count_component(bdd_dictionary* dict, bdd** rows, int m, double* dist, char** _errmsg) {
+    bdd** B;
+    int   err = 0;
+
+    if ( !(B = (bdd**)MALLOC((m+1)*sizeof(bdd*))) )
+        return pg_error(_errmsg,"bdd_count_distribution: malloc fails");
+    for(int k=0; k<=m; k++)
+        B[k] = NULL;
+    if ( !(B[0] = create_bdd(BDD_DEFAULT,"1",_errmsg,0)) )
+        err = 1;
+    for(int r=0; (r<m) && !err; r++) {
+        bdd* f  = rows[r];
+        bdd* nf = _bdd_not(f,_errmsg);
+
+        if ( !nf ) {
+            err = 1;
+            break;
+        }
+        for(int k=r+1; (k>=0) && !err; k--) {
+            bdd* t1 = count_and(B[k],nf,_errmsg,&err);
+            bdd* t2 = (k > 0) ? count_and(B[k-1],f,_errmsg,&err) : NULL;
+
+            if ( B[k] )
+                FREE(B[k]);
+            if ( t1 && t2 ) {
+                if ( !(B[k] = bdd_apply('|',t1,t2,0,_errmsg)) )
+                    err = 1;
+                FREE(t1);
+                FREE(t2);
+            } else
+                B[k] = t1 ? t1 : t2;
+        }
+        FREE(nf);
+    }
+    for(int k=0; k<=m; k++) {
+        dist[k] = 0.0;
+        if ( B[k] ) {
+            if ( !err && ((dist[k] = bdd_probability(dict,B[k],NULL,0,_errmsg)) < 0.0) )
+                err = 1;
+            FREE(B[k]);
+        }
+    }
+    FREE(B);
+    return err ? BDD_FAIL : BDD_OK;
+}
+
+/*
+ * Returns the distribution res[0..n] of the number of true bdd's, NULL
+ * entries of bdds are never true.
+ */
+double* bdd_count_distribution(bdd_dictionary* dict, bdd** bdds, int n, char** _errmsg) {
+    V_rva   support, occ; // occ: (var, bdd index) pairs
+    int     *parent = NULL;
+    bdd**   rows = NULL;
+    double  *res = NULL, *comp = NULL, *conv = NULL;
+    int     size = 0, ok = 0;
+
+    V_rva_init(&support);
+    V_rva_init(&occ);
+    if ( !(parent = (int*)MALLOC((n+1)*sizeof(int))) ||
+         !(rows   = (bdd**)MALLOC((n+1)*sizeof(bdd*))) ||
+         !(res    = (double*)MALLOC((n+1)*sizeof(double))) ||
+         !(comp   = (double*)MALLOC((n+1)*sizeof(double))) ||
+         !(conv   = (double*)MALLOC((n+1)*sizeof(double))) ) {
+        pg_error(_errmsg,"bdd_count_distribution: malloc fails");
+        goto done;
+    }
+    for(int i=0; i<n; i++) {
+        parent[i] = i;
+        if ( !bdds[i] )
+            continue;
+        if ( !bdd_support(bdds[i],&support,_errmsg) )
+            goto done;
+        for(int v=0; v<support.size; v++) {
+            rva o = support.items[v];
+
+            o.val = i;
+            if ( V_rva_add(&occ,&o) < 0 ) {
+                pg_error(_errmsg,"bdd_count_distribution: add fails");
+                goto done;
+            }
+        }
+    }
+    V_rva_quicksort(&occ,cmpRva);
+    for(int i=1; i<occ.size; i++)
+        if ( IS_SAMEVAR(&occ.items[i],&occ.items[i-1]) ) {
+            int l = count_find(parent,occ.items[i-1].val);
+            int r = count_find(parent,occ.items[i].val);
+
+            if ( l < r )
+                parent[r] = l;
+            else
+                parent[l] = r;
+        }
+    for(int i=0; i<n; i++) // the root of a component is its smallest member
+        parent[i] = count_find(parent,i);
+    res[0] = 1.0;
+    for(int i=0; i<n; i++) {
+        int m = 0;
+
+        if ( parent[i] != i )
+            continue; // not the first of its component
+        for(int j=i; j<n; j++)
+            if ( (parent[j] == i) && bdds[j] )
+                rows[m++] = bdds[j];
+        if ( m == 0 )
+            continue;
+        if ( m == 1 ) {
+            if ( (comp[1] = bdd_probability(dict,rows[0],NULL,0,_errmsg)) < 0.0 )
+                goto done;
+            comp[0] = 1.0 - comp[1];
+        } else if ( !count_component(dict,rows,m,comp,_errmsg) )
+            goto done;
+        for(int k=0; k<=size+m; k++)
+            conv[k] = 0.0;
+        for(int k=0; k<=size; k++)
+            for(int c=0; c<=m; c++)
+                conv[k+c] += res[k]*comp[c];
+        size += m;
+        memcpy(res,conv,(size+1)*sizeof(double));
+    }
+    for(int k=size+1; k<=n; k++)
+        res[k] = 0.0;
+    ok = 1;
+done:
+    if ( parent ) FREE(parent);
+    if ( rows )   FREE(rows);
+    if ( comp )   FREE(comp);
+    if ( conv )   FREE(conv);
+    V_rva_free(&support);
+    V_rva_free(&occ);
+    if ( !ok && res ) {
+        FREE(res);
+        res = NULL;
+    }
+    return res;
+}
+
+/*
+ * Approximate probability of a bdd or a DNF expression for when the exact
+ * computation takes too long. Both estimators average a [0,1] random
+ * variable X so the Hoeffding bound gives an (epsilon,delta) guarantee with
+ * ln(2/delta)/(2*epsilon^2) samples and a confidence interval for any number
+ * of samples, which makes the estimate anytime when a budget stops it early.
+ *
+ *  - bdd: plain Monte Carlo, X is the bdd evaluated in a sampled world.
+ *  - DNF: Karp-Luby, a clause C_i is drawn with probability P(C_i)/U where
+ *    U = sum P(C_i), a world is drawn given C_i and X is 1 when C_i is the
+ *    first clause true in the world. P = U*E[X] and E[X] >= 1/m for m
+ *    clauses, so by the multiplicative Chernoff bound 3m*ln(2/delta)/eps^2
+ *    samples give a relative guarantee, the estimate is within epsilon*P.
+ *
+ * Values are drawn lazily from the dict_sampler, a var is only drawn when it
+ * is needed in the current sample. The seed is fixed so the same input gives
+ * the same estimate when the budget is not a time limit.
+ */
+
+#define BDD_APPROX_SEED  1973
+#define BDD_APPROX_CHECK 1023 /* check the time limit every 1024 samples */
+
+typedef struct approx_levels {
+    int         n;
+    dict_val**  vals;
+    double**    cum;
+    int*        card;
+    int*        world;  // index of the value drawn for level L
+    int*        stamp;  // sample in which level L was drawn
+} approx_levels;
+
+static void approx_levels_free(approx_levels* al) {
+    if ( al->vals )  FREE(al->vals);
+    if ( al->cum )   FREE(al->cum);
+    if ( al->card )  FREE(al->card);
+    if ( al->world ) FREE(al->world);
+    if ( al->stamp ) FREE(al->stamp);
+}
+
+static int approx_levels_init(approx_levels* al, dict_sampler* ds, V_rva* vars, char** _errmsg) {
+    memset(al,0,sizeof(approx_levels));
+    al->n = vars->size;
+    if ( !(al->vals  = (dict_val**)MALLOC((al->n+1)*sizeof(dict_val*))) ||
+         !(al->cum   = (double**)MALLOC((al->n+1)*sizeof(double*))) ||
+         !(al->card  = (int*)MALLOC((al->n+1)*sizeof(int))) ||
+         !(al->world = (int*)MALLOC((al->n+1)*sizeof(int))) ||
+         !(al->stamp = (int*)MALLOC((al->n+1)*sizeof(int))) ) {
+        approx_levels_free(al);
+        return pg_error(_errmsg,"bdd_probability_approx: malloc fails");
+    }
+    for(int L=0; L<al->n; L++) {
+        if ( !(al->cum[L] = dict_sampler_lookup(ds,vars->items[L].var,&al->card[L],&al->vals[L])) ) {
+            approx_levels_free(al);
+            return pg_error(_errmsg,"dictionary_lookup: var \'%s\' not found",vars->items[L].var);
+        }
+        al->stamp[L] = -1;
+    }
+    return BDD_OK;
+}
+
+static inline int approx_draw(approx_levels* al, int L, int sample, bdd_rng* rng) {
+    if ( al->stamp[L] != sample ) {
+        al->world[L] = dict_sample(al->cum[L],al->card[L],bdd_rng_double(rng));
+        al->stamp[L] = sample;
+    }
+    return al->world[L];
+}
+
+static int approx_check(double epsilon, double delta, char** _errmsg) {
+    if ( !(epsilon > 0.0 && epsilon < 1.0) || !(delta > 0.0 && delta < 1.0) )
+        return pg_error(_errmsg,"prob_approx: epsilon (%f) and delta (%f) must be in (0,1)",epsilon,delta);
+    return BDD_OK;
+}
+
+// without max_samples the number of samples is at most INT_MAX
+static int approx_samples_n(double n, int max_samples) {
+    n = ceil(n);
+
+    if ( n < 1.0 )
+        n = 1.0;
+    if ( (max_samples > 0) && (n > (double)max_samples) )
+        return max_samples;
+    return (n > (double)INT_MAX) ? INT_MAX : (int)n;
+}
+
+static int approx_samples(double epsilon, double delta, int max_samples) {
+    return approx_samples_n(log(2.0/delta)/(2.0*epsilon*epsilon),max_samples);
+}
+
+static int approx_samples_relative(double epsilon, double delta, int m, int max_samples) {
+    return approx_samples_n(3.0*(double)m*log(2.0/delta)/(epsilon*epsilon),max_samples);
+}
+
+static int approx_out_of_time(int sample, clock_t start, int max_ms) {
+    return (max_ms > 0) && ((sample & BDD_APPROX_CHECK) == 0) && (sample > 0) &&
+           ((double)(clock()-start)*1000.0/CLOCKS_PER_SEC >= (double)max_ms);
+}
+
+/*
+ * The estimate scale*mean with its interval. With m > 0 the mean is at least
+ * 1/m and the interval is relative, (1 +- eps)*estimate with the eps of the
+ * number of samples, when eps < 1. Otherwise it is the absolute Hoeffding
+ * interval.
+ */
+static void approx_estimate(bdd_estimate* est, const char* method, long hits, int samples, double scale, int m, double delta) {
+    double mean = (double)hits/(double)samples;
+    double h    = sqrt(log(2.0/delta)/(2.0*(double)samples));
+    double e    = sqrt(3.0*(double)m*log(2.0/delta)/(double)samples);
+    double max  = (scale < 1.0) ? scale : 1.0;
+
+    strcpy(est->method,method);
+    est->samples = samples;
+    est->prob    = scale*mean;
+    if ( (m > 0) && (e < 1.0) ) {
+        est->lower = est->prob*(1.0-e);
+        est->upper = est->prob*(1.0+e);
+    } else {
+        est->lower = scale*(mean-h);
+        est->upper = scale*(mean+h);
+    }
+    if ( est->prob > max )   est->prob  = max;
+    if ( est->lower < 0.0 )  est->lower = 0.0;
+    if ( est->upper > max )  est->upper = max;
+}
+
+static void approx_exact(bdd_estimate* est, double prob) {
+    strcpy(est->method,"exact");
+    est->samples = 0;
+    est->prob    = est->lower = est->upper = prob;
+}
+
+int bdd_probability_approx(dict_sampler* ds, bdd* bdd, double epsilon, double delta, int max_samples, int max_ms, bdd_estimate* est, char** _errmsg) {
+    V_rva         support;
+    approx_levels al;
+    int*          lvl;
+    int           n, s;
+    long          hits = 0;
+    bdd_rng       rng;
+    clock_t       start = clock();
+
+    if ( !approx_check(epsilon,delta,_errmsg) )
+        return BDD_FAIL;
+    if ( IS_LEAF_I(bdd,BDD_ROOT(bdd)) ) {
+        approx_exact(est,(double)LEAF_BOOLVALUE(BDD_NODE(bdd,BDD_ROOT(bdd))));
+        return BDD_OK;
+    }
+    V_rva_init(&support);
+    if ( !bdd_support(bdd,&support,_errmsg) || !approx_levels_init(&al,ds,&support,_errmsg) ) {
+        V_rva_free(&support);
+        return BDD_FAIL;
+    }
+    if ( !(lvl = (int*)MALLOC(BDD_TREESIZE(bdd)*sizeof(int))) ) {
+        approx_levels_free(&al);
+        V_rva_free(&support);
+        return pg_error(_errmsg,"bdd_probability_approx: malloc fails");
+    }
+    for(nodei i=0; i<BDD_TREESIZE(bdd); i++)
+        if ( !IS_LEAF_I(bdd,i) )
+            lvl[i] = support_level(&support,BDD_RVA(bdd,i)->var);
+    bdd_rng_seed(&rng,BDD_APPROX_SEED);
+    n = approx_samples(epsilon,delta,max_samples);
+    for(s=0; (s<n) && !approx_out_of_time(s,start,max_ms); s++) {
+        nodei i = BDD_ROOT(bdd);
+
+        while ( !IS_LEAF_I(bdd,i) ) {
+            rva_node* node = BDD_NODE(bdd,i);
+            int       L    = lvl[i];
+
+            i = (al.vals[L][approx_draw(&al,L,s,&rng)].value == node->rva.val) ? node->high : node->low;
+        }
+        hits += LEAF_BOOLVALUE(BDD_NODE(bdd,i));
+    }
+    approx_estimate(est,"monte carlo",hits,s,1.0,0,delta);
+    FREE(lvl);
+    approx_levels_free(&al);
+    V_rva_free(&support);
+    return BDD_OK;
+}
+
+/*
+ * DNF parsing for the Karp-Luby estimator. Accepts clauses separated by '|',
+ * a clause is a '&' conjunction of rva's, 0 and 1, optionally within
+ * parentheses. Returns 0 when expr is not of this shape.
+ */
+
+typedef struct dnf {
+    V_rva  lits;
+    int    n_clause, max_clause;
+    int*   clause_end; // end of clause c in lits
+} dnf;
+
+static void dnf_free(dnf* f) {
+    V_rva_free(&f->lits);
+    if ( f->clause_end ) FREE(f->clause_end);
+}
+
+#define DNF_SKIP(P) while ( isspace(*(P)) ) (P)++
+
+static int dnf_parse(char* expr, dnf* f) {
+    char* p = expr;
+
+    V_rva_init(&f->lits);
+    f->n_clause   = 0;
+    f->max_clause = 16;
+    if ( !(f->clause_end = (int*)MALLOC(f->max_clause*sizeof(int))) )
+        return 0;
+    for(;;) {
+        int paren = 0, clause_false = 0;
+        int first = f->lits.size;
+
+        DNF_SKIP(p);
+        if ( *p == '(' ) {
+            paren = 1;
+            p++;
+        }
+        for(;;) {
+            DNF_SKIP(p);
+            if ( (*p == '0' || *p == '1') && !isalnum(p[1]) ) {
+                clause_false |= (*p++ == '0');
+            } else if ( isalpha(*p) ) {
+                rva   lit;
+                char* start = p;
+
+                while ( isalnum(*p) )
+                    p++;
+                if ( (p-start) > MAX_RVA_NAME )
+                    return 0;
+                memcpy(lit.var,start,p-start);
+                lit.var[p-start] = 0;
+                DNF_SKIP(p);
+                if ( *p++ != '=' )
+                    return 0;
+                DNF_SKIP(p);
+                if ( !isdigit(*p) )
+                    return 0;
+                lit.val = bdd_atoi(p);
+                while ( isdigit(*p) )
+                    p++;
+                if ( V_rva_add(&f->lits,&lit) < 0 )
+                    return 0;
+            } else
+                return 0;
+            DNF_SKIP(p);
+            if ( *p != '&' )
+                break;
+            p++;
+        }
+        if ( paren ) {
+            if ( *p++ != ')' )
+                return 0;
+            DNF_SKIP(p);
+        }
+        if ( clause_false )
+            f->lits.size = first;
+        else {
+            if ( f->n_clause == f->max_clause ) {
+                int* clause_end;
+
+                if ( !(clause_end = (int*)REALLOC(f->clause_end,2*f->max_clause*sizeof(int))) )
+                    return 0;
+                f->clause_end  = clause_end;
+                f->max_clause *= 2;
+            }
+            f->clause_end[f->n_clause++] = f->lits.size;
+        }
+        if ( *p == 0 )
+            return 1;
+        if ( *p++ != '|' )
+            return 0;
+    }
+}
+
+static int bdd_probability_karp_luby(dict_sampler* ds, dnf* f, double epsilon, double delta, int max_samples, int max_ms, bdd_estimate* est, char** _errmsg) {
+    V_rva         vars;
+    approx_levels al;
+    int           *lit_lvl = NULL, *lit_u = NULL, *first = NULL;
+    double        *ccum = NULL, U = 0.0;
+    int           n_cl = 0, n, s, res = BDD_FAIL;
+    long          hits = 0;
+    bdd_rng       rng;
+    clock_t       start = clock();
+
+    memset(&al,0,sizeof(approx_levels));
+    V_rva_init(&vars);
+    for(int i=0; i<f->lits.size; i++) {
+        rva var = {.val = -1};
+
+        strcpy(var.var,f->lits.items[i].var);
+        if ( V_rva_add(&vars,&var) < 0 ) {
+            pg_error(_errmsg,"bdd_probability_approx: add fails");
+            goto done;
+        }
+    }
+    V_rva_quicksort(&vars,cmpRva);
+    for(int i=0; i<vars.size; i++)
+        if ( (n_cl == 0) || !IS_SAMEVAR(&vars.items[i],&vars.items[n_cl-1]) )
+            vars.items[n_cl++] = vars.items[i];
+    vars.size = n_cl;
+    if ( !approx_levels_init(&al,ds,&vars,_errmsg) )
+        goto done;
+    if ( !(lit_lvl = (int*)MALLOC((f->lits.size+1)*sizeof(int))) ||
+         !(lit_u   = (int*)MALLOC((f->lits.size+1)*sizeof(int))) ||
+         !(first   = (int*)MALLOC((f->n_clause+1)*sizeof(int))) ||
+         !(ccum    = (double*)MALLOC((f->n_clause+1)*sizeof(double))) ) {
+        pg_error(_errmsg,"bdd_probability_approx: malloc fails");
+        goto done;
+    }
+    // sort and dedup the literals of the clauses, drop inconsistent clauses
+    n_cl = 0;
+    for(int c=0, begin=0, o=0; c<f->n_clause; begin=f->clause_end[c++]) {
+        int    end  = f->clause_end[c], keep = o;
+        double prob = 1.0;
+
+        qsort(&f->lits.items[begin],end-begin,sizeof(rva),(int (*)(const void*,const void*))cmpRva);
+        for(int i=begin; i<end; i++) {
+            rva* lit = &f->lits.items[i];
+            int  L   = support_level(&vars,lit->var), u;
+
+            for(u=0; (u<al.card[L]) && (al.vals[L][u].value != lit->val); u++)
+                ;
+            if ( u == al.card[L] ) {
+                pg_error(_errmsg,"dictionary_lookup: rva[\'%s=%d\'] not found",lit->var,lit->val);
+                goto done;
+            }
+            if ( (o > keep) && (lit_lvl[o-1] == L) ) {
+                if ( lit_u[o-1] != u )
+                    prob = 0.0; // var with two values
+                continue;
+            }
+            lit_lvl[o] = L;
+            lit_u[o++] = u;
+            prob      *= al.vals[L][u].prob;
+        }
+        if ( prob <= 0.0 ) {
+            o = keep;
+            continue;
+        }
+        if ( o == keep ) { // empty clause, the expression is TRUE
+            approx_exact(est,1.0);
+            res = BDD_OK;
+            goto done;
+        }
+        first[n_cl]  = keep;
+        U           += prob;
+        ccum[n_cl++] = U;
+        first[n_cl]  = o;
+    }
+    if ( n_cl == 0 ) {
+        approx_exact(est,0.0);
+        res = BDD_OK;
+        goto done;
+    }
+    bdd_rng_seed(&rng,BDD_APPROX_SEED);
+    n = approx_samples_relative(epsilon,delta,n_cl,max_samples);
+    for(s=0; (s<n) && !approx_out_of_time(s,start,max_ms); s++) {
+        int i = dict_sample(ccum,n_cl,bdd_rng_double(&rng)), j;
+
+        for(int l=first[i]; l<first[i+1]; l++) {
+            al.world[lit_lvl[l]] = lit_u[l];
+            al.stamp[lit_lvl[l]] = s;
+        }
+        for(j=0; j<i; j++) {
+            int l;
+
+            for(l=first[j]; l<first[j+1]; l++)
+                if ( approx_draw(&al,lit_lvl[l],s,&rng) != lit_u[l] )
+                    break;
+            if ( l == first[j+1] )
+                break; // clause j < i is true
+        }
+        hits += (j == i);
+    }
+    approx_estimate(est,"karp-luby",hits,s,U,n_cl,delta);
+    res = BDD_OK;
+done:
+    if ( lit_lvl ) FREE(lit_lvl);
+    if ( lit_u )   FREE(lit_u);
+    if ( first )   FREE(first);
+    if ( ccum )    FREE(ccum);
+    approx_levels_free(&al);
+    V_rva_free(&vars);
+    return res;
+}
+
+/*
+ * Approximate probability of a text expression. DNF shaped expressions are
+ * estimated by Karp-Luby without building the bdd, other expressions are
+ * build and estimated by bdd_probability_approx().
+ */
+int bdd_probability_approx_expr(dict_sampler* ds, char* expr, double epsilon, double delta, int max_samples, int max_ms, bdd_estimate* est, char** _errmsg) {
+    dnf  f;
+    bdd* bdd;
+    int  res;
+
+    if ( !approx_check(epsilon,delta,_errmsg) )
+        return BDD_FAIL;
+    if ( dnf_parse(expr,&f) ) {
+        res = bdd_probability_karp_luby(ds,&f,epsilon,delta,max_samples,max_ms,est,_errmsg);
+        dnf_free(&f);
+        return res;
+    }
+    dnf_free(&f);
+    if ( !(bdd = create_bdd(BDD_DEFAULT,expr,_errmsg,0)) )
+        return BDD_FAIL;
+    res = bdd_probability_approx(ds,bdd,epsilon,delta,max_samples,max_ms,est,_errmsg);
+    FREE(bdd);
+    return res;
+}
+
+/*
+ * Evaluation of a bdd in sampled worlds, 64 worlds at a time. The values of
+ * var x in block b (worlds 64b..64b+63) are drawn by a bdd_rng seeded with
+ * a hash of (seed,x,b), so every bdd sees the same worlds, also when it only
+ * has some of the vars, and the results of many bdd's can be combined per
+ * world. The worlds of a block where x has value u are a uint64_t mask and
+ * the bdd is evaluated bit-parallel in one ascending pass over the nodes:
+ *
+ *      mask(i) = (mask(x=v) & mask(high)) | (~mask(x=v) & mask(low))
+ *
+ * with mask(leaf) all 0 or all 1. Bit k of res[b] is world 64b+k, the bits
+ * after n_samples are 0. The masks of a var are drawn for all blocks when a
+ * bdd first needs the var and kept in the sampler, so the next bdd's with
+ * the same seed (the rows of a query) do not draw them again.
+ */
+
+static uint64_t sample_seed(uint64_t seed, char* var, int block) {
+    uint64_t h = seed ^ 0xcbf29ce484222325ULL;
+
+    for(char* c=var; *c; c++) // FNV-1a
+        h = (h ^ (uint8_t)*c) * 0x100000001b3ULL;
+    return h ^ ((uint64_t)block * 0x9e3779b97f4a7c15ULL);
+}
+
+// sets bit k of vmask[u] when value u of var is drawn for world k of block
+static void sample_block(double* cum, int card, char* var, uint64_t seed, int block, uint64_t* vmask) {
+    bdd_rng rng;
+
+    memset(vmask,0,card*sizeof(uint64_t));
+    bdd_rng_seed(&rng,sample_seed(seed,var,block));
+    for(int k=0; k<64; k++)
+        vmask[dict_sample(cum,card,bdd_rng_double(&rng))] |= (uint64_t)1 << k;
+}
+
+/*
+ * Returns the masks of the values of the var with cumulative probabilities
+ * cum for n_blocks blocks, mask b*card+u is value u in block b. Draws with
+ * another seed or too few blocks are dropped first.
+ */
+static uint64_t* sample_draws(dict_sampler* ds, double* cum, int card, char* var, uint64_t seed, int n_blocks, char** _errmsg) {
+    int       j = (int)(cum - ds->cum);
+    uint64_t* m;
+
+    if ( ds->draws && ((ds->draw_seed != seed) || (ds->draw_blocks < n_blocks)) )
+        dict_sampler_drop_draws(ds);
+    if ( !ds->draws ) {
+        if ( !(ds->draws = (uint64_t**)MALLOC((ds->n+1)*sizeof(uint64_t*))) ) {
+            pg_error(_errmsg,"sample_eval: malloc fails");
+            return NULL;
+        }
+        memset(ds->draws,0,(ds->n+1)*sizeof(uint64_t*));
+        ds->draw_seed   = seed;
+        ds->draw_blocks = n_blocks;
+    }
+    if ( !(m = ds->draws[j]) ) {
+        if ( !(m = (uint64_t*)MALLOC(((size_t)card*ds->draw_blocks+1)*sizeof(uint64_t))) ) {
+            pg_error(_errmsg,"sample_eval: malloc fails");
+            return NULL;
+        }
+        for(int b=0; b<ds->draw_blocks; b++)
+            sample_block(cum,card,var,seed,b,&m[(size_t)b*card]);
+        ds->draws[j] = m;
+    }
+    return m;
+}
+
+int bdd_sample_eval(dict_sampler* ds, bdd* bdd, int n_samples, uint64_t seed, uint64_t* res, char** _errmsg) {
+    nodei         sz       = BDD_TREESIZE(bdd);
+    int           n_blocks = (n_samples+63)/64, ok = BDD_FAIL;
+    V_rva         support;
+    approx_levels al;
+    int          *node_card = NULL;
+    uint64_t     *mask      = NULL, **node_vm = NULL;
+
+    if ( n_samples < 0 )
+        return pg_error(_errmsg,"sample_eval: number of samples must not be negative (%d)",n_samples);
+    V_rva_init(&support);
+    if ( !bdd_support(bdd,&support,_errmsg) || !approx_levels_init(&al,ds,&support,_errmsg) ) {
+        V_rva_free(&support);
+        return BDD_FAIL;
+    }
+    if ( !(mask      = (uint64_t*)MALLOC(sz*sizeof(uint64_t))) ||
+         !(node_vm   = (uint64_t**)MALLOC(sz*sizeof(uint64_t*))) ||
+         !(node_card = (int*)MALLOC(sz*sizeof(int))) ) {
+        pg_error(_errmsg,"sample_eval: malloc fails");
+        goto cleanup;
+    }
+    for(int L=0; (L<support.size) && (n_blocks>0); L++) // draw the support first, draws may be dropped
+        if ( !sample_draws(ds,al.cum[L],al.card[L],support.items[L].var,seed,n_blocks,_errmsg) )
+            goto cleanup;
+    for(nodei i=0; i<sz; i++) { // the masks of the rva of node i
+        rva* r = BDD_RVA(bdd,i);
+        int  L, u;
+
+        if ( IS_LEAF_I(bdd,i) )
+            continue;
+        L = support_level(&support,r->var);
+        for(u=0; (u<al.card[L]) && (al.vals[L][u].value != r->val); u++)
+            ;
+        if ( u == al.card[L] ) {
+            pg_error(_errmsg,"dictionary_lookup: rva[%s=%d] not found",r->var,r->val);
+            goto cleanup;
+        }
+        node_vm[i]   = (n_blocks > 0) ? ds->draws[al.cum[L] - ds->cum] + u : NULL;
+        node_card[i] = al.card[L];
+    }
+    for(int b=0; b<n_blocks; b++) {
+        uint64_t m = 0;
+
+        for(nodei i=0; i<sz; i++) {
+            rva_node* n_i = BDD_NODE(bdd,i);
+
+            if ( IS_LEAF(n_i) )
+                m = LEAF_BOOLVALUE(n_i) ? ~(uint64_t)0 : 0;
+            else {
+                uint64_t v = node_vm[i][(size_t)b*node_card[i]];
+
+                m = (v & mask[n_i->high]) | (~v & mask[n_i->low]);
+            }
+            mask[i] = m;
+        }
+        res[b] = m; // the root is the last node
+    }
+    if ( n_samples % 64 )
+        res[n_blocks-1] &= ((uint64_t)1 << (n_samples % 64)) - 1;
+    ok = BDD_OK;
+cleanup:
+    if ( mask )      FREE(mask);
+    if ( node_vm )   FREE(node_vm);
+    if ( node_card ) FREE(node_card);
+    approx_levels_free(&al);
+    V_rva_free(&support);
+    return ok;
+}
+
+/*
+ * The number of the first n_samples sampled worlds in which bdd is true,
+ * -1 on error.
+ */
+int bdd_sample_count(dict_sampler* ds, bdd* bdd, int n_samples, uint64_t seed, char** _errmsg) {
+    uint64_t* res;
+    int       count = 0;
+
+    if ( !(res = (uint64_t*)MALLOC(((n_samples+63)/64+1)*sizeof(uint64_t))) )
+        return pg_error(_errmsg,"sample_eval: malloc fails") - 1;
+    if ( !bdd_sample_eval(ds,bdd,n_samples,seed,res,_errmsg) )
+        count = -1;
+    else
+        for(int b=0; b<(n_samples+63)/64; b++)
+            count += bdd_popcount64(res[b]);
+    FREE(res);
+    return count;
+}
+
+/*
+ * Read-once evaluation of an rva expression. When every var occurs in only
+ * one operand of each '&' and '|' the operands are independent and the
+ * probability is computed in one pass over the expression tree:
+ *
+ *      P(a&b) = P(a)*P(b), P(a|b) = 1-(1-P(a))*(1-P(b)), P(!a) = 1-P(a)
+ *
+ * A subtree mentioning only one var, like (x=1|x=2)&!x=3, is not read-once
+ * but is evaluated by enumerating the dictionary values of the var. So the
+ * expression only has to be read-once in the factors with different vars.
+ * Otherwise the expression is compiled to a bdd. The parser shares the
+ * tokenizer of create_bdd(), '&' and '|' have equal priority and are left
+ * associative like in the bee evaluator.
+ */
+
+#define RO_RVA      'r'
+#define RO_NOVAR    -1 // subtree without vars, only constants
+#define RO_MIXED    -2 // subtree with more than one var
+
+typedef struct ro_node {
+    char    op;     // '&', '|', '!', '0', '1' or RO_RVA
+    int     first;  // first node of the subtree, nodes are in post-order
+    int     var;    // var id, RO_NOVAR or RO_MIXED
+    int     occ;    // occurrences of var in the subtree
+    rva     rva;
+    double  p;
+} ro_node;
+
+typedef struct ro_parser {
+    char*       p;
+    expr_token  tok;    // the lookahead token
+    ro_node*    node;
+    int         n;
+} ro_parser;
+
+static int ro_advance(ro_parser* ps, char** _errmsg) {
+    return expr_next_token(&ps->p,&ps->tok,_errmsg);
+}
+
+static int ro_add(ro_parser* ps, char op, int first) {
+    ro_node* node = &ps->node[ps->n];
+
+    node->op    = op;
+    node->first = first;
+    node->var   = RO_NOVAR;
+    node->occ   = 0;
+    node->p     = 0.0;
+    return ps->n++;
+}
+
+static int ro_parse_expr(ro_parser*,char**);
+
+static int ro_parse_unary(ro_parser* ps, char** _errmsg) {
+    int first = ps->n;
+
+    switch ( ps->tok.type ) {
+     case TOKEN_RVA:
+        if ( ps->tok.var_len > MAX_RVA_NAME )
+            return pg_error(_errmsg,"rva_name too long (max=%d) / %s",MAX_RVA_NAME, ps->tok.var);
+        ro_add(ps,RO_RVA,first);
+        memcpy(ps->node[first].rva.var,ps->tok.var,ps->tok.var_len);
+        ps->node[first].rva.var[ps->tok.var_len] = 0;
+        if ( (ps->node[first].rva.val = bdd_atoi(ps->tok.valp)) == NODEI_NONE )
+            return pg_error(_errmsg,"bad rva value %s=%s",ps->node[first].rva.var,ps->tok.valp);
+        return ro_advance(ps,_errmsg);
+     case TOKEN_CONST:
+        ro_add(ps,ps->tok.c,first);
+        return ro_advance(ps,_errmsg);
+     case TOKEN_OP:
+        if ( ps->tok.c == '!' ) {
+            if ( !ro_advance(ps,_errmsg) || !ro_parse_unary(ps,_errmsg) )
+                return BDD_FAIL;
+            ro_add(ps,'!',first);
+            return BDD_OK;
+        } else if ( ps->tok.c == '(' ) {
+            if ( !ro_advance(ps,_errmsg) || !ro_parse_expr(ps,_errmsg) )
+                return BDD_FAIL;
+            if ( !((ps->tok.type == TOKEN_OP) && (ps->tok.c == ')')) )
+                return pg_error(_errmsg,"missing \')\' in expr");
+            return ro_advance(ps,_errmsg);
+        }
+        return pg_error(_errmsg,"unexpected \'%c\' in expr",ps->tok.c);
+     default:
+        return pg_error(_errmsg,"unexpected end of expr");
+    }
+}
+
+static int ro_parse_expr(ro_parser* ps, char** _errmsg) {
+    int first = ps->n;
+
+    if ( !ro_parse_unary(ps,_errmsg) )
+        return BDD_FAIL;
+    while ( (ps->tok.type == TOKEN_OP) && ((ps->tok.c == '&') || (ps->tok.c == '|')) ) {
+        char op = ps->tok.c;
+
+        if ( !ro_advance(ps,_errmsg) || !ro_parse_unary(ps,_errmsg) )
+            return BDD_FAIL;
+        ro_add(ps,op,first);
+    }
+    return BDD_OK;
+}
+
+static int cmpRoNodeVar(const void* l, const void* r) {
+    return strcmp((*(ro_node**)l)->rva.var,(*(ro_node**)r)->rva.var);
+}
+
+/*
+ * Evaluate the subtree of node last for all values of its only var.
+ */
+static double ro_enumerate(bdd_dictionary* dict, ro_node* node, int last, char* stack, char** _errmsg) {
+    ro_node*  varnode = NULL;
+    dict_val* values;
+    int       card;
+    double    p = 0.0;
+
+    for(int i=node[last].first; !varnode; i++)
+        if ( node[i].op == RO_RVA )
+            varnode = &node[i];
+    if ( !(values = lookup_var_values(dict,varnode->rva.var,&card)) ) {
+        pg_error(_errmsg,"dictionary_lookup: var[%s] not found.",varnode->rva.var);
+        return -1.0;
+    }
+    for(int i=node[last].first; i<=last; i++) {
+        if ( node[i].op == RO_RVA ) {
+            int j;
+
+            for(j=0; (j<card) && (values[j].value != node[i].rva.val); j++)
+                ;
+            if ( j == card ) {
+                pg_error(_errmsg,"dictionary_lookup: rva[\'%s=%d\'] not found.",node[i].rva.var,node[i].rva.val);
+                return -1.0;
+            }
+        }
+    }
+    for(int v=0; v<card; v++) {
+        int sp = 0;
+
+        for(int i=node[last].first; i<=last; i++) {
+            switch ( node[i].op ) {
+             case RO_RVA: stack[sp++] = (node[i].rva.val == values[v].value); break;
+             case '!':    stack[sp-1] = !stack[sp-1];                         break;
+             case '&':    sp--; stack[sp-1] = stack[sp-1] && stack[sp];      break;
+             case '|':    sp--; stack[sp-1] = stack[sp-1] || stack[sp];      break;
+             default:     stack[sp++] = (node[i].op == '1');                 break;
+            }
+        }
+        if ( stack[0] )
+            p += values[v].prob;
+    }
+    return p;
+}
+
+/*
+ * Compute the probability of a single var child when it joins a subtree with
+ * other vars. All occurrences of its var must be in the child, otherwise the
+ * expression is not read-once and 0 is returned.
+ */
+static int ro_close(bdd_dictionary* dict, ro_node* node, int child, int* total, char* stack, char** _errmsg) {
+    if ( node[child].var < 0 )
+        return 1;
+    if ( node[child].occ != total[node[child].var] )
+        return 0;
+    if ( (node[child].p = ro_enumerate(dict,node,child,stack,_errmsg)) < 0.0 )
+        return -1;
+    return 1;
+}
+
+/*
+ * Returns 1 when the probability is computed read-once, 0 when the expression
+ * is not read-once and -1 on error.
+ */
+static int ro_probability(bdd_dictionary* dict, ro_node* node, int n, double* prob, char** _errmsg) {
+    ro_node** rva_nodes;
+    int*      total;
+    char*     stack;
+    int       n_rva = 0, n_var = 0, res = 1;
+
+    rva_nodes = (ro_node**)MALLOC(n*sizeof(ro_node*));
+    total     = (int*)MALLOC(n*sizeof(int));
+    stack     = (char*)MALLOC(n);
+    if ( !rva_nodes || !total || !stack ) {
+        pg_error(_errmsg,"bdd_probability_expr: malloc fails");
+        res = -1;
+        goto cleanup;
+    }
+    for(int i=0; i<n; i++)
+        if ( node[i].op == RO_RVA )
+            rva_nodes[n_rva++] = &node[i];
+    qsort(rva_nodes,n_rva,sizeof(ro_node*),cmpRoNodeVar);
+    for(int r=0; r<n_rva; r++) {
+        if ( (r == 0) || (strcmp(rva_nodes[r-1]->rva.var,rva_nodes[r]->rva.var) != 0) )
+            total[n_var++] = 0;
+        rva_nodes[r]->var = n_var-1;
+        rva_nodes[r]->occ = 1;
+        total[n_var-1]++;
+    }
+    for(int i=0; (i<n) && (res>0); i++) {
+        ro_node* nd = &node[i];
+
+        switch ( nd->op ) {
+         case RO_RVA:
+            break;
+         case '!':
+            nd->var = node[i-1].var;
+            nd->occ = node[i-1].occ;
+            nd->p   = 1.0 - node[i-1].p;
+            break;
+         case '&':
+         case '|': {
+            int l = node[i-1].first - 1, r = i-1;
+
+            if ( node[l].var == RO_NOVAR || (node[l].var == node[r].var) ) {
+                nd->var = node[r].var;
+                nd->occ = node[l].occ + node[r].occ;
+            } else if ( node[r].var == RO_NOVAR ) {
+                nd->var = node[l].var;
+                nd->occ = node[l].occ;
+            } else {
+                nd->var = RO_MIXED;
+                if ( (res = ro_close(dict,node,l,total,stack,_errmsg)) > 0 )
+                    res = ro_close(dict,node,r,total,stack,_errmsg);
+            }
+            if ( nd->op == '&' )
+                nd->p = node[l].p * node[r].p;
+            else
+                nd->p = 1.0 - (1.0-node[l].p) * (1.0-node[r].p);
+            break;
+         }
+         default:
+            nd->p = (nd->op == '1') ? 1.0 : 0.0;
+            break;
+        }
+    }
+    if ( (res > 0) && (node[n-1].var >= 0) ) {
+        if ( (node[n-1].p = ro_enumerate(dict,node,n-1,stack,_errmsg)) < 0.0 )
+            res = -1;
+    }
+    if ( res > 0 )
+        *prob = node[n-1].p;
+cleanup:
+    if ( rva_nodes ) FREE(rva_nodes);
+    if ( total )     FREE(total);
+    if ( stack )     FREE(stack);
+    return res;
+}
+
+/*
+ * Returns the probability of expr and -1.0 on error. When read_once is set it
+ * is 1 when no bdd was needed.
+ */
+double bdd_probability_expr(bdd_dictionary* dict, char* expr, int* read_once, char** _errmsg) {
+    ro_parser ps;
+    bdd*      bdd;
+    double    prob = -1.0;
+    int       res  = 0;
+    char*     ro_errmsg = NULL;
+
+    if ( read_once )
+        *read_once = 0;
+    ps.p = expr;
+    ps.n = 0;
+    if ( !(ps.node = (ro_node*)MALLOC((strlen(expr)+1)*sizeof(ro_node))) ) {
+        pg_error(_errmsg,"bdd_probability_expr: malloc fails");
+        return -1.0;
+    }
+    // a parse error is reported by create_bdd(), it is the reference syntax
+    if ( ro_advance(&ps,&ro_errmsg) && ro_parse_expr(&ps,&ro_errmsg) && (ps.tok.type == TOKEN_END) )
+        res = ro_probability(dict,ps.node,ps.n,&prob,&ro_errmsg);
+    FREE(ps.node);
+    if ( res < 0 ) {
+        *_errmsg = ro_errmsg;
+        return -1.0;
+    }
+    if ( ro_errmsg )
+        FREE(ro_errmsg); // the parse error of the read-once parser
+    if ( res > 0 ) {
+        if ( read_once )
+            *read_once = 1;
+        return prob;
+    }
+    if ( !(bdd = create_bdd(BDD_DEFAULT,expr,_errmsg,0)) )
+        return -1.0;
+    prob = bdd_probability(dict,bdd,NULL,0,_errmsg);
+    FREE(bdd);
+    return prob;
+}
+
+/* 
+ * BDD contains function to check if a bdd contains an rva
+ */
+
+static int _contains_rva(bdd* bdd, char* var, int val) {
+    for (int i=0; i<V_rva_node_size(&bdd->tree); i++) {
+        rva_node* node = BDD_NODE(bdd,i);
+        if ( !IS_LEAF(node)) {
+            if ( COMPARE_VAR(var,node->rva.var) == 0) {
+                 if ( (val < 0) || (val == node->rva.val) )
+                     return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int bdd_contains(bdd* bdd, char* var, int val, char** _errmsg) {
+    return _contains_rva(bdd,var,val);
+}
+
+/* 
+ * BDD property check function 
+ */
+
+// INCOMPLETE, no parsing in this fun, var and val must be seperate args
 int bdd_property_check(bdd* bdd, int prop, char* s, char** _errmsg) {
     if ( !(IS_VALID_PROPERTY(prop)) ) {
         pg_error(_errmsg,"bdd_property_check: bad property (%d)",prop);
@@ -1604,40 +4484,125 @@ int bdd_property_check(bdd* bdd, int prop, char* s, char** _errmsg) {
 
 /* 
  * BDD restrict function 
+ *
+ * All restrict variants run on the same engine. The evidence is a sorted
+ * list of bdd_evidence entries and the result of every source node is
+ * memoized, so each node of the source bdd is visited at most once, also when
+ * it is shared by many paths.
+ */
+
+static int cmpEvidence(const void* l, const void* r) {
+    return cmpRva(&((bdd_evidence*)l)->rva,&((bdd_evidence*)r)->rva);
+}
+
+/*
+ * Return the branch (0/1) the evidence forces for rva or -1 when the evidence
+ * does not restrict rva.
+ */
+static int evidence_branch(bdd_evidence* ev, int n_ev, rva* rva) {
+    int l = 0, r = n_ev-1, res = -1;
+
+    while ( l <= r ) { // find the first evidence entry of the var
+        int m = (l+r)/2;
+        if ( COMPARE_VAR(ev[m].rva.var,rva->var) < 0 )
+            l = m+1;
+        else
+            r = m-1;
+    }
+    for(int i=l; (i<n_ev) && IS_SAMEVAR(&ev[i].rva,rva); i++) {
+        if ( (ev[i].rva.val < 0) || (ev[i].rva.val == rva->val) )
+            return ev[i].torf;
+        if ( ev[i].exclusive && ev[i].torf )
+            res = 0; // another value of this var was observed
+    }
+    return res;
+}
+
+static void evidence2string(bdd_evidence* ev, char* buff) {
+    if ( ev->rva.val < 0 )
+        sprintf(buff,"%s%s=*",(ev->torf?"":"!"),ev->rva.var);
+    else
+        sprintf(buff,"%s%s=%d",(ev->torf?"":"!"),ev->rva.var,ev->rva.val);
+}
+
+/*
+ * Check the sorted evidence for contradictions. When x=v is observed every
+ * other observation x=w, the negation !x=v and the wildcard !x=* contradict
+ * it, they would silently restrict the bdd to FALSE.
  */
+static int check_evidence(bdd_evidence* ev, int n_ev, char** _errmsg) {
+    for(int s=0, e; s<n_ev; s=e) {
+        bdd_evidence* obs = NULL;
+
+        for(e=s; (e<n_ev) && IS_SAMEVAR(&ev[s].rva,&ev[e].rva); e++)
+            if ( ev[e].exclusive && !obs )
+                obs = &ev[e];
+        if ( !obs )
+            continue;
+        for(int i=s; i<e; i++) {
+            if ( ev[i].torf ? (ev[i].rva.val != obs->rva.val) : ((ev[i].rva.val < 0) || (ev[i].rva.val == obs->rva.val)) ) {
+                char obs_str[MAX_RVA_NAME+16], ev_str[MAX_RVA_NAME+16];
+
+                evidence2string(obs,obs_str);
+                evidence2string(&ev[i],ev_str);
+                return pg_error(_errmsg,"bdd_restrict: conflicting evidence %s and %s",obs_str,ev_str);
+            }
+        }
+    }
+    return BDD_OK;
+}
 
-static nodei _bdd_restrict(bdd_runtime* bdd_rt, bdd* p_bdd, nodei p_u, char* var, int val, int torf, char** _errmsg)
+static nodei _bdd_restrict(bdd_runtime* bdd_rt, bdd* p_bdd, nodei p_u, bdd_evidence* ev, int n_ev, nodei* memo, char** _errmsg)
 {
-    nodei r_u = NODEI_NONE;
+    nodei r_u, l_u, h_u;
+    int   branch;
 
+    if ( (r_u = memo[p_u]) != NODEI_NONE )
+        return r_u;
     rva_node *n_u = BDD_NODE(p_bdd,p_u);
     if ( IS_LEAF(n_u) )
-        r_u = p_u;
-    else
-        if ( (COMPARE_VAR(var,n_u->rva.var) == 0) && ((val < 0) || (val == n_u->rva.val)) )
-            r_u =_bdd_restrict(bdd_rt,p_bdd,(torf?n_u->high:n_u->low), var,val,torf,_errmsg);
-        else
-            r_u = bdd_mk(bdd_rt, &n_u->rva,
-                   _bdd_restrict(bdd_rt,p_bdd,n_u->low, var,val,torf,_errmsg),
-                   _bdd_restrict(bdd_rt,p_bdd,n_u->high,var,val,torf,_errmsg),
-                   _errmsg);
+        r_u = LEAF_BOOLVALUE(n_u); // leafs are node 0 and 1 in the result
+    else if ( (branch = evidence_branch(ev,n_ev,&n_u->rva)) >= 0 )
+        r_u = _bdd_restrict(bdd_rt,p_bdd,(branch?n_u->high:n_u->low),ev,n_ev,memo,_errmsg);
+    else {
+        if ( ((l_u = _bdd_restrict(bdd_rt,p_bdd,n_u->low, ev,n_ev,memo,_errmsg)) == NODEI_NONE) ||
+             ((h_u = _bdd_restrict(bdd_rt,p_bdd,n_u->high,ev,n_ev,memo,_errmsg)) == NODEI_NONE) )
+            return NODEI_NONE;
+        r_u = bdd_mk(bdd_rt,&n_u->rva,l_u,h_u,_errmsg);
+    }
+    memo[p_u] = r_u;
     return r_u;
 }
 
-bdd* bdd_restrict(bdd* p_bdd, char* var, int val, int torf, int verbose, char** _errmsg) {
+/*
+ * Restrict the sub-bdd of p_bdd rooted at node root. Only the nodes reachable
+ * from root are copied, so this also extracts a bdd from a tree with garbage
+ * nodes when there is no evidence.
+ */
+static bdd* bdd_restrict_root(bdd* p_bdd, nodei root, bdd_evidence* ev, int n_ev, int verbose, char** _errmsg) {
     bdd_runtime bdd_rt_struct, *bdd_rt;
-    nodei rres;
+    nodei rres, *memo;
     bdd*  res;
 
-    if ( !(bdd_rt = bdd_rt_init(&bdd_rt_struct,NULL,verbose/*verbose*/,_errmsg)) )
+    if ( !(memo = (nodei*)MALLOC(BDD_TREESIZE(p_bdd)*sizeof(nodei))) ) {
+        pg_error(_errmsg,"bdd_restrict: memo malloc fails");
         return NULL;
+    }
+    for(nodei i=0; i<BDD_TREESIZE(p_bdd); i++)
+        memo[i] = NODEI_NONE;
+    if ( !(bdd_rt = bdd_rt_init(&bdd_rt_struct,NULL,verbose/*verbose*/,_errmsg)) ) {
+        FREE(memo);
+        return NULL;
+    }
     if ( (bdd_create_node(&bdd_rt->core,&RVA_0,NODEI_NONE,NODEI_NONE)==NODEI_NONE) ||
          (bdd_create_node(&bdd_rt->core,&RVA_1,NODEI_NONE,NODEI_NONE)==NODEI_NONE) ) {
         pg_error(_errmsg,"bdd_restrict: tree init [0,1] fails");
+        FREE(memo);
         return NULL;
     }
     //
-    rres = _bdd_restrict(bdd_rt,p_bdd,BDD_ROOT(p_bdd),var,val,torf,_errmsg);
+    rres = _bdd_restrict(bdd_rt,p_bdd,root,ev,n_ev,memo,_errmsg);
+    FREE(memo);
     if (rres == NODEI_NONE) {
         bdd_rt_free(bdd_rt);
         return NULL;
@@ -1658,120 +4623,401 @@ bdd* bdd_restrict(bdd* p_bdd, char* var, int val, int torf, int verbose, char**
     return res;
 }
 
-/* 
- * BDD equal and equivalent function 
- */
+static bdd* bdd_restrict_by_evidence(bdd* p_bdd, bdd_evidence* ev, int n_ev, int verbose, char** _errmsg) {
+    qsort(ev,n_ev,sizeof(bdd_evidence),cmpEvidence);
+    if ( !check_evidence(ev,n_ev,_errmsg) )
+        return NULL;
+    return bdd_restrict_root(p_bdd,BDD_ROOT(p_bdd),ev,n_ev,verbose,_errmsg);
+}
 
-int bdd_equal(bdd* lhs_bdd, bdd* rhs_bdd, char** _errmsg) {
-    if ( BDD_TREESIZE(lhs_bdd) != BDD_TREESIZE(rhs_bdd) )
-        return 0; 
-    for(nodei i=0; i<BDD_TREESIZE(lhs_bdd); i++) {
-        rva_node* l = BDD_NODE(lhs_bdd,i);
-        rva_node* r = BDD_NODE(rhs_bdd,i);
-        if ( (l->low!=r->low) || (l->high!=r->high) || (cmpRva(&l->rva,&r->rva)!=0) )
-            return 0;
+bdd* bdd_restrict(bdd* p_bdd, char* var, int val, int torf, int verbose, char** _errmsg) {
+    bdd_evidence ev;
+
+    if ( strlen(var) >= MAX_RVA_NAME ) {
+        pg_error(_errmsg,"bdd_restrict: rva_name too long (max=%d) / %s",MAX_RVA_NAME,var);
+        return NULL;
     }
-    return 1;
+    strcpy(ev.rva.var,var);
+    ev.rva.val   = val;
+    ev.torf      = torf;
+    ev.exclusive = 0;
+    return bdd_restrict_by_evidence(p_bdd,&ev,1,verbose,_errmsg);
 }
 
-int bdd_equiv(bdd* lhs_bdd, bdd* rhs_bdd, char** _errmsg) {
-    int res = -1;
-    pbuff l_pbuff_struct, *l_pbuff=pbuff_init(&l_pbuff_struct);
-    pbuff r_pbuff_struct, *r_pbuff=pbuff_init(&r_pbuff_struct);
-    bdd2string(l_pbuff,lhs_bdd,0);
-    bdd2string(r_pbuff,rhs_bdd,0);
-    res = bdd_test_equivalence(l_pbuff->buffer,r_pbuff->buffer,_errmsg);
-    pbuff_free(l_pbuff);
+/*
+ * Parse one evidence entry. "x=1" observes x=1, so x=1 becomes TRUE and all
+ * other values of x become FALSE. "!x=1" makes only x=1 FALSE and "!x=*"
+ * makes all values of x FALSE. A wildcard without '!' is rejected.
+ */
+static int parse_evidence(char* s, bdd_evidence* ev, char** _errmsg) {
+    char *p = s, *var;
+    int  var_len;
+
+    ev->torf = 1;
+    while ( isspace(*p) ) p++;
+    if ( *p == '!' ) {
+        ev->torf = 0;
+        p++;
+        while ( isspace(*p) ) p++;
+    }
+    var = p;
+    while ( isalnum(*p) ) p++;
+    if ( ((var_len = p-var) == 0) || (var_len >= MAX_RVA_NAME) )
+        return pg_error(_errmsg,"bdd_restrict: bad rva in evidence \"%s\"",s);
+    memcpy(ev->rva.var,var,var_len);
+    ev->rva.var[var_len] = 0;
+    while ( isspace(*p) ) p++;
+    if ( *p++ != '=' )
+        return pg_error(_errmsg,"bdd_restrict: missing '=' in evidence \"%s\"",s);
+    while ( isspace(*p) ) p++;
+    if ( *p == '*' ) {
+        if ( ev->torf )
+            return pg_error(_errmsg,"bdd_restrict: wildcard only allowed in negated evidence \"%s\"",s);
+        ev->rva.val = -1;
+        p++;
+    } else if ( isdigit(*p) ) {
+        if ( (ev->rva.val = bdd_atoi(p)) < 0 )
+            return pg_error(_errmsg,"bdd_restrict: bad value in evidence \"%s\"",s);
+        while ( isdigit(*p) ) p++;
+    } else
+        return pg_error(_errmsg,"bdd_restrict: bad value in evidence \"%s\"",s);
+    while ( isspace(*p) ) p++;
+    if ( *p )
+        return pg_error(_errmsg,"bdd_restrict: unexpected \"%s\" in evidence \"%s\"",p,s);
+    ev->exclusive = ev->torf && (ev->rva.val >= 0);
+    return BDD_OK;
+}
+
+bdd* bdd_restrict_evidence(bdd* p_bdd, char** evidence, int n_evidence, int verbose, char** _errmsg) {
+    bdd_evidence *ev;
+    bdd* res;
+
+    if ( !(ev = (bdd_evidence*)MALLOC((n_evidence>0?n_evidence:1)*sizeof(bdd_evidence))) ) {
+        pg_error(_errmsg,"bdd_restrict: evidence malloc fails");
+        return NULL;
+    }
+    for(int i=0; i<n_evidence; i++) {
+        if ( !parse_evidence(evidence[i],&ev[i],_errmsg) ) {
+            FREE(ev);
+            return NULL;
+        }
+    }
+    res = bdd_restrict_by_evidence(p_bdd,ev,n_evidence,verbose,_errmsg);
+    FREE(ev);
     return res;
 }
 
-int bdd_fast_equiv(bdd* lhs_bdd, bdd* rhs_bdd, char** _errmsg) {
-    int res = bdd_fast_quivalence(lhs_bdd,rhs_bdd,_errmsg);
-    if (res < 0)
-        pg_error(_errmsg,"bdd_fast_equiv: error during fast_equiv");
+/* 
+ * BDD compose function 
+ *
+ * Substitute the rva's x[i] in f by the bdd's g[i] simultaneously. All g[i]
+ * are copied into one runtime and f is rebuilt bottom up, every node u of f
+ * becomes
+ *
+ *      R(u) = ITE(G(u), R(u.high), R(u.low))
+ *
+ * where G(u) is g[i] when u.rva is x[i] and the literal u.rva otherwise. An
+ * rva introduced by g[i] is never substituted again, so the result does not
+ * depend on the order of the substitutions. ITE walks its three operands like
+ * apply does, skipping the values of a var known to be FALSE, and is memoized
+ * on its operands over the whole compose, so the cost is polynomial in the
+ * size of f and the g[i]. The runtime collects garbage nodes from the ITE's,
+ * the result is extracted from its root by bdd_restrict_root().
+ */
+
+typedef struct ite_entry {
+    nodei f, g, h, r; // ITE(f,g,h) = r, f is NODEI_NONE when empty
+} ite_entry;
+
+typedef struct ite_table {
+    ite_entry* tab;
+    uint32_t   mask;
+    uint32_t   n;
+} ite_table;
+
+static uint32_t ite_hash(nodei f, nodei g, nodei h) {
+    uint32_t res = 2166136261u; // FNV-1a
+
+    res ^= (uint32_t)f;  res *= 16777619u;
+    res ^= (uint32_t)g;  res *= 16777619u;
+    res ^= (uint32_t)h;  res *= 16777619u;
     return res;
 }
 
+static int ite_table_init(ite_table* it, uint32_t sz, char** _errmsg) {
+    if ( !(it->tab = (ite_entry*)MALLOC(sz*sizeof(ite_entry))) )
+        return pg_error(_errmsg,"bdd_compose: malloc fails");
+    for(uint32_t i=0; i<sz; i++)
+        it->tab[i].f = NODEI_NONE;
+    it->mask = sz-1;
+    it->n    = 0;
+    return BDD_OK;
+}
+
+static ite_entry* ite_table_find(ite_table* it, nodei f, nodei g, nodei h) {
+    uint32_t i;
+
+    for(i=ite_hash(f,g,h)&it->mask; it->tab[i].f != NODEI_NONE; i=(i+1)&it->mask) {
+        if ( (it->tab[i].f == f) && (it->tab[i].g == g) && (it->tab[i].h == h) )
+            break;
+    }
+    return &it->tab[i];
+}
+
+static int ite_table_store(ite_table* it, nodei f, nodei g, nodei h, nodei r, char** _errmsg) {
+    ite_entry* e;
+
+    if ( 2*(it->n+1) > it->mask ) {
+        ite_table old = *it;
+
+        if ( !ite_table_init(it,2*(old.mask+1),_errmsg) ) {
+            *it = old;
+            return BDD_FAIL;
+        }
+        for(uint32_t i=0; i<=old.mask; i++)
+            if ( old.tab[i].f != NODEI_NONE )
+                *ite_table_find(it,old.tab[i].f,old.tab[i].g,old.tab[i].h) = old.tab[i];
+        it->n = old.n;
+        FREE(old.tab);
+    }
+    e = ite_table_find(it,f,g,h);
+    e->f = f; e->g = g; e->h = h; e->r = r;
+    it->n++;
+    return BDD_OK;
+}
+
 /*
- * BDD optimizations and remove redundancies
+ * The cofactor of node u of the runtime on the top rva. On the high branch
+ * the other values of the top var are FALSE and skipped like in apply.
  */
+static nodei ite_cofactor(bdd* core, nodei u, rva* top, int branch) {
+    rva_node* n = BDD_NODE(core,u);
 
-static int _remove_redundancies(bdd* bdd, nodei i) {
-    int res = 0;
-    rva_node *node = BDD_NODE(bdd,i);
+    if ( !IS_LEAF(n) && (cmpRva(&n->rva,top) == 0) )
+        u = branch ? n->high : n->low;
+    return branch ? skip_known_var(core,u,top) : u;
+}
 
-    if ( ! IS_LEAF(node ) ) {
-        if ( BOOL_NODE(node->high) )
-            res = _remove_redundancies(bdd, node->low);
-        else {
-            // Check if the high of the node var is the same var. Because 
-            // now the value of var is known in the high branch you can skip
-            // over this var.
-            if ( IS_SAMEVAR(BDD_RVA(bdd,i), BDD_RVA(bdd,node->high)) ) {
-                if ( BDD_RVA(bdd,i)->val == BDD_RVA(bdd,node->high)->val )   
-                    node->high = BDD_NODE(bdd,node->high)->high;
-                else
-                    node->high = BDD_NODE(bdd,node->high)->low;
-                res = 1;
-            }
-            res |= _remove_redundancies(bdd, node->low);
-            res |= _remove_redundancies(bdd, node->high);
-        }
+static nodei _bdd_ite(bdd_runtime* bdd_rt, ite_table* it, nodei f, nodei g, nodei h, char** _errmsg) {
+    bdd*       core = &bdd_rt->core;
+    nodei      op[3] = {f,g,h}, lo, hi, res;
+    rva        top;
+    ite_entry* e;
+
+    if ( f == 1 ) return g;
+    if ( f == 0 ) return h;
+    if ( g == h ) return g;
+    if ( (g == 1) && (h == 0) ) return f;
+    if ( (e = ite_table_find(it,f,g,h))->f != NODEI_NONE )
+        return e->r;
+    top = BDD_NODE(core,f)->rva; // a copy, mk may move the tree
+    for(int i=1; i<3; i++) {
+        rva_node* n = BDD_NODE(core,op[i]);
+        if ( !IS_LEAF(n) && (cmpRva(&n->rva,&top) < 0) )
+            top = n->rva;
     }
+    if ( ((lo = _bdd_ite(bdd_rt,it,ite_cofactor(core,f,&top,0),ite_cofactor(core,g,&top,0),ite_cofactor(core,h,&top,0),_errmsg)) == NODEI_NONE) ||
+         ((hi = _bdd_ite(bdd_rt,it,ite_cofactor(core,f,&top,1),ite_cofactor(core,g,&top,1),ite_cofactor(core,h,&top,1),_errmsg)) == NODEI_NONE) ||
+         ((res = bdd_mk(bdd_rt,&top,lo,hi,_errmsg)) == NODEI_NONE) )
+        return NODEI_NONE;
+    if ( !ite_table_store(it,f,g,h,res,_errmsg) )
+        return NODEI_NONE;
     return res;
 }
 
-#define MARK_UNUSED(NODE)   (NODE)->low = - ((NODE)->low + 1)
-#define MARK_USED(NODE)     (NODE)->low = -(NODE)->low - 1
-#define IS_USED(NODE)       ((NODE)->low >= 0)
-
-static void _mark_used_branches(bdd* bdd, nodei i) {
-    rva_node *node = BDD_NODE(bdd,i);
+/*
+ * Copy bdd b into the runtime and return the runtime node of its root.
+ */
+static nodei compose_import(bdd_runtime* bdd_rt, bdd* b, nodei* map, char** _errmsg) {
+    for(nodei i=0; i<BDD_TREESIZE(b); i++) {
+        rva_node* n = BDD_NODE(b,i);
 
-    if ( (i >= 2) && !IS_USED(node) ) {
-        MARK_USED(node);
-        _mark_used_branches(bdd, node->low);
-        _mark_used_branches(bdd, node->high);
+        if ( IS_LEAF(n) )
+            map[i] = LEAF_BOOLVALUE(n);
+        else if ( (map[i] = bdd_mk(bdd_rt,&n->rva,map[n->low],map[n->high],_errmsg)) == NODEI_NONE )
+            return NODEI_NONE;
     }
+    return map[BDD_ROOT(b)];
 }
-        
-static void _remove_unused_branches(bdd* bdd) {
-    nodei i, j;
-    rva_node *node;
 
-    for(i=2; i < BDD_TREESIZE(bdd); i++)
-        MARK_UNUSED(BDD_NODE(bdd, i));
-    _mark_used_branches(bdd, BDD_ROOT(bdd));
-    //
-    for(i=2; i < BDD_TREESIZE(bdd); i++) {
-        if ( ! IS_USED(BDD_NODE(bdd, i)) ) {
-            fprintf(stdout,"&&&&& removing node = %d\n", i);
-            for(j=2; j < BDD_TREESIZE(bdd); j++)
-                if ( i != j ) {
-                    node = BDD_NODE(bdd, j);
-                    if ( IS_USED(node) ) {  
-                        if ( node->low > i)
-                            node->low--;
-                        if ( node->high > i)
-                            node->high--;
-                    }
-                    
+static int parse_compose_rva(char* s, bdd_evidence* x, char** _errmsg) {
+    if ( !parse_evidence(s,x,_errmsg) )
+        return BDD_FAIL;
+    if ( !x->torf || (x->rva.val < 0) )
+        return pg_error(_errmsg,"bdd_compose: expect a \"var=val\" rva to substitute, not \"%s\"",s);
+    return BDD_OK;
+}
+
+bdd* bdd_compose(bdd* f, char* rva_str, bdd* g, int verbose, char** _errmsg) {
+    return bdd_compose_vector(f,&rva_str,&g,1,verbose,_errmsg);
+}
+
+/*
+ * Substitute rva_str[i] by g[i] for i in 0..n-1, all at once. An rva may
+ * only be substituted once.
+ */
+bdd* bdd_compose_vector(bdd* f, char** rva_str, bdd** g, int n, int verbose, char** _errmsg) {
+    bdd_runtime   bdd_rt_struct, *bdd_rt = NULL;
+    ite_table     it = {.tab = NULL};
+    bdd_evidence* x = NULL;
+    nodei        *g_root = NULL, *map = NULL, *fmap = NULL;
+    nodei         max_tree = BDD_TREESIZE(f);
+    bdd*          res = NULL;
+
+    for(int i=0; i<n; i++)
+        if ( BDD_TREESIZE(g[i]) > max_tree )
+            max_tree = BDD_TREESIZE(g[i]);
+    if ( !(x = (bdd_evidence*)MALLOC((n>0?n:1)*sizeof(bdd_evidence))) ||
+         !(g_root = (nodei*)MALLOC((n>0?n:1)*sizeof(nodei))) ||
+         !(map = (nodei*)MALLOC(max_tree*sizeof(nodei))) ||
+         !(fmap = (nodei*)MALLOC(BDD_TREESIZE(f)*sizeof(nodei))) ) {
+        pg_error(_errmsg,"bdd_compose: malloc fails");
+        goto cleanup;
+    }
+    for(int i=0; i<n; i++) {
+        if ( !parse_compose_rva(rva_str[i],&x[i],_errmsg) )
+            goto cleanup;
+        for(int j=0; j<i; j++)
+            if ( cmpRva(&x[j].rva,&x[i].rva) == 0 ) {
+                pg_error(_errmsg,"bdd_compose: rva %s=%d substituted twice",x[i].rva.var,x[i].rva.val);
+                goto cleanup;
             }
-            V_rva_node_delete(&(bdd)->tree,i); // better with define?
-            --i; // adjust for, new element at tree[i]
+    }
+    if ( !(bdd_rt = bdd_rt_init(&bdd_rt_struct,NULL,verbose/*verbose*/,_errmsg)) )
+        goto cleanup;
+    if ( (bdd_create_node(&bdd_rt->core,&RVA_0,NODEI_NONE,NODEI_NONE)==NODEI_NONE) ||
+         (bdd_create_node(&bdd_rt->core,&RVA_1,NODEI_NONE,NODEI_NONE)==NODEI_NONE) ) {
+        pg_error(_errmsg,"bdd_compose: tree init [0,1] fails");
+        goto cleanup;
+    }
+    if ( !ite_table_init(&it,256,_errmsg) )
+        goto cleanup;
+    for(int i=0; i<n; i++)
+        if ( (g_root[i] = compose_import(bdd_rt,g[i],map,_errmsg)) == NODEI_NONE )
+            goto cleanup;
+    for(nodei u=0; u<BDD_TREESIZE(f); u++) {
+        rva_node* n_u = BDD_NODE(f,u);
+        nodei     sub = NODEI_NONE;
+
+        if ( IS_LEAF(n_u) ) {
+            fmap[u] = LEAF_BOOLVALUE(n_u);
+            continue;
         }
+        for(int i=0; (i<n) && (sub == NODEI_NONE); i++)
+            if ( cmpRva(&x[i].rva,&n_u->rva) == 0 )
+                sub = g_root[i];
+        if ( (sub == NODEI_NONE) && ((sub = bdd_mk(bdd_rt,&n_u->rva,0,1,_errmsg)) == NODEI_NONE) )
+            goto cleanup;
+        if ( (fmap[u] = _bdd_ite(bdd_rt,&it,sub,fmap[n_u->high],fmap[n_u->low],_errmsg)) == NODEI_NONE )
+            goto cleanup;
+    }
+    res = bdd_restrict_root(&bdd_rt->core,fmap[BDD_ROOT(f)],NULL,0,verbose,_errmsg);
+cleanup:
+    if ( bdd_rt )  bdd_rt_free(bdd_rt);
+    if ( it.tab )  FREE(it.tab);
+    if ( x )       FREE(x);
+    if ( g_root )  FREE(g_root);
+    if ( map )     FREE(map);
+    if ( fmap )    FREE(fmap);
+    return res;
+}
+
+/* 
+ * BDD equal and equivalent function 
+ */
+
+int bdd_equal(bdd* lhs_bdd, bdd* rhs_bdd, char** _errmsg) {
+    if ( BDD_TREESIZE(lhs_bdd) != BDD_TREESIZE(rhs_bdd) )
+        return 0; 
+    for(nodei i=0; i<BDD_TREESIZE(lhs_bdd); i++) {
+        rva_node* l = BDD_NODE(lhs_bdd,i);
+        rva_node* r = BDD_NODE(rhs_bdd,i);
+        if ( (l->low!=r->low) || (l->high!=r->high) || (cmpRva(&l->rva,&r->rva)!=0) )
+            return 0;
     }
+    return 1;
 }
 
-int remove_redundancies(bdd* bdd) {
+/*
+ * Decision procedures on two bdd's. They walk the product of both bdd's like
+ * apply does, including skipping the values of a var known to be FALSE, but
+ * only mark the visited (u1,u2) pairs in the G table and stop at the first
+ * path which is a witness against the property. No result bdd is created.
+ */
+
+#define DECIDE_EQUIV    0 // witness: a path where l and r differ
+#define DECIDE_IMPLIES  1 // witness: a path where l is TRUE and r FALSE
+#define DECIDE_DISJOINT 2 // witness: a path where l and r are both TRUE
+
+static int _bdd_decide(hash_matrix** G, int mode, bdd* b1, nodei u1, bdd* b2, nodei u2, rva* known, char** _errmsg)
+{
+    rva_node *n_u1, *n_u2;
     int res;
 
-    res = _remove_redundancies(bdd, BDD_ROOT(bdd));
-    fprintf(stdout,"################################### res = %d\n", res);
-    if ( res )
-        _remove_unused_branches(bdd);
+    if ( known ) {
+        u1 = skip_known_var(b1,u1,known);
+        u2 = skip_known_var(b2,u2,known);
+    }
+    if ( lookup_G(*G,u1,u2) != NODEI_NONE )
+        return 0; // already visited without witness
+    n_u1 = BDD_NODE(b1,u1);
+    n_u2 = BDD_NODE(b2,u2);
+    if ( IS_LEAF(n_u1) && IS_LEAF(n_u2) ) {
+        int bv_u1 = LEAF_BOOLVALUE(n_u1);
+        int bv_u2 = LEAF_BOOLVALUE(n_u2);
+        switch ( mode ) {
+            case DECIDE_EQUIV:    res = (bv_u1 != bv_u2);   break;
+            case DECIDE_IMPLIES:  res = (bv_u1 && !bv_u2);  break;
+            default:              res = (bv_u1 && bv_u2);   break;
+        }
+    } else {
+        int cmp = cmpRva(&n_u1->rva,&n_u2->rva);
+        if ( cmp == 0 ) {
+            if ( !(res = _bdd_decide(G,mode,b1,n_u1->low,b2,n_u2->low,NULL,_errmsg)) )
+                res = _bdd_decide(G,mode,b1,n_u1->high,b2,n_u2->high,&n_u1->rva,_errmsg);
+        } else if ( IS_LEAF(n_u1) || (!IS_LEAF(n_u2) && (cmp > 0)) ) {
+            if ( !(res = _bdd_decide(G,mode,b1,u1,b2,n_u2->low,NULL,_errmsg)) )
+                res = _bdd_decide(G,mode,b1,u1,b2,n_u2->high,&n_u2->rva,_errmsg);
+        } else {
+            if ( !(res = _bdd_decide(G,mode,b1,n_u1->low,b2,u2,NULL,_errmsg)) )
+                res = _bdd_decide(G,mode,b1,n_u1->high,b2,u2,&n_u1->rva,_errmsg);
+        }
+    }
+    if ( res == 0 ) {
+        if ( !(*G = store_G(*G,u1,u2,1,_errmsg)) )
+            return -1;
+    }
     return res;
 }
 
+/*
+ * Returns 1 when the property holds, 0 when not and -1 on error.
+ */
+static int bdd_decide(int mode, bdd* lhs_bdd, bdd* rhs_bdd, char** _errmsg) {
+    hash_matrix* G;
+    int witness;
+
+    if ( !(G = create_G(BDD_TREESIZE(lhs_bdd),BDD_TREESIZE(rhs_bdd),_errmsg)) )
+        return -1;
+    witness = _bdd_decide(&G,mode,lhs_bdd,BDD_ROOT(lhs_bdd),rhs_bdd,BDD_ROOT(rhs_bdd),NULL,_errmsg);
+    if ( G )
+        FREE(G);
+    return (witness < 0) ? -1 : !witness;
+}
+
+int bdd_equiv(bdd* lhs_bdd, bdd* rhs_bdd, char** _errmsg) {
+    return bdd_decide(DECIDE_EQUIV,lhs_bdd,rhs_bdd,_errmsg);
+}
+
+int bdd_implies(bdd* lhs_bdd, bdd* rhs_bdd, char** _errmsg) {
+    return bdd_decide(DECIDE_IMPLIES,lhs_bdd,rhs_bdd,_errmsg);
+}
 
+int bdd_disjoint(bdd* lhs_bdd, bdd* rhs_bdd, char** _errmsg) {
+    return bdd_decide(DECIDE_DISJOINT,lhs_bdd,rhs_bdd,_errmsg);
+}
+
+int bdd_fast_equiv(bdd* lhs_bdd, bdd* rhs_bdd, char** _errmsg) {
+    return bdd_decide(DECIDE_EQUIV,lhs_bdd,rhs_bdd,_errmsg);
+}
 
@@ -35,6 +35,8 @@ typedef struct rva {
 
 int cmpRva(rva*, rva*);
 
+DefVectorH(rva);
+
 /*
  * The rva_node type defines a node in the bdd/graph tree. It has two
  * 'pointers' low and high pointing to the FALSE and TRUE children in the
@@ -182,6 +184,7 @@ bdd_alg* bdd_algorithm(char*, char** _errmsg);
 #define IS_LEAF_I(PBDD,NI)  (IS_LEAF(BDD_NODE(PBDD,NI)))
 #define LEAF_BOOLVALUE(N)   ((N)->rva.var[0]-'0')
 #define NODE_BOOLVALUE(N)   (IS_LEAF(N) ? ((N)->rva.var[0]-'0') : -1)
+#define IS_RVA_NODE(N)      (isalpha((N)->rva.var[0])) // no leaf or ddnnf operator
 
 #define bdd_low(PBDD,I)     (BDD_NODE(PBDD,I)->low)
 #define bdd_high(PBDD,I)    (BDD_NODE(PBDD,I)->high)
@@ -200,6 +203,18 @@ bdd_alg* bdd_algorithm(char*, char** _errmsg);
 
 bdd* create_bdd(bdd_alg*,char*,char**,int);
 
+typedef enum expr_token_type {TOKEN_END, TOKEN_OP, TOKEN_CONST, TOKEN_RVA} expr_token_type;
+
+typedef struct expr_token { // token of an rva expression, see bdd.c
+    expr_token_type type;
+    char            c;       // TOKEN_OP, TOKEN_CONST: the character
+    char*           var;     // TOKEN_RVA: the var name, not terminated
+    int             var_len;
+    char*           valp;    // TOKEN_RVA: the value digits
+} expr_token;
+
+int expr_next_token(char**,expr_token*,char**);
+
 void bdd_rt_free(bdd_runtime*);
 
 bdd* serialize_bdd(bdd*);
@@ -207,7 +222,11 @@ bdd* relocate_bdd(bdd*);
 
 #define BDD_G_CACHE_MAX 65536
 
+int   bdd_support(bdd*,V_rva*,char**);
+int   bdd_support_disjoint(V_rva*,V_rva*);
+
 bdd*  bdd_apply(char,bdd*,bdd*,int,char**);
+bdd*  bdd_apply_support(char,bdd*,V_rva*,bdd*,V_rva*,int,char**);
 
 typedef enum op_mode {BY_TEXT, BY_APPLY} op_mode;
 
@@ -216,13 +235,187 @@ bdd*  bdd_operator(char,op_mode,bdd*,bdd*,char**);
 int bdd_equal(bdd* lhs_bdd, bdd* rhs_bdd, char** _errmsg);
 int bdd_equiv(bdd* lhs_bdd, bdd* rhs_bdd, char** _errmsg);
 int bdd_fast_equiv(bdd* lhs_bdd, bdd* rhs_bdd, char** _errmsg);
+int bdd_implies(bdd* lhs_bdd, bdd* rhs_bdd, char** _errmsg);
+int bdd_disjoint(bdd* lhs_bdd, bdd* rhs_bdd, char** _errmsg);
 
 void  bdd2string(pbuff*,bdd*,int);
 void  bdd_info(bdd*, pbuff*);
 void  bdd_generate_dot(bdd*,pbuff*,char**);
 void  bdd_generate_dotfile(bdd*,char*,char**);
 
+/*
+ * Bottom-up evaluation of a bdd in a semiring (ZERO,ONE,PLUS,TIMES), the
+ * probability pass generalized. Before the pass the caller binds for every
+ * node lit, the weight of its rva, and rest, the weight of its var having
+ * none of the values in the chain from the node down. In one ascending pass
+ * over the nodes reachable from the root the pass computes
+ *
+ *      sum(i) = lit(i)*val(high) + (low has same var ? sum(low) : ZERO)
+ *      end(i) = (low has same var ? end(low) : low)
+ *      val(i) = sum(i) + rest(i)*val(end(i))
+ *
+ * and returns val(root). Vars skipped on an edge are not weighted, so the
+ * weights of the values of a var must add up to ONE, the bindings normalize
+ * the weights when needed. Unreachable nodes get end BDD_SR_UNREACHED.
+ * DefBddSemiringH declares the node type and the pass, DefBddSemiringC
+ * implements them, like DefVectorH and DefVectorC. NAME_sr_step() computes
+ * node i of an array of nodes when its children are done, for other node
+ * orders than the pass and for nodes shared by several bdd's.
+ *
+ * NAME_sr_adjoint() is the reverse of the pass, it needs only PLUS and TIMES
+ * of a commutative semiring. From adj(root).val = ONE it computes from the
+ * root down, node i before its children, the adjoints of the pass formulas
+ *
+ *      adj(i).sum    = adj(i).val (+ adj(parent).sum when i continues a chain)
+ *      adj(i).rest   = adj(i).val*val(end(i))
+ *      adj(i).lit    = adj(i).sum*val(high)
+ *      adj(end).val += adj(i).val*rest(i), adj(high).val += adj(i).sum*lit(i)
+ *
+ * so adj(i).lit and adj(i).rest are the derivatives of val(root) for the
+ * weights bound to node i.
+ */
+
+#define BDD_SR_UNREACHED    -1
+#define BDD_SR_REACHED      -2
+
+#define DefBddSemiringH(name,type) \
+typedef struct name##_sr { \
+    type  val, sum, lit, rest; \
+    nodei end; \
+} name##_sr; \
+typedef struct name##_sr_adj { \
+    type  val, sum, lit, rest; \
+} name##_sr_adj; \
+type name##_sr_pass(bdd*,name##_sr*); \
+void name##_sr_adjoint(bdd*,name##_sr*,name##_sr_adj*);
+
+#define DefBddSemiringC(name,type,zero,one,plus,times) \
+static inline void name##_sr_step(rva_node* nodes, name##_sr* sr, nodei i) { \
+    rva_node*  n_i = &nodes[i]; \
+    name##_sr* s   = &sr[i]; \
+\
+    if ( IS_LEAF(n_i) ) { \
+        s->val = s->sum = LEAF_BOOLVALUE(n_i) ? (one) : (zero); \
+        s->end = i; \
+    } else { \
+        rva_node* n_low = &nodes[n_i->low]; \
+\
+        s->sum = times(s->lit,sr[n_i->high].val); \
+        if ( !IS_LEAF(n_low) && IS_SAMEVAR(&n_low->rva,&n_i->rva) ) { \
+            s->sum = plus(s->sum,sr[n_i->low].sum); \
+            s->end = sr[n_i->low].end; \
+        } else \
+            s->end = n_i->low; \
+        s->val = plus(s->sum,times(s->rest,sr[s->end].val)); \
+    } \
+} \
+\
+type name##_sr_pass(bdd* bdd, name##_sr* sr) \
+{ \
+    nodei root = BDD_ROOT(bdd); \
+\
+    for(nodei i=0; i<root; i++) \
+        sr[i].end = BDD_SR_UNREACHED; \
+    sr[root].end = BDD_SR_REACHED; \
+    for(nodei i=root; i>=0; i--) { \
+        rva_node* n_i = BDD_NODE(bdd,i); \
+        if ( (sr[i].end == BDD_SR_REACHED) && !IS_LEAF(n_i) ) \
+            sr[n_i->low].end = sr[n_i->high].end = BDD_SR_REACHED; \
+    } \
+    for(nodei i=0; i<=root; i++) \
+        if ( sr[i].end != BDD_SR_UNREACHED ) \
+            name##_sr_step(bdd->tree.items,sr,i); \
+    return sr[root].val; \
+} \
+\
+void name##_sr_adjoint(bdd* bdd, name##_sr* sr, name##_sr_adj* adj) \
+{ \
+    nodei root = BDD_ROOT(bdd); \
+\
+    for(nodei i=0; i<=root; i++) \
+        adj[i].val = adj[i].sum = adj[i].lit = adj[i].rest = (zero); \
+    adj[root].val = (one); \
+    for(nodei i=root; i>=0; i--) { \
+        rva_node*      n_i = BDD_NODE(bdd,i); \
+        name##_sr_adj* a   = &adj[i]; \
+        nodei          end = sr[i].end; \
+\
+        if ( (end == BDD_SR_UNREACHED) || IS_LEAF(n_i) ) \
+            continue; \
+        a->sum         = plus(a->sum,a->val); \
+        a->rest        = times(a->val,sr[end].val); \
+        adj[end].val   = plus(adj[end].val,times(a->val,sr[i].rest)); \
+        a->lit         = times(a->sum,sr[n_i->high].val); \
+        adj[n_i->high].val = plus(adj[n_i->high].val,times(a->sum,sr[i].lit)); \
+        if ( !IS_LEAF_I(bdd,n_i->low) && IS_SAMEVAR(BDD_RVA(bdd,n_i->low),&n_i->rva) ) \
+            adj[n_i->low].sum = plus(adj[n_i->low].sum,a->sum); \
+    } \
+}
+
+int    tree_bind_probabilities(bdd_dictionary*,V_rva_node*,double*,pbuff*,char**);
+int    bdd_bind_probabilities(bdd_dictionary*,bdd*,double*,char**);
 double bdd_probability(bdd_dictionary*, bdd*,char**, int, char**);
+double bdd_probability_op(bdd_dictionary*,char,bdd*,bdd*,int,char**);
+int    bdd_probability_vector(bdd_dictionary*,bdd**,int,double*,char**);
+
+typedef struct bdd_sensitivity {
+    rva    rva;
+    double prob;       // p(rva) in the dictionary
+    double derivative; // dP/dp(rva)
+    double cond;       // P(bdd | rva)
+    double banzhaf;    // P(bdd | rva) - P(bdd | !rva)
+} bdd_sensitivity;
+
+bdd_sensitivity* bdd_probability_gradient(bdd_dictionary*,bdd*,int*,double*,char**);
+int    bdd_probability_scenarios(bdd_dictionary**,int,bdd*,double*,char**);
+double bdd_probability_op_support(bdd_dictionary*,char,bdd*,V_rva*,double*,bdd*,V_rva*,double*,int,char**);
+int    bdd_probability_cond(bdd_dictionary*,bdd*,bdd*,double*,double*,char**);
+int    bdd_probability_exceeds(bdd_dictionary*,bdd*,double,int,char**);
+double bdd_probability_expr(bdd_dictionary*,char*,int*,char**);
+#ifndef PG_CONFIG
+double bdd_probability_parallel(bdd_dictionary*,bdd*,int,int,char**);
+#endif
+
+typedef struct bdd_prob_heap { // the k most probable bdd's, see bdd.c
+    int     k, n;
+    long    pruned;   // bdd's rejected by bounds
+    long    computed; // bdd's with exact probability computed
+    double* prob;     // min-heap on probability
+    int*    slot;     // payload slot of the entry
+} bdd_prob_heap;
+
+bdd_prob_heap* bdd_prob_heap_create(int,char**);
+int            bdd_prob_heap_offer(bdd_prob_heap*,bdd_dictionary*,bdd*,char**);
+int            bdd_prob_heap_sorted(bdd_prob_heap*,int*,double*);
+double* bdd_count_distribution(bdd_dictionary*,bdd**,int,char**);
+
+typedef struct bdd_topk bdd_topk; // k most probable worlds, see bdd.c
+
+bdd_topk* bdd_topk_create(bdd_dictionary*,bdd*,int,char**);
+int       bdd_topk_count(bdd_topk*);
+double    bdd_topk_world(bdd_topk*,int,V_rva*,char**);
+void      bdd_topk_free(bdd_topk*);
+double    bdd_probability_mpe(bdd_dictionary*,bdd*,char**);
+int64_t   bdd_count_worlds(bdd_dictionary*,bdd*,char**);
+
+typedef struct bdd_paths bdd_paths; // paths to TRUE of a bdd, see bdd.c
+
+bdd_paths* bdd_paths_create(bdd*,char**);
+int        bdd_paths_next(bdd_paths*,pbuff*);
+void       bdd_paths_free(bdd_paths*);
+
+typedef struct bdd_estimate {
+    double prob;        // estimated probability
+    double lower;       // confidence interval [lower,upper] with 1-delta
+    double upper;
+    int    samples;     // number of samples drawn, 0 when exact
+    char   method[16];  // "exact", "monte carlo" or "karp-luby"
+} bdd_estimate;
+
+int    bdd_probability_approx(dict_sampler*,bdd*,double,double,int,int,bdd_estimate*,char**);
+int    bdd_probability_approx_expr(dict_sampler*,char*,double,double,int,int,bdd_estimate*,char**);
+int    bdd_sample_eval(dict_sampler*,bdd*,int,uint64_t,uint64_t*,char**);
+int    bdd_sample_count(dict_sampler*,bdd*,int,uint64_t,char**);
 
 #define BDD_IS_FALSE       0
 #define BDD_IS_TRUE        1
@@ -233,12 +426,26 @@ double bdd_probability(bdd_dictionary*, bdd*,char**, int, char**);
 
 int    bdd_property_check(bdd*,int,char*,char**);
 int    bdd_contains(bdd*,char*,int,char**);
+
+/*
+ * An evidence entry restricts the rva's matching rva to a boolean value. When
+ * exclusive is set the var is observed, so all other values of the var are
+ * restricted to FALSE as well.
+ */
+typedef struct bdd_evidence {
+    rva   rva;       // rva.val < 0 means all values of rva.var
+    char  torf;      // the boolean value the matching rva's get
+    char  exclusive; // other values of rva.var become FALSE
+} bdd_evidence;
+
 bdd*   bdd_restrict(bdd*,char*,int,int,int,char**);
+bdd*   bdd_restrict_evidence(bdd*,char**,int,int,char**);
+
+bdd*   bdd_compose(bdd*,char*,bdd*,int,char**);
+bdd*   bdd_compose_vector(bdd*,char**,bdd**,int,int,char**);
 
 int    bdd_test_equivalence(char* l_expr, char* r_expr, char** _errmsg);
-int    bdd_fast_quivalence(bdd* l_bdd, bdd* r_bdd, char** _errmsg);
 
-int    remove_redundancies(bdd* bdd);
 
 
 //
@@ -0,0 +1,899 @@
+/*
+ * This file is part of the Dubio distribution (https://github.com/utwente-db/DuBio).
+ * Copyright (c) 2020 Jan Flokstra & Maurice van Keulen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "utils.h"
+#include "vector.h"
+#include "dictionary.h"
+#include "bdd.h"
+#include "ddnnf.h"
+
+/*
+ * The ddnnf compiler. The expression is parsed into a formula dag where
+ * every node is unique (hash consed) and simplified, so equal subformulas
+ * are the same node. Compiling a formula node:
+ *
+ *  - an '&' or '|' whose operands split into groups without common vars is
+ *    decomposed, a&b becomes an AND node and a|b becomes !(!a&!b)
+ *  - otherwise the most frequent var x is chosen and the formula is
+ *    conditioned on every value of x it contains and on x having none of
+ *    these values, giving a chain of decision nodes like in a bdd
+ *
+ * The compiled node of every formula node is cached, this is the component
+ * cache, a component which shows up again after conditioning on unrelated
+ * vars is compiled once. The output nodes are unique too.
+ */
+
+#define FN_RVA      'r'
+
+typedef struct fnode {
+    char  op;    // '&', '|', '!', '0', '1' or FN_RVA
+    int   l, r;  // '&', '|': the operands, '!': l
+    int   var;   // FN_RVA: the var id
+    int   val;
+    int   next;  // chain in the unique table
+} fnode;
+
+typedef struct ddnnf_compiler {
+    fnode*     f;          // the formula nodes
+    int        n_f, max_f;
+    int*       f_hash;     // unique table, max_f buckets
+    nodei*     compiled;   // the component cache, per formula node
+    int*       memo;       // conditioning result, per formula node
+    int*       stamp;      // memo and visited marks, valid when == gen
+    int        gen;
+    //
+    char     (*var)[MAX_RVA_NAME_BUFF]; // the var names by id
+    int*       var_sorted; // var id's sorted by name
+    int        n_var, max_var;
+    int*       var_count;  // occurrences of var in the formula being split
+    int*       var_owner;  // operand index of var, valid when var_stamp==gen
+    int*       var_stamp;
+    //
+    V_rva_node tree;       // the output nodes
+    int*       o_var;      // var id of output node, -1 for leafs/operators
+    int*       o_hash;     // unique table, max_o buckets
+    int*       o_next;
+    int        max_o;
+} ddnnf_compiler;
+
+#define DC_FALSE    0
+#define DC_TRUE     1
+
+static unsigned int hash_ints(int a, int b, int c, int d) {
+    unsigned int h = 2166136261u;
+
+    h = (h ^ (unsigned int)a) * 16777619u;
+    h = (h ^ (unsigned int)b) * 16777619u;
+    h = (h ^ (unsigned int)c) * 16777619u;
+    h = (h ^ (unsigned int)d) * 16777619u;
+    return h;
+}
+
+/*
+ * Formula nodes
+ */
+
+static int fn_grow(ddnnf_compiler* dc, char** _errmsg) {
+    int new_max = dc->max_f * 2;
+
+    if ( !(dc->f = (fnode*)REALLOC(dc->f,new_max*sizeof(fnode))) ||
+         !(dc->f_hash = (int*)REALLOC(dc->f_hash,new_max*sizeof(int))) ||
+         !(dc->compiled = (nodei*)REALLOC(dc->compiled,new_max*sizeof(nodei))) ||
+         !(dc->memo = (int*)REALLOC(dc->memo,new_max*sizeof(int))) ||
+         !(dc->stamp = (int*)REALLOC(dc->stamp,new_max*sizeof(int))) )
+        return pg_error(_errmsg,"create_ddnnf: realloc fails");
+    dc->max_f = new_max;
+    for(int i=0; i<new_max; i++)
+        dc->f_hash[i] = -1;
+    for(int i=0; i<dc->n_f; i++) {
+        fnode* f = &dc->f[i];
+        int    h = hash_ints(f->op,f->l,f->r,(f->var<<16)^f->val) & (new_max-1);
+
+        f->next      = dc->f_hash[h];
+        dc->f_hash[h] = i;
+    }
+    for(int i=dc->n_f; i<new_max; i++) {
+        dc->compiled[i] = NODEI_NONE;
+        dc->stamp[i]    = 0;
+    }
+    return BDD_OK;
+}
+
+/*
+ * Returns the unique formula node, simplified, or -1 on error.
+ */
+static int fn_mk(ddnnf_compiler* dc, char op, int l, int r, int var, int val, char** _errmsg) {
+    fnode* f;
+    int    h;
+
+    switch ( op ) {
+     case '!':
+        if ( l <= DC_TRUE )
+            return !l;
+        if ( dc->f[l].op == '!' )
+            return dc->f[l].l;
+        r = 0;
+        break;
+     case '&':
+        if ( (l == DC_FALSE) || (r == DC_FALSE) )
+            return DC_FALSE;
+        if ( (l == DC_TRUE) || (l == r) )
+            return r;
+        if ( r == DC_TRUE )
+            return l;
+        break;
+     case '|':
+        if ( (l == DC_TRUE) || (r == DC_TRUE) )
+            return DC_TRUE;
+        if ( (l == DC_FALSE) || (l == r) )
+            return r;
+        if ( r == DC_FALSE )
+            return l;
+        break;
+    }
+    if ( ((op == '&') || (op == '|')) && (l > r) ) {
+        int tmp = l; l = r; r = tmp; // commutative, one node for a&b and b&a
+    }
+    h = hash_ints(op,l,r,(var<<16)^val) & (dc->max_f-1);
+    for(int i=dc->f_hash[h]; i>=0; i=dc->f[i].next) {
+        f = &dc->f[i];
+        if ( (f->op == op) && (f->l == l) && (f->r == r) && (f->var == var) && (f->val == val) )
+            return i;
+    }
+    if ( (dc->n_f == dc->max_f) ) {
+        if ( !fn_grow(dc,_errmsg) )
+            return -1;
+        h = hash_ints(op,l,r,(var<<16)^val) & (dc->max_f-1);
+    }
+    f = &dc->f[dc->n_f];
+    f->op   = op;
+    f->l    = l;
+    f->r    = r;
+    f->var  = var;
+    f->val  = val;
+    f->next = dc->f_hash[h];
+    dc->f_hash[h] = dc->n_f;
+    return dc->n_f++;
+}
+
+static int dc_var_id(ddnnf_compiler* dc, char* var, int var_len, char** _errmsg) {
+    char name[MAX_RVA_NAME_BUFF];
+    int  l = 0, r = dc->n_var-1;
+
+    if ( var_len > MAX_RVA_NAME ) {
+        pg_error(_errmsg,"rva_name too long (max=%d) / %s",MAX_RVA_NAME,var);
+        return -1;
+    }
+    memcpy(name,var,var_len);
+    name[var_len] = 0;
+    while ( l <= r ) {
+        int m   = l + (r-l)/2;
+        int cmp = strcmp(dc->var[dc->var_sorted[m]],name);
+
+        if ( cmp == 0 )
+            return dc->var_sorted[m];
+        if ( cmp < 0 )
+            l = m + 1;
+        else
+            r = m - 1;
+    }
+    if ( dc->n_var == dc->max_var ) {
+        int new_max = dc->max_var * 2;
+
+        if ( !(dc->var = REALLOC(dc->var,new_max*sizeof(dc->var[0]))) ||
+             !(dc->var_sorted = (int*)REALLOC(dc->var_sorted,new_max*sizeof(int))) ) {
+            pg_error(_errmsg,"create_ddnnf: realloc fails");
+            return -1;
+        }
+        dc->max_var = new_max;
+    }
+    strcpy(dc->var[dc->n_var],name);
+    memmove(&dc->var_sorted[l+1],&dc->var_sorted[l],(dc->n_var-l)*sizeof(int));
+    dc->var_sorted[l] = dc->n_var;
+    return dc->n_var++;
+}
+
+/*
+ * The parser, '&' and '|' have equal priority and are left associative like
+ * in the bee evaluator of create_bdd(). Returns the formula node or -1.
+ */
+
+typedef struct dc_parser {
+    char*      p;
+    expr_token tok;
+} dc_parser;
+
+static int dc_parse_expr(ddnnf_compiler*,dc_parser*,char**);
+
+static int dc_parse_unary(ddnnf_compiler* dc, dc_parser* ps, char** _errmsg) {
+    int res, var, val;
+
+    switch ( ps->tok.type ) {
+     case TOKEN_RVA:
+        if ( (var = dc_var_id(dc,ps->tok.var,ps->tok.var_len,_errmsg)) < 0 )
+            return -1;
+        if ( (val = bdd_atoi(ps->tok.valp)) == NODEI_NONE ) {
+            pg_error(_errmsg,"bad rva value %s=%s",dc->var[var],ps->tok.valp);
+            return -1;
+        }
+        res = fn_mk(dc,FN_RVA,0,0,var,val,_errmsg);
+        break;
+     case TOKEN_CONST:
+        res = (ps->tok.c == '1') ? DC_TRUE : DC_FALSE;
+        break;
+     case TOKEN_OP:
+        if ( ps->tok.c == '!' ) {
+            if ( !expr_next_token(&ps->p,&ps->tok,_errmsg) || ((res = dc_parse_unary(dc,ps,_errmsg)) < 0) )
+                return -1;
+            return fn_mk(dc,'!',res,0,-1,0,_errmsg);
+        } else if ( ps->tok.c == '(' ) {
+            if ( !expr_next_token(&ps->p,&ps->tok,_errmsg) || ((res = dc_parse_expr(dc,ps,_errmsg)) < 0) )
+                return -1;
+            if ( !((ps->tok.type == TOKEN_OP) && (ps->tok.c == ')')) ) {
+                pg_error(_errmsg,"missing \')\' in expr");
+                return -1;
+            }
+            break;
+        }
+        pg_error(_errmsg,"unexpected \'%c\' in expr",ps->tok.c);
+        return -1;
+     default:
+        pg_error(_errmsg,"unexpected end of expr");
+        return -1;
+    }
+    if ( (res < 0) || !expr_next_token(&ps->p,&ps->tok,_errmsg) )
+        return -1;
+    return res;
+}
+
+static int dc_parse_expr(ddnnf_compiler* dc, dc_parser* ps, char** _errmsg) {
+    int res;
+
+    if ( (res = dc_parse_unary(dc,ps,_errmsg)) < 0 )
+        return -1;
+    while ( (ps->tok.type == TOKEN_OP) && ((ps->tok.c == '&') || (ps->tok.c == '|')) ) {
+        char op = ps->tok.c;
+        int  r;
+
+        if ( !expr_next_token(&ps->p,&ps->tok,_errmsg) || ((r = dc_parse_unary(dc,ps,_errmsg)) < 0) )
+            return -1;
+        if ( (res = fn_mk(dc,op,res,r,-1,0,_errmsg)) < 0 )
+            return -1;
+    }
+    return res;
+}
+
+/*
+ * Condition formula node i on var: val >= 0 means var=val, val < 0 means
+ * var has none of the values in the formula. The results are memoized in
+ * the current generation.
+ */
+static int dc_condition(ddnnf_compiler* dc, int i, int var, int val, char** _errmsg) {
+    int res, l, r;
+
+    if ( i <= DC_TRUE )
+        return i;
+    if ( dc->stamp[i] == dc->gen )
+        return dc->memo[i];
+    switch ( dc->f[i].op ) {
+     case FN_RVA:
+        if ( dc->f[i].var != var )
+            res = i;
+        else
+            res = (dc->f[i].val == val) ? DC_TRUE : DC_FALSE;
+        break;
+     case '!':
+        if ( (l = dc_condition(dc,dc->f[i].l,var,val,_errmsg)) < 0 )
+            return -1;
+        res = fn_mk(dc,'!',l,0,-1,0,_errmsg);
+        break;
+     default:
+        if ( ((l = dc_condition(dc,dc->f[i].l,var,val,_errmsg)) < 0) ||
+             ((r = dc_condition(dc,dc->f[i].r,var,val,_errmsg)) < 0) )
+            return -1;
+        res = fn_mk(dc,dc->f[i].op,l,r,-1,0,_errmsg);
+        break;
+    }
+    if ( res < 0 )
+        return -1;
+    dc->stamp[i] = dc->gen;
+    dc->memo[i]  = res;
+    return res;
+}
+
+/*
+ * Output nodes
+ */
+
+static nodei dc_mk(ddnnf_compiler* dc, char* var, int var_id, int val, nodei low, nodei high, char** _errmsg) {
+    int h = hash_ints(var_id,val,low,high) & (dc->max_o-1);
+    rva_node node;
+
+    for(int i=dc->o_hash[h]; i>=0; i=dc->o_next[i]) {
+        rva_node* n_i = V_rva_node_getp(&dc->tree,i);
+
+        if ( (dc->o_var[i] == var_id) && (n_i->low == low) && (n_i->high == high) && (n_i->rva.val == val) && ((var_id >= 0) || (n_i->rva.var[0] == var[0])) )
+            return i;
+    }
+    if ( V_rva_node_size(&dc->tree) == dc->max_o ) {
+        int new_max = dc->max_o * 2;
+
+        if ( !(dc->o_var = (int*)REALLOC(dc->o_var,new_max*sizeof(int))) ||
+             !(dc->o_next = (int*)REALLOC(dc->o_next,new_max*sizeof(int))) ||
+             !(dc->o_hash = (int*)REALLOC(dc->o_hash,new_max*sizeof(int))) ) {
+            pg_error(_errmsg,"create_ddnnf: realloc fails");
+            return NODEI_NONE;
+        }
+        dc->max_o = new_max;
+        for(int i=0; i<new_max; i++)
+            dc->o_hash[i] = -1;
+        for(int i=0; i<V_rva_node_size(&dc->tree); i++) {
+            rva_node* n_i = V_rva_node_getp(&dc->tree,i);
+            int       hi  = hash_ints(dc->o_var[i],n_i->rva.val,n_i->low,n_i->high) & (new_max-1);
+
+            dc->o_next[i]  = dc->o_hash[hi];
+            dc->o_hash[hi] = i;
+        }
+        h = hash_ints(var_id,val,low,high) & (dc->max_o-1);
+    }
+    strcpy(node.rva.var,var);
+    node.rva.val = val;
+    node.low     = low;
+    node.high    = high;
+    if ( V_rva_node_add(&dc->tree,&node) < 0 ) {
+        pg_error(_errmsg,"create_ddnnf: add fails");
+        return NODEI_NONE;
+    }
+    int i = V_rva_node_size(&dc->tree)-1;
+    dc->o_var[i]  = var_id;
+    dc->o_next[i] = dc->o_hash[h];
+    dc->o_hash[h] = i;
+    return i;
+}
+
+#define DC_OP_AND   -1
+#define DC_OP_NOT   -2
+#define DC_LEAF     -3
+
+static nodei dc_mk_not(ddnnf_compiler* dc, nodei a, char** _errmsg) {
+    rva_node* n_a;
+
+    if ( a == NODEI_NONE )
+        return NODEI_NONE;
+    if ( a <= DC_TRUE )
+        return !a;
+    n_a = V_rva_node_getp(&dc->tree,a);
+    if ( IS_DDNNF_NOT(n_a) )
+        return n_a->low;
+    return dc_mk(dc,"!",DC_OP_NOT,0,a,NODEI_NONE,_errmsg);
+}
+
+static nodei dc_mk_and(ddnnf_compiler* dc, nodei a, nodei b, char** _errmsg) {
+    if ( (a == NODEI_NONE) || (b == NODEI_NONE) )
+        return NODEI_NONE;
+    if ( (a == DC_FALSE) || (b == DC_FALSE) )
+        return DC_FALSE;
+    if ( a == DC_TRUE )
+        return b;
+    if ( b == DC_TRUE )
+        return a;
+    if ( a > b ) {
+        nodei tmp = a; a = b; b = tmp;
+    }
+    return dc_mk(dc,"&",DC_OP_AND,0,a,b,_errmsg);
+}
+
+static nodei dc_mk_decision(ddnnf_compiler* dc, int var, int val, nodei low, nodei high, char** _errmsg) {
+    if ( (low == NODEI_NONE) || (high == NODEI_NONE) )
+        return NODEI_NONE;
+    if ( low == high )
+        return low;
+    return dc_mk(dc,dc->var[var],var,val,low,high,_errmsg);
+}
+
+/*
+ * Compilation
+ */
+
+static void dc_collect(ddnnf_compiler* dc, int i, char op, int* ops, int* n_ops) {
+    if ( dc->f[i].op == op ) {
+        dc_collect(dc,dc->f[i].l,op,ops,n_ops);
+        dc_collect(dc,dc->f[i].r,op,ops,n_ops);
+    } else
+        ops[(*n_ops)++] = i;
+}
+
+static int dc_count_ops(ddnnf_compiler* dc, int i, char op) {
+    if ( dc->f[i].op == op )
+        return dc_count_ops(dc,dc->f[i].l,op) + dc_count_ops(dc,dc->f[i].r,op);
+    return 1;
+}
+
+static int uf_find(int* parent, int k) {
+    while ( parent[k] != k )
+        k = parent[k] = parent[parent[k]];
+    return k;
+}
+
+static void uf_union(int* parent, int a, int b) {
+    a = uf_find(parent,a);
+    b = uf_find(parent,b);
+    if ( a != b )
+        parent[(a > b) ? a : b] = (a > b) ? b : a; // the root is the smallest
+}
+
+/*
+ * Visit the nodes of operand k once in this generation, count the var
+ * occurrences and join the operands with common vars. A node shared with an
+ * operand visited before joins both operands, memo[] has that operand.
+ */
+static void dc_scan(ddnnf_compiler* dc, int i, int k, int* parent) {
+    fnode* f = &dc->f[i];
+
+    if ( i <= DC_TRUE )
+        return;
+    if ( dc->stamp[i] == dc->gen ) {
+        uf_union(parent,dc->memo[i],k);
+        return;
+    }
+    dc->stamp[i] = dc->gen;
+    dc->memo[i]  = k;
+    if ( f->op == FN_RVA ) {
+        dc->var_count[f->var]++;
+        if ( dc->var_stamp[f->var] != dc->gen ) {
+            dc->var_stamp[f->var] = dc->gen;
+            dc->var_owner[f->var] = k;
+        } else
+            uf_union(parent,dc->var_owner[f->var],k);
+    } else {
+        dc_scan(dc,f->l,k,parent);
+        if ( f->op != '!' )
+            dc_scan(dc,f->r,k,parent);
+    }
+}
+
+static void dc_values(ddnnf_compiler* dc, int i, int var, int* vals, int* n) {
+    fnode* f = &dc->f[i];
+
+    if ( (i <= DC_TRUE) || (dc->stamp[i] == dc->gen) )
+        return;
+    dc->stamp[i] = dc->gen;
+    if ( f->op == FN_RVA ) {
+        if ( f->var == var ) {
+            if ( vals )
+                vals[*n] = f->val;
+            (*n)++;
+        }
+    } else {
+        dc_values(dc,f->l,var,vals,n);
+        if ( f->op != '!' )
+            dc_values(dc,f->r,var,vals,n);
+    }
+}
+
+static int cmpIntVal(const void* l, const void* r) {
+    return (*(int*)l > *(int*)r) - (*(int*)l < *(int*)r);
+}
+
+static nodei dc_compile(ddnnf_compiler*,int,char**);
+
+static nodei dc_branch(ddnnf_compiler* dc, int i, int var, char** _errmsg) {
+    int*  vals;
+    nodei res;
+    int   n_vals = 0, n = 0, c;
+
+    dc->gen++;
+    dc_values(dc,i,var,NULL,&n_vals);
+    if ( !(vals = (int*)MALLOC(n_vals*sizeof(int))) ) {
+        pg_error(_errmsg,"create_ddnnf: malloc fails");
+        return NODEI_NONE;
+    }
+    n_vals = 0;
+    dc->gen++;
+    dc_values(dc,i,var,vals,&n_vals);
+    qsort(vals,n_vals,sizeof(int),cmpIntVal);
+    for(int v=0; v<n_vals; v++)
+        if ( (n == 0) || (vals[v] != vals[n-1]) )
+            vals[n++] = vals[v];
+    dc->gen++;
+    if ( (c = dc_condition(dc,i,var,-1,_errmsg)) < 0 )
+        res = NODEI_NONE;
+    else
+        res = dc_compile(dc,c,_errmsg);
+    for(int v=n-1; (v>=0) && (res!=NODEI_NONE); v--) {
+        nodei high;
+
+        dc->gen++;
+        if ( (c = dc_condition(dc,i,var,vals[v],_errmsg)) < 0 )
+            res = NODEI_NONE;
+        else if ( (high = dc_compile(dc,c,_errmsg)) == NODEI_NONE )
+            res = NODEI_NONE;
+        else
+            res = dc_mk_decision(dc,var,vals[v],res,high,_errmsg);
+    }
+    FREE(vals);
+    return res;
+}
+
+static nodei dc_split(ddnnf_compiler* dc, int i, char** _errmsg) {
+    char  op    = dc->f[i].op;
+    int   n_ops = 0, n_groups = 0, best = -1;
+    int  *ops, *parent;
+    nodei res   = (op == '&') ? DC_TRUE : DC_FALSE;
+
+    n_ops = dc_count_ops(dc,i,op);
+    if ( !(ops = (int*)MALLOC(2*n_ops*sizeof(int))) ) {
+        pg_error(_errmsg,"create_ddnnf: malloc fails");
+        return NODEI_NONE;
+    }
+    parent = &ops[n_ops];
+    n_ops  = 0;
+    dc_collect(dc,i,op,ops,&n_ops);
+    dc->gen++;
+    for(int v=0; v<dc->n_var; v++)
+        dc->var_count[v] = 0;
+    for(int k=0; k<n_ops; k++)
+        parent[k] = k;
+    for(int k=0; k<n_ops; k++)
+        dc_scan(dc,ops[k],k,parent);
+    for(int k=0; k<n_ops; k++)
+        if ( uf_find(parent,k) == k )
+            n_groups++;
+    if ( n_groups == 1 ) {
+        for(int v=0; v<dc->n_var; v++)
+            if ( (best < 0) || (dc->var_count[v] > dc->var_count[best]) )
+                best = v;
+        FREE(ops);
+        return dc_branch(dc,i,best,_errmsg);
+    }
+    // every group is the root of its union-find set, its smallest operand
+    for(int g=0; (g<n_ops) && (res!=NODEI_NONE); g++) {
+        int   group = ops[g];
+        nodei c;
+
+        if ( uf_find(parent,g) != g )
+            continue;
+        for(int k=g+1; (k<n_ops) && (group>=0); k++)
+            if ( uf_find(parent,k) == g )
+                group = fn_mk(dc,op,group,ops[k],-1,0,_errmsg);
+        if ( group < 0 )
+            res = NODEI_NONE;
+        else if ( op == '&' ) {
+            c   = dc_compile(dc,group,_errmsg);
+            res = dc_mk_and(dc,res,c,_errmsg);
+        } else {
+            c   = dc_mk_not(dc,dc_compile(dc,group,_errmsg),_errmsg);
+            res = dc_mk_and(dc,dc_mk_not(dc,res,_errmsg),c,_errmsg);
+            res = dc_mk_not(dc,res,_errmsg);
+        }
+    }
+    FREE(ops);
+    return res;
+}
+
+static nodei dc_compile(ddnnf_compiler* dc, int i, char** _errmsg) {
+    nodei res;
+
+    if ( i <= DC_TRUE )
+        return i;
+    if ( dc->compiled[i] != NODEI_NONE )
+        return dc->compiled[i];
+    switch ( dc->f[i].op ) {
+     case FN_RVA:
+        res = dc_mk_decision(dc,dc->f[i].var,dc->f[i].val,DC_FALSE,DC_TRUE,_errmsg);
+        break;
+     case '!':
+        res = dc_mk_not(dc,dc_compile(dc,dc->f[i].l,_errmsg),_errmsg);
+        break;
+     default:
+        res = dc_split(dc,i,_errmsg);
+        break;
+    }
+    if ( res != NODEI_NONE )
+        dc->compiled[i] = res;
+    return res;
+}
+
+static int dc_init(ddnnf_compiler* dc, char** _errmsg) {
+    rva_node leaf = {.low = NODEI_NONE, .high = NODEI_NONE, .rva = {.val = 0}};
+
+    memset(dc,0,sizeof(ddnnf_compiler));
+    V_rva_node_init(&dc->tree);
+    dc->max_f = 256;
+    dc->max_var = 16;
+    dc->max_o = 256;
+    dc->f          = (fnode*)MALLOC(dc->max_f*sizeof(fnode));
+    dc->f_hash     = (int*)MALLOC(dc->max_f*sizeof(int));
+    dc->compiled   = (nodei*)MALLOC(dc->max_f*sizeof(nodei));
+    dc->memo       = (int*)MALLOC(dc->max_f*sizeof(int));
+    dc->stamp      = (int*)MALLOC(dc->max_f*sizeof(int));
+    dc->var        = MALLOC(dc->max_var*sizeof(dc->var[0]));
+    dc->var_sorted = (int*)MALLOC(dc->max_var*sizeof(int));
+    dc->o_var      = (int*)MALLOC(dc->max_o*sizeof(int));
+    dc->o_hash     = (int*)MALLOC(dc->max_o*sizeof(int));
+    dc->o_next     = (int*)MALLOC(dc->max_o*sizeof(int));
+    if ( !dc->f || !dc->f_hash || !dc->compiled || !dc->memo || !dc->stamp || !dc->var || !dc->var_sorted || !dc->o_var || !dc->o_hash || !dc->o_next )
+        return pg_error(_errmsg,"create_ddnnf: malloc fails");
+    for(int i=0; i<dc->max_f; i++) {
+        dc->f_hash[i]   = -1;
+        dc->compiled[i] = NODEI_NONE;
+        dc->stamp[i]    = 0;
+    }
+    for(int i=0; i<dc->max_o; i++)
+        dc->o_hash[i] = -1;
+    // formula and output node 0 and 1 are FALSE and TRUE
+    dc->f[DC_FALSE].op = '0';
+    dc->f[DC_TRUE].op  = '1';
+    dc->n_f = 2;
+    strcpy(leaf.rva.var,"0");
+    if ( V_rva_node_add(&dc->tree,&leaf) < 0 )
+        return pg_error(_errmsg,"create_ddnnf: add fails");
+    strcpy(leaf.rva.var,"1");
+    if ( V_rva_node_add(&dc->tree,&leaf) < 0 )
+        return pg_error(_errmsg,"create_ddnnf: add fails");
+    dc->o_var[DC_FALSE] = dc->o_var[DC_TRUE] = DC_LEAF;
+    dc->o_next[DC_FALSE] = dc->o_next[DC_TRUE] = -1;
+    return BDD_OK;
+}
+
+static void dc_free(ddnnf_compiler* dc) {
+    if ( dc->f )          FREE(dc->f);
+    if ( dc->f_hash )     FREE(dc->f_hash);
+    if ( dc->compiled )   FREE(dc->compiled);
+    if ( dc->memo )       FREE(dc->memo);
+    if ( dc->stamp )      FREE(dc->stamp);
+    if ( dc->var )        FREE(dc->var);
+    if ( dc->var_sorted ) FREE(dc->var_sorted);
+    if ( dc->var_count )  FREE(dc->var_count);
+    if ( dc->var_owner )  FREE(dc->var_owner);
+    if ( dc->var_stamp )  FREE(dc->var_stamp);
+    if ( dc->o_var )      FREE(dc->o_var);
+    if ( dc->o_hash )     FREE(dc->o_hash);
+    if ( dc->o_next )     FREE(dc->o_next);
+    V_rva_node_free(&dc->tree);
+}
+
+#define DDNNF_BASE_SIZE   (sizeof(ddnnf) - sizeof(V_rva_node))
+
+/*
+ * Serialize the nodes reachable from root, root is the last node then.
+ */
+static ddnnf* dc_serialize(ddnnf_compiler* dc, nodei root, char** _errmsg) {
+    V_rva_node tree;
+    nodei*     map;
+    ddnnf*     res = NULL;
+    int        bytesize;
+
+    if ( !(map = (nodei*)MALLOC((root+1)*sizeof(nodei))) ) {
+        pg_error(_errmsg,"create_ddnnf: malloc fails");
+        return NULL;
+    }
+    for(nodei i=0; i<root; i++)
+        map[i] = NODEI_NONE;
+    map[root] = 0;
+    for(nodei i=root; i>=0; i--) {
+        rva_node* n_i = V_rva_node_getp(&dc->tree,i);
+
+        if ( (map[i] != NODEI_NONE) && !IS_LEAF(n_i) ) {
+            map[n_i->low] = 0;
+            if ( n_i->high != NODEI_NONE )
+                map[n_i->high] = 0;
+        }
+    }
+    V_rva_node_init(&tree);
+    for(nodei i=0; i<=root; i++) {
+        rva_node node;
+
+        if ( map[i] == NODEI_NONE )
+            continue;
+        node = *V_rva_node_getp(&dc->tree,i);
+        if ( !IS_LEAF(&node) ) {
+            node.low = map[node.low];
+            if ( node.high != NODEI_NONE )
+                node.high = map[node.high];
+        }
+        if ( (map[i] = V_rva_node_add(&tree,&node)) < 0 ) {
+            pg_error(_errmsg,"create_ddnnf: add fails");
+            V_rva_node_free(&tree);
+            FREE(map);
+            return NULL;
+        }
+    }
+    FREE(map);
+    V_rva_node_shrink2size(&tree);
+    bytesize = DDNNF_BASE_SIZE + V_rva_node_bytesize(&tree);
+    if ( (res = (ddnnf*)MALLOC(bytesize)) ) {
+        res->bytesize = bytesize;
+        V_rva_node_serialize(&res->tree,&tree);
+    } else
+        pg_error(_errmsg,"create_ddnnf: malloc fails");
+    V_rva_node_free(&tree);
+    return res;
+}
+
+ddnnf* create_ddnnf(char* expr, char** _errmsg) {
+    ddnnf_compiler dc;
+    dc_parser      ps = {.p = expr};
+    ddnnf*         res = NULL;
+    int            f;
+    nodei          root;
+
+    if ( dc_init(&dc,_errmsg) && expr_next_token(&ps.p,&ps.tok,_errmsg) && ((f = dc_parse_expr(&dc,&ps,_errmsg)) >= 0) ) {
+        if ( ps.tok.type != TOKEN_END )
+            pg_error(_errmsg,"unexpected \'%c\' in expr",ps.tok.c);
+        else if ( !(dc.var_count = (int*)MALLOC((dc.n_var+1)*sizeof(int))) ||
+                  !(dc.var_owner = (int*)MALLOC((dc.n_var+1)*sizeof(int))) ||
+                  !(dc.var_stamp = (int*)MALLOC((dc.n_var+1)*sizeof(int))) )
+            pg_error(_errmsg,"create_ddnnf: malloc fails");
+        else {
+            for(int v=0; v<dc.n_var; v++)
+                dc.var_stamp[v] = 0;
+            if ( (root = dc_compile(&dc,f,_errmsg)) != NODEI_NONE )
+                res = dc_serialize(&dc,root,_errmsg);
+        }
+    }
+    dc_free(&dc);
+    return res;
+}
+
+ddnnf* relocate_ddnnf(ddnnf* tbr) {
+    V_rva_node_relocate(&tbr->tree);
+    return tbr;
+}
+
+/*
+ * Text representation, an rva expression equivalent to the ddnnf.
+ */
+
+#define IS_LEAF_VALUE(PD,I,V) (IS_LEAF(DDNNF_NODE(PD,I)) && (LEAF_BOOLVALUE(DDNNF_NODE(PD,I)) == (V)))
+
+static void _ddnnf2string(pbuff* pb, ddnnf* dd, nodei i) {
+    rva_node* node = DDNNF_NODE(dd,i);
+
+    if ( IS_LEAF(node) ) {
+        bprintf(pb,"%s",node->rva.var);
+    } else if ( IS_DDNNF_NOT(node) ) {
+        bprintf(pb,"!");
+        _ddnnf2string(pb,dd,node->low);
+    } else if ( IS_DDNNF_AND(node) ) {
+        bprintf(pb,"(");
+        _ddnnf2string(pb,dd,node->low);
+        bprintf(pb,"&");
+        _ddnnf2string(pb,dd,node->high);
+        bprintf(pb,")");
+    } else if ( IS_LEAF(DDNNF_NODE(dd,node->high)) && IS_LEAF(DDNNF_NODE(dd,node->low)) ) {
+        bprintf(pb,(IS_LEAF_VALUE(dd,node->high,1) ? "%s=%d" : "!%s=%d"),node->rva.var,node->rva.val);
+    } else if ( IS_LEAF_VALUE(dd,node->high,1) || IS_LEAF_VALUE(dd,node->high,0) ) {
+        bprintf(pb,(IS_LEAF_VALUE(dd,node->high,1) ? "(%s=%d|" : "(!%s=%d&"),node->rva.var,node->rva.val);
+        _ddnnf2string(pb,dd,node->low);
+        bprintf(pb,")");
+    } else if ( IS_LEAF_VALUE(dd,node->low,0) || IS_LEAF_VALUE(dd,node->low,1) ) {
+        bprintf(pb,(IS_LEAF_VALUE(dd,node->low,0) ? "(%s=%d&" : "(!%s=%d|"),node->rva.var,node->rva.val);
+        _ddnnf2string(pb,dd,node->high);
+        bprintf(pb,")");
+    } else {
+        bprintf(pb,"((%s=%d&",node->rva.var,node->rva.val);
+        _ddnnf2string(pb,dd,node->high);
+        bprintf(pb,")|(!%s=%d&",node->rva.var,node->rva.val);
+        _ddnnf2string(pb,dd,node->low);
+        bprintf(pb,"))");
+    }
+}
+
+void ddnnf2string(pbuff* pb, ddnnf* dd, int encapsulate) {
+    if ( encapsulate ) bprintf(pb,"Ddnnf(");
+    _ddnnf2string(pb,dd,DDNNF_ROOT(dd));
+    if ( encapsulate ) bprintf(pb,")");
+}
+
+void ddnnf_info(ddnnf* dd, pbuff* pbuff) {
+    int n_and = 0, n_not = 0, n_decision = 0;
+
+    for(nodei i=0; i<DDNNF_TREESIZE(dd); i++) {
+        rva_node* node = DDNNF_NODE(dd,i);
+
+        if ( IS_DDNNF_AND(node) )
+            n_and++;
+        else if ( IS_DDNNF_NOT(node) )
+            n_not++;
+        else if ( !IS_LEAF(node) )
+            n_decision++;
+    }
+    bprintf(pbuff,"ddnnf: nodes=%d, decision=%d, and=%d, not=%d, bytesize=%d",DDNNF_TREESIZE(dd),n_decision,n_and,n_not,dd->bytesize);
+}
+
+/*
+ * Probability, computed in one ascending pass. The decision nodes use the
+ * same S/M/E chain computation as bdd_probability() does.
+ */
+
+int ddnnf_bind_probabilities(bdd_dictionary* dict, ddnnf* dd, double* prob, char** _errmsg) {
+    pbuff pbuff_struct, *missing = pbuff_init(&pbuff_struct);
+    int   n_missing;
+
+    if ( (n_missing = tree_bind_probabilities(dict,&dd->tree,prob,missing,_errmsg)) > 0 ) {
+        pbuff dd_pbuff_struct, *dd_pbuff=pbuff_init(&dd_pbuff_struct);
+
+        ddnnf2string(dd_pbuff,dd,0);
+        pg_error(_errmsg,"dictionary_lookup: rva[%s] not found in %s.",missing->buffer,dd_pbuff->buffer);
+        pbuff_free(dd_pbuff);
+    }
+    pbuff_free(missing);
+    return (n_missing == 0) ? BDD_OK : BDD_FAIL;
+}
+
+typedef struct ddnnf_prob {
+    double P, S, M;
+    nodei  E;
+} ddnnf_prob;
+
+double ddnnf_probability(bdd_dictionary* dict, ddnnf* dd, char** _errmsg) {
+    ddnnf_prob* ps;
+    double*     prob;
+    double      res = -1.0;
+    nodei       root = DDNNF_ROOT(dd);
+
+    if ( !(ps = (ddnnf_prob*)MALLOC(DDNNF_TREESIZE(dd)*(sizeof(ddnnf_prob)+sizeof(double)))) ) {
+        pg_error(_errmsg,"ddnnf_probability: scratch malloc fails");
+        return -1.0;
+    }
+    prob = (double*)&ps[DDNNF_TREESIZE(dd)];
+    if ( ddnnf_bind_probabilities(dict,dd,prob,_errmsg) ) {
+        for(nodei i=0; i<=root; i++) {
+            rva_node*   n_i = DDNNF_NODE(dd,i);
+            ddnnf_prob* s   = &ps[i];
+
+            s->M = 0.0;
+            s->E = i;
+            if ( IS_LEAF(n_i) )
+                s->P = LEAF_BOOLVALUE(n_i) ? 1.0 : 0.0;
+            else if ( IS_DDNNF_AND(n_i) )
+                s->P = ps[n_i->low].P * ps[n_i->high].P;
+            else if ( IS_DDNNF_NOT(n_i) )
+                s->P = 1.0 - ps[n_i->low].P;
+            else {
+                rva_node* n_low = DDNNF_NODE(dd,n_i->low);
+
+                s->S = prob[i] * ps[n_i->high].P;
+                s->M = prob[i];
+                if ( IS_RVA_NODE(n_low) && IS_SAMEVAR(&n_low->rva,&n_i->rva) ) {
+                    s->S += ps[n_i->low].S;
+                    s->M += ps[n_i->low].M;
+                    s->E  = ps[n_i->low].E;
+                } else
+                    s->E  = n_i->low;
+                s->P = s->S + (1.0 - s->M) * ps[s->E].P;
+                if ( s->P < 0.0 ) // tiny rounding error
+                    s->P = 0.0;
+            }
+            if ( s->P > 1.0 + 1e-9 ) {
+                pg_error(_errmsg,"ddnnf_probability: probvalue %f out of range",s->P);
+                FREE(ps);
+                return -1.0;
+            }
+        }
+        res = ps[root].P;
+    }
+    FREE(ps);
+    return res;
+}
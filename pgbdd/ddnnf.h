@@ -0,0 +1,59 @@
+/*
+ * This file is part of the Dubio distribution (https://github.com/utwente-db/DuBio).
+ * Copyright (c) 2020 Jan Flokstra & Maurice van Keulen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef DDNNF_H
+#define DDNNF_H
+
+/*
+ * The ddnnf type is a decision-DNNF circuit over rva's, an alternative for
+ * the bdd when every var order gives a big bdd. It is stored like a bdd, as
+ * an array of rva_node's where the children have a lower index and the root
+ * is the last node. Next to the leafs and the decision nodes of a bdd,
+ * x=v ? high : low with the same chains of values of x on the low edges,
+ * there are two operator nodes:
+ *
+ *      AND: var "&", low and high are conjuncts without common vars
+ *      NOT: var "!", low is the operand and high is NODEI_NONE
+ *
+ * Because of this the probability is computed in one pass over the nodes.
+ */
+
+typedef struct ddnnf {
+    char       vl_len[4]; // used by Postgres memory management
+    int        bytesize;  // size in bytes of serialized ddnnf
+    V_rva_node tree;
+    // because serialized tree grows in memory do not define attributes here!!!
+} ddnnf;
+
+#define DDNNF_NODE(PD,I)      BDD_NODE(PD,I)
+#define DDNNF_TREESIZE(PD)    BDD_TREESIZE(PD)
+#define DDNNF_ROOT(PD)        BDD_ROOT(PD)
+
+#define IS_DDNNF_AND(N)       ((N)->rva.var[0]=='&')
+#define IS_DDNNF_NOT(N)       ((N)->rva.var[0]=='!')
+
+ddnnf* create_ddnnf(char*,char**);
+ddnnf* relocate_ddnnf(ddnnf*);
+
+void   ddnnf2string(pbuff*,ddnnf*,int);
+void   ddnnf_info(ddnnf*,pbuff*);
+
+int    ddnnf_bind_probabilities(bdd_dictionary*,ddnnf*,double*,char**);
+double ddnnf_probability(bdd_dictionary*,ddnnf*,char**);
+
+void test_ddnnf(void);
+
+#endif
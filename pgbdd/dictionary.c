@@ -81,6 +81,187 @@ static int bdd_dictionary_sort(bdd_dictionary* dict) {
     return 1;
 }
 
+/*
+ * Dictionary index. dictionary_prepare2store() appends an index after the
+ * serialized values: an open addressing hash on the variable names and per
+ * variable a direct-index table for dense values or a permutation sorted on
+ * value for binary search. The index ends with a trailer at the end of the
+ * dictionary, so the header layout is unchanged and dictionaries stored
+ * without an index use the old lookup functions.
+ */
+
+#define DICT_INDEX_MAGIC          0x58444944 // "DIDX"
+#define DICT_INDEX_IS_DENSE(R,C)  ((R) <= (2*(int64_t)(C)+8))
+#define DICT_INDEX_ALIGN(S)       (((S)+7) & ~((size_t)7))
+
+typedef struct dict_index_var {
+    int32_t vmin;     // smallest value of the var
+    int32_t n_slots;  // dense: vmax-vmin+1, sorted: card
+    int32_t dense;
+    int32_t slot_off; // first slot of var in slots
+} dict_index_var;
+
+typedef struct dict_index {
+    uint32_t magic;
+    uint32_t n_var;
+    uint32_t hash_mask; // hash size-1, the hash size is a power of 2
+    uint32_t n_slots;
+    // int32_t        hash[hash_mask+1]; var index+1, 0 is empty
+    // dict_index_var var[n_var];
+    // int32_t        slots[n_slots];    value index, -1 is empty
+} dict_index;
+
+typedef struct dict_index_trailer {
+    uint32_t bytesize; // bytesize of the index including the trailer
+    uint32_t magic;
+} dict_index_trailer;
+
+#define DICT_INDEX_HASH(IDX)   ((int32_t*)((IDX)+1))
+#define DICT_INDEX_VARS(IDX)   ((dict_index_var*)(DICT_INDEX_HASH(IDX)+(IDX)->hash_mask+1))
+#define DICT_INDEX_SLOTS(IDX)  ((int32_t*)(DICT_INDEX_VARS(IDX)+(IDX)->n_var))
+
+static uint32_t dict_name_hash(char* name) {
+    uint32_t h = 2166136261u; // FNV-1a
+
+    while ( *name ) {
+        h ^= (unsigned char)*name++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static dict_index* get_dict_index(bdd_dictionary* dict) {
+    dict_index_trailer* trailer;
+    dict_index*         idx;
+
+    if ( (dict->bytesize < (int)(BDD_DICTIONARY_BASESIZE+sizeof(dict_index)+sizeof(dict_index_trailer))) ||
+         !V_dict_var_is_serialized(dict->variables) || !V_dict_val_is_serialized(dict->values) )
+        return NULL;
+    trailer = (dict_index_trailer*)((char*)dict + dict->bytesize - sizeof(dict_index_trailer));
+    if ( (trailer->magic != DICT_INDEX_MAGIC) || (trailer->bytesize > (uint32_t)dict->bytesize) ) // bytesize checked positive above
+        return NULL;
+    idx = (dict_index*)((char*)dict + dict->bytesize - trailer->bytesize);
+    if ( (idx->magic != DICT_INDEX_MAGIC) || (V_dict_var_size(dict->variables) < 0) || (idx->n_var != (uint32_t)V_dict_var_size(dict->variables)) )
+        return NULL;
+    return idx;
+}
+
+static void invalidate_dict_index(bdd_dictionary* dict) {
+    dict_index* idx;
+
+    if ( (idx = get_dict_index(dict)) ) {
+        ((dict_index_trailer*)((char*)dict + dict->bytesize - sizeof(dict_index_trailer)))->magic = 0;
+        idx->magic = 0;
+    }
+}
+
+typedef struct value_slot {
+    int     value;
+    int32_t slot;
+} value_slot;
+
+static int cmpValueSlot(const void* l, const void* r) {
+    int lv = ((value_slot*)l)->value, rv = ((value_slot*)r)->value;
+    return (lv < rv) ? -1 : ((lv > rv) ? 1 : 0);
+}
+
+/*
+ * Create a copy of the serialized dictionary dict with an index appended. The
+ * old dict is FREE'd. When there is no memory for the copy dict is returned
+ * unchanged, a dictionary without index is still valid, only slower.
+ */
+static bdd_dictionary* dictionary_add_index(bdd_dictionary* dict) {
+    int         n_var     = V_dict_var_size(dict->variables);
+    size_t      data_size = DICT_INDEX_ALIGN(BDD_DICTIONARY_BASESIZE + dict->val_offset + V_dict_val_bytesize(dict->values));
+    uint32_t    hash_sz   = 8;
+    uint32_t    n_slots   = 0;
+    size_t      index_size;
+    dict_index *idx;
+    bdd_dictionary *res;
+    value_slot *vs = NULL;
+    dindex      max_card = 0;
+
+    while ( hash_sz < (uint32_t)(2*n_var) )
+        hash_sz *= 2;
+    for(int i=0; i<n_var; i++) {
+        dict_var* varp = V_dict_var_getp(dict->variables,i);
+        int32_t   vmin = INT_MAX, vmax = INT_MIN;
+
+        for(dindex j=varp->offset; j<(varp->offset+varp->card); j++) {
+            int v = dict->values->items[j].value;
+            if ( v < vmin ) vmin = v;
+            if ( v > vmax ) vmax = v;
+        }
+        if ( (varp->card > 0) && DICT_INDEX_IS_DENSE((int64_t)vmax-vmin+1,varp->card) )
+            n_slots += vmax-vmin+1;
+        else
+            n_slots += varp->card;
+        if ( varp->card > max_card )
+            max_card = varp->card;
+    }
+    index_size = DICT_INDEX_ALIGN(sizeof(dict_index) + hash_sz*sizeof(int32_t) + n_var*sizeof(dict_index_var) + n_slots*sizeof(int32_t)) + sizeof(dict_index_trailer);
+    if ( !(res = (bdd_dictionary*)MALLOC(data_size+index_size)) )
+        return dict;
+    if ( (max_card > 0) && !(vs = (value_slot*)MALLOC(max_card*sizeof(value_slot))) ) {
+        FREE(res);
+        return dict;
+    }
+    memset(res,0,data_size+index_size);
+    memcpy(res,dict,BDD_DICTIONARY_BASESIZE + dict->val_offset + V_dict_val_bytesize(dict->values));
+    res->bytesize = (int)(data_size+index_size);
+    bdd_dictionary_relocate(res);
+    FREE(dict);
+    //
+    idx = (dict_index*)((char*)res + data_size);
+    idx->magic     = DICT_INDEX_MAGIC;
+    idx->n_var     = n_var;
+    idx->hash_mask = hash_sz-1;
+    idx->n_slots   = n_slots;
+    n_slots        = 0;
+    for(int i=0; i<n_var; i++) {
+        dict_var*       varp = V_dict_var_getp(res->variables,i);
+        dict_index_var* iv   = &DICT_INDEX_VARS(idx)[i];
+        int32_t*        slot = DICT_INDEX_SLOTS(idx) + n_slots;
+        uint32_t        h;
+        int32_t         vmin = INT_MAX, vmax = INT_MIN;
+
+        for(h=dict_name_hash(varp->name)&idx->hash_mask; DICT_INDEX_HASH(idx)[h]; h=(h+1)&idx->hash_mask)
+            ;
+        DICT_INDEX_HASH(idx)[h] = i+1;
+        for(dindex j=varp->offset; j<(varp->offset+varp->card); j++) {
+            int v = res->values->items[j].value;
+            if ( v < vmin ) vmin = v;
+            if ( v > vmax ) vmax = v;
+        }
+        iv->vmin     = vmin;
+        iv->slot_off = n_slots;
+        if ( (varp->card > 0) && DICT_INDEX_IS_DENSE((int64_t)vmax-vmin+1,varp->card) ) {
+            iv->dense   = 1;
+            iv->n_slots = vmax-vmin+1;
+            for(int k=0; k<iv->n_slots; k++)
+                slot[k] = -1;
+            for(dindex j=varp->offset; j<(varp->offset+varp->card); j++)
+                slot[res->values->items[j].value-vmin] = (int32_t)j;
+        } else {
+            iv->dense   = 0;
+            iv->n_slots = varp->card;
+            for(dindex j=0; j<varp->card; j++) {
+                vs[j].value = res->values->items[varp->offset+j].value;
+                vs[j].slot  = (int32_t)(varp->offset+j);
+            }
+            qsort(vs,varp->card,sizeof(value_slot),cmpValueSlot);
+            for(dindex j=0; j<varp->card; j++)
+                slot[j] = vs[j].slot;
+        }
+        n_slots += iv->n_slots;
+    }
+    if ( vs )
+        FREE(vs);
+    ((dict_index_trailer*)((char*)res + res->bytesize - sizeof(dict_index_trailer)))->bytesize = (uint32_t)index_size;
+    ((dict_index_trailer*)((char*)res + res->bytesize - sizeof(dict_index_trailer)))->magic    = DICT_INDEX_MAGIC;
+    return res;
+}
+
 bdd_dictionary* dictionary_prepare2store(bdd_dictionary* dict) {
     bdd_dictionary *res = NULL;
 
@@ -111,6 +292,7 @@ bdd_dictionary* dictionary_prepare2store(bdd_dictionary* dict) {
          * Do not remove 'dict' itself, this is pfreed() by Postgres.
          */
         bdd_dictionary_free(dict);
+        res = dictionary_add_index(res);
     }
     return res;
 }
@@ -157,6 +339,7 @@ void bdd_dictionary_print(bdd_dictionary* dict, int all, pbuff* pbuff) {
         bprintf(pbuff,"# sorted=%d\n",dict->var_sorted);
         bprintf(pbuff,"# val_deleted=%d\n",dict->val_deleted);
         bprintf(pbuff,"# serialized=%d\n",bdd_dictionary_is_serialized(dict));
+        bprintf(pbuff,"# index=%d\n",(get_dict_index(dict) != NULL));
     }
     if ( all ) {
         for(int i=0; i<V_dict_var_size(dict->variables); i++) {
@@ -182,8 +365,20 @@ void bdd_dictionary_print(bdd_dictionary* dict, int all, pbuff* pbuff) {
 }
 
 static int lookup_var_index(bdd_dictionary* dict, char* name) {
-    dict_var tofind;
+    dict_var    tofind;
+    dict_index* idx;
 
+    if ( (idx = get_dict_index(dict)) ) {
+        int32_t* hash = DICT_INDEX_HASH(idx);
+
+        for(uint32_t h=dict_name_hash(name)&idx->hash_mask; hash[h]; h=(h+1)&idx->hash_mask) {
+            if ( strcmp(dict->variables->items[hash[h]-1].name,name) == 0 )
+                return hash[h]-1;
+        }
+        return -1;
+    }
+    if ( strlen(name) > MAX_RVA_NAME )
+        return -1;
     strcpy(tofind.name, name);
     if ( dict->var_sorted )
         return V_dict_var_bsearch(dict->variables,cmpDict_var,&tofind);
@@ -230,6 +425,30 @@ static dict_val* add_value(bdd_dictionary* dict, int value, double prob) {
 }
 
 static int get_var_value_index(bdd_dictionary* dict, dict_var* varp, int val) {
+    dict_index* idx;
+
+    if ( (val >= 0) && (idx = get_dict_index(dict)) ) {
+        dict_index_var* iv   = &DICT_INDEX_VARS(idx)[varp - dict->variables->items];
+        int32_t*        slot = DICT_INDEX_SLOTS(idx) + iv->slot_off;
+
+        if ( iv->dense ) {
+            int64_t d = (int64_t)val - iv->vmin;
+            return ((d >= 0) && (d < iv->n_slots)) ? slot[d] : -1;
+        } else {
+            int l = 0, r = iv->n_slots-1;
+            while ( l <= r ) {
+                int m = (l+r)/2;
+                int v = dict->values->items[slot[m]].value;
+                if ( v == val )
+                    return slot[m];
+                else if ( v < val )
+                    l = m+1;
+                else
+                    r = m-1;
+            }
+            return -1;
+        }
+    }
     if ( val >= 0 ) {
         for(dindex i=varp->offset; i<(varp->offset+varp->card); i++) {
             dict_val* valp = V_dict_val_getp(dict->values,i);
@@ -249,6 +468,94 @@ double lookup_probability(bdd_dictionary* dict,rva* rva) {
     return -1.0;
 }
 
+/*
+ * Returns the values of var, these are consecutive in the dictionary, and sets
+ * *card to their number. Returns NULL when var is unknown.
+ */
+dict_val* lookup_var_values(bdd_dictionary* dict, char* var, int* card) {
+    dict_var* varp = bdd_dictionary_lookup_var(dict,var);
+
+    if ( !varp )
+        return NULL;
+    *card = (int)varp->card;
+    return &dict->values->items[varp->offset];
+}
+
+dict_sampler* dictionary_sampler(bdd_dictionary* dict, char** _errmsg) {
+    dict_sampler* res;
+    int           n = V_dict_var_size(dict->variables);
+
+    if ( !(res = (dict_sampler*)MALLOC(sizeof(dict_sampler)+V_dict_val_size(dict->values)*sizeof(double))) ) {
+        pg_error(_errmsg,"dictionary_sampler: malloc fails");
+        return NULL;
+    }
+    res->dict        = dict;
+    res->n           = V_dict_val_size(dict->values);
+    res->draw_seed   = 0;
+    res->draw_blocks = 0;
+    res->draws       = NULL;
+    for(int j=0; j<res->n; j++)
+        res->cum[j] = 0.0; // deleted values
+    for(int i=0; i<n; i++) {
+        dict_var* varp = V_dict_var_getp(dict->variables,i);
+        double    cum  = 0.0;
+
+        for(dindex j=varp->offset; j<(varp->offset+varp->card); j++) {
+            cum += dict->values->items[j].prob;
+            res->cum[j] = cum;
+        }
+    }
+    return res;
+}
+
+void dict_sampler_drop_draws(dict_sampler* ds) {
+    if ( ds->draws ) {
+        for(int j=0; j<ds->n; j++)
+            if ( ds->draws[j] )
+                FREE(ds->draws[j]);
+        FREE(ds->draws);
+        ds->draws = NULL;
+    }
+    ds->draw_blocks = 0;
+}
+
+/*
+ * Frees the sampler and its draws, not the dictionary.
+ */
+void dict_sampler_free(dict_sampler* ds) {
+    dict_sampler_drop_draws(ds);
+    FREE(ds);
+}
+
+/*
+ * Returns the cumulative probabilities of the values of var, sets *card to
+ * their number and *vals to the values. Returns NULL when var is unknown.
+ */
+double* dict_sampler_lookup(dict_sampler* ds, char* var, int* card, dict_val** vals) {
+    if ( !(*vals = lookup_var_values(ds->dict,var,card)) )
+        return NULL;
+    return &ds->cum[*vals - ds->dict->values->items];
+}
+
+/*
+ * Returns the index of the value drawn by u in [0,1). The last value catches
+ * the rounding error of the cumulative sum.
+ */
+int dict_sample(double* cum, int card, double u) {
+    int l = 0, r = card-1;
+
+    u *= cum[card-1];
+    while ( l < r ) {
+        int m = l + (r-l)/2;
+
+        if ( u < cum[m] )
+            r = m;
+        else
+            l = m + 1;
+    }
+    return l;
+}
+
 int lookup_alternatives(bdd_dictionary* dict,char* var, pbuff* pbuff, char** _errmsg) {
     dict_var* varp = bdd_dictionary_lookup_var(dict, var);
     if ( !varp ) {
@@ -380,6 +687,7 @@ int modify_dictionary(bdd_dictionary* dict, int mode, char* dictionary_def, char
     char *p = dictionary_def;
     if ( !(IS_VALID_MODIFIER(mode)) )
         return pg_error(_errmsg,"modify_dictionary: bad modifier (%d)",mode);
+    invalidate_dict_index(dict); // rebuilt by dictionary_prepare2store()
     while ( *p ) {
         char*  scan_var     = NULL;
         int    scan_var_len = -1;
@@ -85,6 +85,31 @@ typedef struct rva rva; /* forward */
 
 double lookup_probability(bdd_dictionary*,rva*);
 int lookup_alternatives(bdd_dictionary* dict,char* var, pbuff* pbuff, char** _errmsg);
+dict_val* lookup_var_values(bdd_dictionary*,char*,int*);
+
+/*
+ * A dict_sampler has for every value in the dictionary the cumulative
+ * probability of the values of its var up to and including the value. It is
+ * built once per dictionary and used for drawing values of a var. The
+ * sampled worlds of bdd_sample_eval() are kept in draws, so a var is drawn
+ * once for all bdd's evaluated with the same seed. They are allocated with
+ * the sampler when they are first needed, in Postgres in the memory context
+ * of the sampler.
+ */
+typedef struct dict_sampler {
+    bdd_dictionary* dict;
+    int             n;
+    uint64_t        draw_seed;
+    int             draw_blocks; // number of 64 world blocks in draws
+    uint64_t**      draws;       // NULL or per value offset of the first value of a var its masks, see bdd.c
+    double          cum[0];      // parallel to dict->values
+} dict_sampler;
+
+dict_sampler* dictionary_sampler(bdd_dictionary*,char**);
+void          dict_sampler_drop_draws(dict_sampler*);
+void          dict_sampler_free(dict_sampler*);
+double*       dict_sampler_lookup(dict_sampler*,char*,int*,dict_val**);
+int           dict_sample(double*,int,double);
 
 int test_dictionary(void);
 
@@ -21,6 +21,56 @@ PG_MODULE_MAGIC;
 
 #include "bdd.c"
 
+/*
+ * A bdd argument which is stable during the query, a constant like
+ * bdd('(a=1|b=2)') or a parameter, is prepared once and kept in fn_extra: a
+ * relocated private copy and its support, and when the dictionary is stable
+ * too its probability. The computed table of apply is keyed on node pairs of
+ * both operands, it can not be reused for the next row.
+ */
+typedef struct pg_bdd_operand {
+    bdd*   bdd;
+    double prob;    // probability with the stable dictionary, < 0.0 unknown
+    V_rva  support; // must be last, vector with fixed[] items
+} pg_bdd_operand;
+
+static void pg_bdd_operand_free(void* p) {
+    pg_bdd_operand* op = (pg_bdd_operand*)p;
+
+    V_rva_free(&op->support);
+    pfree(op->bdd);
+    pfree(op);
+}
+
+static pg_bdd_operand* pg_getarg_bdd_operand(FunctionCallInfo fcinfo, int argno) {
+    pg_arg_cache*   ac;
+    pg_bdd_operand* op;
+    MemoryContext   oldcontext;
+    char*           _errmsg = NULL;
+    int             hit;
+
+    if ( !(ac = pg_arg_cache_lookup(fcinfo,argno,1/*stable_only*/,&hit)) )
+        return NULL;
+    if ( !hit ) {
+        oldcontext = MemoryContextSwitchTo(fcinfo->flinfo->fn_mcxt);
+        op       = (pg_bdd_operand*)palloc(sizeof(pg_bdd_operand));
+        op->bdd  = DatumGetBdd(PG_DETOAST_DATUM_COPY(PG_GETARG_DATUM(argno)));
+        op->prob = -1.0;
+        V_rva_init(&op->support);
+        if ( !bdd_support(op->bdd,&op->support,&_errmsg) ) {
+            MemoryContextSwitchTo(oldcontext);
+            ereport(ERROR,(errmsg("pg_getarg_bdd_operand: %s",(_errmsg ? _errmsg : "NULL"))));
+        }
+        MemoryContextSwitchTo(oldcontext);
+        ac->value   = op;
+        ac->cleanup = pg_bdd_operand_free;
+    }
+    return (pg_bdd_operand*)ac->value;
+}
+
+#define OPERAND_BDD(OP,X)      ((OP) ? (OP)->bdd : PG_GETARG_BDD(X))
+#define OPERAND_SUPPORT(OP)    ((OP) ? &(OP)->support : NULL)
+
 PG_FUNCTION_INFO_V1(bdd_in);
 /**
  * <code>bdd_in(expression cstring) returns bdd</code>
@@ -79,16 +129,24 @@ Datum
 bdd_pg_operator(PG_FUNCTION_ARGS)
 {       
     char *operator  = PG_GETARG_CSTRING(0);
-    bdd *lhs_bdd    = PG_GETARG_BDD(1);
+    bdd *lhs_bdd    = NULL;
     bdd *rhs_bdd    = NULL;
     
     char *_errmsg    = NULL;
     bdd  *return_bdd = NULL;
 
-    if ( *operator == '&' || *operator == '|' )
-        rhs_bdd    = PG_GETARG_BDD(2);
-    // if ( !(return_bdd = bdd_operator(*operator,BY_APPLY,lhs_bdd,rhs_bdd,&_errmsg)))
-    if ( !(return_bdd = bdd_operator(*operator,BY_TEXT,lhs_bdd,rhs_bdd,&_errmsg)))
+    if ( *operator == '&' || *operator == '|' ) {
+        pg_bdd_operand *lhs_op = pg_getarg_bdd_operand(fcinfo,1);
+        pg_bdd_operand *rhs_op = pg_getarg_bdd_operand(fcinfo,2);
+
+        lhs_bdd = OPERAND_BDD(lhs_op,1);
+        rhs_bdd = OPERAND_BDD(rhs_op,2);
+        return_bdd = bdd_apply_support(*operator,lhs_bdd,OPERAND_SUPPORT(lhs_op),rhs_bdd,OPERAND_SUPPORT(rhs_op),0,&_errmsg);
+    } else {
+        lhs_bdd    = PG_GETARG_BDD(1);
+        return_bdd = bdd_operator(*operator,BY_APPLY,lhs_bdd,rhs_bdd,&_errmsg);
+    }
+    if ( !return_bdd )
         ereport(ERROR,(errmsg("bdd_operator: error: %s ",(_errmsg ? _errmsg : "NULL"))));
     SET_VARSIZE(return_bdd,return_bdd->bytesize);
     PG_RETURN_BDD(return_bdd);
@@ -112,7 +170,6 @@ bdd_pg_operator_by_text(PG_FUNCTION_ARGS)
 
     if ( *operator == '&' || *operator == '|' )
         rhs_bdd    = PG_GETARG_BDD(2);
-    // if ( !(return_bdd = bdd_operator(*operator,BY_APPLY,lhs_bdd,rhs_bdd,&_errmsg)))
     if ( !(return_bdd = bdd_operator(*operator,BY_TEXT,lhs_bdd,rhs_bdd,&_errmsg)))
         ereport(ERROR,(errmsg("bdd_operator: error: %s ",(_errmsg ? _errmsg : "NULL"))));
     SET_VARSIZE(return_bdd,return_bdd->bytesize);
@@ -217,13 +274,19 @@ PG_FUNCTION_INFO_V1(bdd_pg_prob);
 Datum
 bdd_pg_prob(PG_FUNCTION_ARGS)
 {
-    bdd_dictionary  *dict     = PG_GETARG_DICTIONARY(0);
-    bdd             *par_bdd  = PG_GETARG_BDD(1);
+    bdd_dictionary  *dict     = PG_GETARG_DICTIONARY_CACHED(0);
+    pg_bdd_operand  *bdd_op   = pg_getarg_bdd_operand(fcinfo,1);
+    bdd             *par_bdd  = OPERAND_BDD(bdd_op,1);
 
     char* _errmsg;
-    double prob = bdd_probability(dict,par_bdd,NULL,0,&_errmsg);
-    if ( prob < 0.0 )
+    double prob;
+
+    if ( bdd_op && (bdd_op->prob >= 0.0) )
+        PG_RETURN_FLOAT8(bdd_op->prob);
+    if ( (prob = bdd_probability(dict,par_bdd,NULL,0,&_errmsg)) < 0.0 )
         ereport(ERROR,(errmsg("bdd_pg_prob: %s",(_errmsg ? _errmsg : "NULL"))));
+    if ( bdd_op && get_fn_expr_arg_stable(fcinfo->flinfo,0) )
+        bdd_op->prob = prob;
     PG_RETURN_FLOAT8(prob);
     // PG_RETURN_NUMERIC(prob); CRASHES SERVER
 }
@@ -252,6 +315,861 @@ bdd_pg_prob_by_ref(PG_FUNCTION_ARGS)
     PG_RETURN_FLOAT8(prob);
 }
 
+PG_FUNCTION_INFO_V1(bdd_pg_prob_op);
+/**
+ * <code>_prob_op(dict dictionary, operator cstring, lhs bdd, rhs bdd) returns double</code>
+ * Computes probability of (lhs operator rhs) without creating the combined
+ * bdd when lhs and rhs are independent.
+ *
+ */
+Datum
+bdd_pg_prob_op(PG_FUNCTION_ARGS)
+{
+    bdd_dictionary  *dict     = PG_GETARG_DICTIONARY_CACHED(0);
+    char            *operator = PG_GETARG_CSTRING(1);
+    pg_bdd_operand  *lhs_op   = pg_getarg_bdd_operand(fcinfo,2);
+    pg_bdd_operand  *rhs_op   = pg_getarg_bdd_operand(fcinfo,3);
+    int          stable_dict  = get_fn_expr_arg_stable(fcinfo->flinfo,0);
+
+    char* _errmsg = NULL;
+    double prob = bdd_probability_op_support(dict,*operator,
+                        OPERAND_BDD(lhs_op,2),OPERAND_SUPPORT(lhs_op),((lhs_op && stable_dict) ? &lhs_op->prob : NULL),
+                        OPERAND_BDD(rhs_op,3),OPERAND_SUPPORT(rhs_op),((rhs_op && stable_dict) ? &rhs_op->prob : NULL),
+                        0,&_errmsg);
+    if ( prob < 0.0 )
+        ereport(ERROR,(errmsg("bdd_pg_prob_op: %s",(_errmsg ? _errmsg : "NULL"))));
+    PG_RETURN_FLOAT8(prob);
+}
+
+PG_FUNCTION_INFO_V1(bdd_pg_cond_prob);
+/**
+ * <code>cond_prob(dict dictionary, a bdd, b bdd) returns double precision</code>
+ * Computes the conditional probability P(a|b) = P(a&b)/P(b) in one walk over
+ * the product of a and b, the bdd of a&b is not created. Returns NULL when
+ * P(b) is 0.
+ *
+ */
+Datum
+bdd_pg_cond_prob(PG_FUNCTION_ARGS)
+{
+    bdd_dictionary  *dict     = PG_GETARG_DICTIONARY_CACHED(0);
+    pg_bdd_operand  *a_op     = pg_getarg_bdd_operand(fcinfo,1);
+    pg_bdd_operand  *b_op     = pg_getarg_bdd_operand(fcinfo,2);
+    double           p_ab, p_b;
+    char            *_errmsg  = NULL;
+
+    if ( !bdd_probability_cond(dict,OPERAND_BDD(a_op,1),OPERAND_BDD(b_op,2),&p_ab,&p_b,&_errmsg) )
+        ereport(ERROR,(errmsg("cond_prob: %s",(_errmsg ? _errmsg : "NULL"))));
+    if ( p_b <= 0.0 )
+        PG_RETURN_NULL();
+    PG_RETURN_FLOAT8(p_ab/p_b);
+}
+
+PG_FUNCTION_INFO_V1(bdd_pg_prob_expr);
+/**
+ * <code>prob_expr(dict dictionary, expr text) returns double precision</code>
+ * Computes the probability of an rva expression without creating a bdd when
+ * the expression is read-once, else the bdd is created for the probability.
+ *
+ */
+Datum
+bdd_pg_prob_expr(PG_FUNCTION_ARGS)
+{
+    bdd_dictionary  *dict     = PG_GETARG_DICTIONARY_CACHED(0);
+    char            *expr     = text_to_cstring(PG_GETARG_TEXT_PP(1));
+    char            *_errmsg  = NULL;
+    double           prob;
+
+    if ( (prob = bdd_probability_expr(dict,expr,NULL,&_errmsg)) < 0.0 )
+        ereport(ERROR,(errmsg("prob_expr: %s",(_errmsg ? _errmsg : "NULL"))));
+    pfree(expr);
+    PG_RETURN_FLOAT8(prob);
+}
+
+PG_FUNCTION_INFO_V1(bdd_pg_mpe_prob);
+/**
+ * <code>mpe_prob(dict dictionary, bdd bdd) returns double precision</code>
+ * Computes the probability of the most probable world of bdd in one pass
+ * over the bdd, without computing the world.
+ *
+ */
+Datum
+bdd_pg_mpe_prob(PG_FUNCTION_ARGS)
+{
+    bdd_dictionary  *dict     = PG_GETARG_DICTIONARY_CACHED(0);
+    bdd             *par_bdd  = PG_GETARG_BDD(1);
+    char            *_errmsg  = NULL;
+    double           prob;
+
+    if ( (prob = bdd_probability_mpe(dict,par_bdd,&_errmsg)) < 0.0 )
+        ereport(ERROR,(errmsg("mpe_prob: %s",(_errmsg ? _errmsg : "NULL"))));
+    PG_RETURN_FLOAT8(prob);
+}
+
+/*
+ * The expected_sum(), expected_count() and count_distribution() aggregates.
+ * By linearity of expectation the expected sum and count are the sum of
+ * value*P(bdd) also when the lineage of the rows overlaps, so their state is
+ * a float8. count_distribution keeps the bdd's of the rows in the aggregate
+ * context and computes the distribution in the final function.
+ */
+
+PG_FUNCTION_INFO_V1(bdd_pg_expected_sum_accum);
+/**
+ * <code>_expected_sum_accum(state double precision, value double precision, dict dictionary, bdd bdd) returns double precision</code>
+ * Transition function of expected_sum(), adds value*P(bdd) to state.
+ *
+ */
+Datum
+bdd_pg_expected_sum_accum(PG_FUNCTION_ARGS)
+{
+    double           state    = PG_GETARG_FLOAT8(0);
+    double           value    = PG_GETARG_FLOAT8(1);
+    bdd_dictionary  *dict     = PG_GETARG_DICTIONARY_CACHED(2);
+    bdd             *par_bdd  = PG_GETARG_BDD(3);
+    char            *_errmsg  = NULL;
+    double           prob;
+
+    if ( (prob = bdd_probability(dict,par_bdd,NULL,0,&_errmsg)) < 0.0 )
+        ereport(ERROR,(errmsg("expected_sum: %s",(_errmsg ? _errmsg : "NULL"))));
+    PG_RETURN_FLOAT8(state + value*prob);
+}
+
+PG_FUNCTION_INFO_V1(bdd_pg_expected_count_accum);
+/**
+ * <code>_expected_count_accum(state double precision, dict dictionary, bdd bdd) returns double precision</code>
+ * Transition function of expected_count(), adds P(bdd) to state.
+ *
+ */
+Datum
+bdd_pg_expected_count_accum(PG_FUNCTION_ARGS)
+{
+    double           state    = PG_GETARG_FLOAT8(0);
+    bdd_dictionary  *dict     = PG_GETARG_DICTIONARY_CACHED(1);
+    bdd             *par_bdd  = PG_GETARG_BDD(2);
+    char            *_errmsg  = NULL;
+    double           prob;
+
+    if ( (prob = bdd_probability(dict,par_bdd,NULL,0,&_errmsg)) < 0.0 )
+        ereport(ERROR,(errmsg("expected_count: %s",(_errmsg ? _errmsg : "NULL"))));
+    PG_RETURN_FLOAT8(state + prob);
+}
+
+typedef struct pg_count_state {
+    bdd_dictionary *dict;   // copy of the dictionary of the first row
+    bdd           **bdds;   // copies of the bdd's of the rows
+    int             n, max;
+} pg_count_state;
+
+PG_FUNCTION_INFO_V1(bdd_pg_count_dist_accum);
+/**
+ * <code>_count_distribution_accum(state internal, dict dictionary, bdd bdd) returns internal</code>
+ * Transition function of count_distribution(), keeps a copy of bdd in the
+ * aggregate context. Rows with a NULL dict or bdd are skipped.
+ *
+ */
+Datum
+bdd_pg_count_dist_accum(PG_FUNCTION_ARGS)
+{
+    MemoryContext    aggcontext, oldcontext;
+    pg_count_state  *state = PG_ARGISNULL(0) ? NULL : (pg_count_state*)PG_GETARG_POINTER(0);
+
+    if ( !AggCheckCallContext(fcinfo,&aggcontext) )
+        ereport(ERROR,(errmsg("count_distribution: called in non-aggregate context")));
+    if ( PG_ARGISNULL(1) || PG_ARGISNULL(2) )
+        PG_RETURN_POINTER(state);
+    oldcontext = MemoryContextSwitchTo(aggcontext);
+    if ( !state ) {
+        state       = (pg_count_state*)palloc(sizeof(pg_count_state));
+        state->dict = bdd_dictionary_relocate((bdd_dictionary*)PG_DETOAST_DATUM_COPY(PG_GETARG_DATUM(1)));
+        state->n    = 0;
+        state->max  = 64;
+        state->bdds = (bdd**)palloc(state->max*sizeof(bdd*));
+    }
+    if ( state->n == state->max ) {
+        state->max *= 2;
+        state->bdds = (bdd**)repalloc(state->bdds,state->max*sizeof(bdd*));
+    }
+    state->bdds[state->n++] = relocate_bdd((bdd*)PG_DETOAST_DATUM_COPY(PG_GETARG_DATUM(2)));
+    MemoryContextSwitchTo(oldcontext);
+    PG_RETURN_POINTER(state);
+}
+
+PG_FUNCTION_INFO_V1(bdd_pg_count_dist_final);
+/**
+ * <code>_count_distribution_final(state internal) returns double precision[]</code>
+ * Final function of count_distribution(), element k+1 of the result is the
+ * probability that exactly k of the bdd's are true. Bdd's without common
+ * variables are combined by the Poisson-binomial dp, bdd's with common
+ * variables are handled exactly.
+ *
+ */
+Datum
+bdd_pg_count_dist_final(PG_FUNCTION_ARGS)
+{
+    pg_count_state  *state = PG_ARGISNULL(0) ? NULL : (pg_count_state*)PG_GETARG_POINTER(0);
+    double          *dist;
+    Datum           *res_datums;
+    char            *_errmsg  = NULL;
+    int              n        = state ? state->n : 0;
+
+    res_datums = (Datum*)palloc((n+1)*sizeof(Datum));
+    if ( !state ) {
+        res_datums[0] = Float8GetDatum(1.0); // no rows, count is 0
+    } else {
+        if ( !(dist = bdd_count_distribution(state->dict,state->bdds,n,&_errmsg)) )
+            ereport(ERROR,(errmsg("count_distribution: %s",(_errmsg ? _errmsg : "NULL"))));
+        for(int k=0; k<=n; k++)
+            res_datums[k] = Float8GetDatum(dist[k]);
+        pfree(dist);
+    }
+    PG_RETURN_ARRAYTYPE_P(construct_array(res_datums,n+1,FLOAT8OID,sizeof(float8),FLOAT8PASSBYVAL,'d'));
+}
+
+PG_FUNCTION_INFO_V1(bdd_pg_prob_exceeds);
+/**
+ * <code>_prob_exceeds(dict dictionary, bdd bdd, t double precision, strict boolean) returns boolean</code>
+ * Decides prob(dict,bdd) > t (strict) or >= t. Lower and upper bounds are
+ * kept while the most probable paths are expanded first, the walk stops as
+ * soon as the bounds decide.
+ *
+ */
+Datum
+bdd_pg_prob_exceeds(PG_FUNCTION_ARGS)
+{
+    bdd_dictionary  *dict     = PG_GETARG_DICTIONARY_CACHED(0);
+    bdd             *par_bdd  = PG_GETARG_BDD(1);
+    double           t        = PG_GETARG_FLOAT8(2);
+    bool             strict   = PG_GETARG_BOOL(3);
+    char            *_errmsg  = NULL;
+    int              res;
+
+    if ( (res = bdd_probability_exceeds(dict,par_bdd,t,strict,&_errmsg)) < 0 )
+        ereport(ERROR,(errmsg("prob_exceeds: %s",(_errmsg ? _errmsg : "NULL"))));
+    PG_RETURN_BOOL(res);
+}
+
+/*
+ * The topk_prob(dict, bdd, payload, k) aggregate. The state keeps the heap of
+ * the k most probable bdd's and a copy of their payloads, rows that can not
+ * enter the heap are rejected by bounds on their probability.
+ */
+
+typedef struct pg_topk_prob_state {
+    bdd_prob_heap *heap;
+    Oid            typid;    // payload type
+    int16          typlen;
+    bool           typbyval;
+    char           typalign;
+    Datum         *payload;  // payload of heap slot i
+    bool          *isnull;
+} pg_topk_prob_state;
+
+PG_FUNCTION_INFO_V1(bdd_pg_topk_prob_accum);
+/**
+ * <code>_topk_prob_accum(state internal, dict dictionary, bdd bdd, payload anyelement, k integer) returns internal</code>
+ * Transition function of topk_prob(), the k of the first row is used. Rows
+ * with a NULL dict or bdd are skipped.
+ *
+ */
+Datum
+bdd_pg_topk_prob_accum(PG_FUNCTION_ARGS)
+{
+    MemoryContext       aggcontext, oldcontext;
+    pg_topk_prob_state *state = PG_ARGISNULL(0) ? NULL : (pg_topk_prob_state*)PG_GETARG_POINTER(0);
+    bdd_dictionary     *dict;
+    bdd                *par_bdd;
+    char               *_errmsg = NULL;
+    int                 slot;
+
+    if ( !AggCheckCallContext(fcinfo,&aggcontext) )
+        ereport(ERROR,(errmsg("topk_prob: called in non-aggregate context")));
+    if ( PG_ARGISNULL(1) || PG_ARGISNULL(2) || PG_ARGISNULL(4) )
+        PG_RETURN_POINTER(state);
+    if ( !state ) {
+        int k = PG_GETARG_INT32(4);
+
+        oldcontext = MemoryContextSwitchTo(aggcontext);
+        state = (pg_topk_prob_state*)palloc(sizeof(pg_topk_prob_state));
+        if ( !(state->heap = bdd_prob_heap_create(k,&_errmsg)) )
+            ereport(ERROR,(errmsg("topk_prob: %s",(_errmsg ? _errmsg : "NULL"))));
+        state->typid   = get_fn_expr_argtype(fcinfo->flinfo,3);
+        get_typlenbyvalalign(state->typid,&state->typlen,&state->typbyval,&state->typalign);
+        state->payload = (Datum*)palloc0(k*sizeof(Datum));
+        state->isnull  = (bool*)palloc0(k*sizeof(bool));
+        MemoryContextSwitchTo(oldcontext);
+    }
+    dict    = PG_GETARG_DICTIONARY_CACHED(1);
+    par_bdd = PG_GETARG_BDD(2);
+    if ( (slot = bdd_prob_heap_offer(state->heap,dict,par_bdd,&_errmsg)) < -1 )
+        ereport(ERROR,(errmsg("topk_prob: %s",(_errmsg ? _errmsg : "NULL"))));
+    if ( slot >= 0 ) {
+        if ( !state->typbyval && !state->isnull[slot] && state->payload[slot] )
+            pfree(DatumGetPointer(state->payload[slot]));
+        state->isnull[slot] = PG_ARGISNULL(3);
+        if ( PG_ARGISNULL(3) )
+            state->payload[slot] = (Datum)0;
+        else {
+            oldcontext = MemoryContextSwitchTo(aggcontext);
+            state->payload[slot] = datumCopy(PG_GETARG_DATUM(3),state->typbyval,state->typlen);
+            MemoryContextSwitchTo(oldcontext);
+        }
+    }
+    PG_RETURN_POINTER(state);
+}
+
+PG_FUNCTION_INFO_V1(bdd_pg_topk_prob_final);
+/**
+ * <code>_topk_prob_final(state internal, dict dictionary, bdd bdd, payload anyelement, k integer) returns anyarray</code>
+ * Final function of topk_prob(), returns the payloads of the k most probable
+ * bdd's in descending probability.
+ *
+ */
+Datum
+bdd_pg_topk_prob_final(PG_FUNCTION_ARGS)
+{
+    pg_topk_prob_state *state = PG_ARGISNULL(0) ? NULL : (pg_topk_prob_state*)PG_GETARG_POINTER(0);
+    int                *slots;
+    double             *probs;
+    Datum              *values;
+    bool               *nulls;
+    int                 n, dims[1], lbs[1] = {1};
+
+    if ( !state )
+        PG_RETURN_NULL();
+    slots  = (int*)palloc(state->heap->k*sizeof(int));
+    probs  = (double*)palloc(state->heap->k*sizeof(double));
+    values = (Datum*)palloc(state->heap->k*sizeof(Datum));
+    nulls  = (bool*)palloc(state->heap->k*sizeof(bool));
+    n      = bdd_prob_heap_sorted(state->heap,slots,probs);
+    for(int i=0; i<n; i++) {
+        values[i] = state->payload[slots[i]];
+        nulls[i]  = state->isnull[slots[i]];
+    }
+    if ( n == 0 )
+        PG_RETURN_ARRAYTYPE_P(construct_empty_array(state->typid));
+    dims[0] = n;
+    PG_RETURN_ARRAYTYPE_P(construct_md_array(values,nulls,1,dims,lbs,state->typid,state->typlen,state->typbyval,state->typalign));
+}
+
+PG_FUNCTION_INFO_V1(bdd_pg_prob_array);
+/**
+ * <code>prob(dict dictionary, bdds bdd[]) returns double precision[]</code>
+ * Computes the probabilities of an array of bdd's with one dictionary. Sub
+ * bdd's shared between the bdd's are computed once. NULL bdd's give NULL.
+ *
+ */
+Datum
+bdd_pg_prob_array(PG_FUNCTION_ARGS)
+{
+    bdd_dictionary  *dict     = PG_GETARG_DICTIONARY_CACHED(0);
+    ArrayType       *par_bdds = PG_GETARG_ARRAYTYPE_P(1);
+    Datum           *bdd_datums;
+    bool            *bdd_nulls;
+    int              n_bdd;
+    bdd            **bdds;
+    double          *prob;
+    Datum           *res_datums;
+    int              dims[1], lbs[1] = {1};
+    char            *_errmsg  = NULL;
+
+    deconstruct_array(par_bdds,ARR_ELEMTYPE(par_bdds),-1,false,'d',&bdd_datums,&bdd_nulls,&n_bdd);
+    if ( n_bdd == 0 )
+        PG_RETURN_ARRAYTYPE_P(construct_empty_array(FLOAT8OID));
+    bdds       = (bdd**)palloc(n_bdd*sizeof(bdd*));
+    prob       = (double*)palloc(n_bdd*sizeof(double));
+    res_datums = (Datum*)palloc(n_bdd*sizeof(Datum));
+    for(int i=0; i<n_bdd; i++)
+        bdds[i] = bdd_nulls[i] ? NULL : DatumGetBdd(PG_DETOAST_DATUM(bdd_datums[i]));
+    if ( !bdd_probability_vector(dict,bdds,n_bdd,prob,&_errmsg) )
+        ereport(ERROR,(errmsg("bdd_pg_prob_array: %s",(_errmsg ? _errmsg : "NULL"))));
+    for(int i=0; i<n_bdd; i++)
+        res_datums[i] = bdd_nulls[i] ? (Datum)0 : Float8GetDatum(prob[i]);
+    dims[0] = n_bdd;
+    PG_RETURN_ARRAYTYPE_P(construct_md_array(res_datums,bdd_nulls,1,dims,lbs,FLOAT8OID,sizeof(float8),FLOAT8PASSBYVAL,'d'));
+}
+
+/*
+ * The dictionary[] argument of prob_scenarios() is usually the same for all
+ * rows, the detoasted array and the relocated dictionaries are kept in the
+ * fn_extra argument cache.
+ */
+typedef struct pg_dictionary_array {
+    ArrayType*       array;
+    int              n;
+    bdd_dictionary** dicts;
+} pg_dictionary_array;
+
+static void pg_dictionary_array_free(void* p) {
+    pg_dictionary_array* da = (pg_dictionary_array*)p;
+
+    for(int i=0; i<da->n; i++)
+        pfree(da->dicts[i]);
+    pfree(da->dicts);
+    pfree(da->array);
+    pfree(da);
+}
+
+static pg_dictionary_array* pg_getarg_dictionary_array(FunctionCallInfo fcinfo, int argno, pg_dictionary_array* local) {
+    pg_arg_cache*        ac;
+    pg_dictionary_array* da = local;
+    MemoryContext        oldcontext = NULL;
+    Datum*               datums;
+    bool*                nulls;
+    int                  hit;
+
+    if ( (ac = pg_arg_cache_lookup(fcinfo,argno,0/*stable_only*/,&hit)) ) {
+        if ( hit )
+            return (pg_dictionary_array*)ac->value;
+        oldcontext = MemoryContextSwitchTo(fcinfo->flinfo->fn_mcxt);
+        da = (pg_dictionary_array*)palloc(sizeof(pg_dictionary_array));
+        da->array = (ArrayType*)PG_DETOAST_DATUM_COPY(PG_GETARG_DATUM(argno));
+    } else
+        da->array = PG_GETARG_ARRAYTYPE_P(argno);
+    deconstruct_array(da->array,ARR_ELEMTYPE(da->array),-1,false,'d',&datums,&nulls,&da->n);
+    da->dicts = (bdd_dictionary**)palloc((da->n>0?da->n:1)*sizeof(bdd_dictionary*));
+    for(int i=0; i<da->n; i++) {
+        if ( nulls[i] ) {
+            if ( oldcontext )
+                MemoryContextSwitchTo(oldcontext);
+            ereport(ERROR,(errmsg("prob_scenarios: NULL dictionary not allowed")));
+        }
+        if ( ac ) // private indexed copy, lives as long as the cache entry
+            da->dicts[i] = pg_dictionary_indexed_copy(datums[i]);
+        else
+            da->dicts[i] = DatumGetDictionary(PG_DETOAST_DATUM(datums[i]));
+    }
+    pfree(datums);
+    pfree(nulls);
+    if ( ac ) {
+        MemoryContextSwitchTo(oldcontext);
+        ac->value   = da;
+        ac->cleanup = pg_dictionary_array_free;
+    }
+    return da;
+}
+
+PG_FUNCTION_INFO_V1(bdd_pg_prob_scenarios);
+/**
+ * <code>prob_scenarios(dicts dictionary[], bdd bdd) returns double precision[]</code>
+ * Computes the probability of a bdd for every dictionary in dicts in one pass
+ * over the bdd.
+ *
+ */
+Datum
+bdd_pg_prob_scenarios(PG_FUNCTION_ARGS)
+{
+    pg_dictionary_array  local;
+    pg_dictionary_array *da       = pg_getarg_dictionary_array(fcinfo,0,&local);
+    bdd                 *par_bdd  = PG_GETARG_BDD(1);
+    double              *prob;
+    Datum               *res_datums;
+    char                *_errmsg  = NULL;
+
+    if ( da->n == 0 )
+        PG_RETURN_ARRAYTYPE_P(construct_empty_array(FLOAT8OID));
+    prob       = (double*)palloc(da->n*sizeof(double));
+    res_datums = (Datum*)palloc(da->n*sizeof(Datum));
+    if ( !bdd_probability_scenarios(da->dicts,da->n,par_bdd,prob,&_errmsg) )
+        ereport(ERROR,(errmsg("bdd_pg_prob_scenarios: %s",(_errmsg ? _errmsg : "NULL"))));
+    for(int i=0; i<da->n; i++)
+        res_datums[i] = Float8GetDatum(prob[i]);
+    PG_RETURN_ARRAYTYPE_P(construct_array(res_datums,da->n,FLOAT8OID,sizeof(float8),FLOAT8PASSBYVAL,'d'));
+}
+
+PG_FUNCTION_INFO_V1(bdd_pg_prob_gradient);
+/**
+ * <code>prob_gradient(dict dictionary, bdd bdd) returns setof (rva text, prob double precision, derivative double precision, cond_prob double precision, banzhaf double precision)</code>
+ * Returns for every rva in bdd its probability, the derivative of the
+ * probability of bdd to the probability of the rva, the probability of bdd
+ * given rva and the Banzhaf value. Computed in one forward and one backward
+ * pass over the bdd.
+ *
+ */
+Datum
+bdd_pg_prob_gradient(PG_FUNCTION_ARGS)
+{
+    FuncCallContext *funcctx;
+
+    if ( SRF_IS_FIRSTCALL() ) {
+        MemoryContext    oldcontext;
+        TupleDesc        tupdesc;
+        bdd_dictionary  *dict;
+        bdd             *par_bdd;
+        bdd_sensitivity *sens;
+        int              n_sens;
+        char            *_errmsg = NULL;
+
+        funcctx    = SRF_FIRSTCALL_INIT();
+        oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+        if ( get_call_result_type(fcinfo,NULL,&tupdesc) != TYPEFUNC_COMPOSITE )
+            ereport(ERROR,(errmsg("prob_gradient: function returning record called in context that cannot accept type record")));
+        funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+        // fn_extra is used by the SRF machinery, no cached dictionary here
+        dict    = PG_GETARG_DICTIONARY(0);
+        par_bdd = PG_GETARG_BDD(1);
+        if ( !(sens = bdd_probability_gradient(dict,par_bdd,&n_sens,NULL,&_errmsg)) )
+            ereport(ERROR,(errmsg("prob_gradient: %s",(_errmsg ? _errmsg : "NULL"))));
+        funcctx->user_fctx = sens;
+        funcctx->max_calls = n_sens;
+        MemoryContextSwitchTo(oldcontext);
+    }
+    funcctx = SRF_PERCALL_SETUP();
+    if ( funcctx->call_cntr < funcctx->max_calls ) {
+        bdd_sensitivity *s = &((bdd_sensitivity*)funcctx->user_fctx)[funcctx->call_cntr];
+        char             rva_str[MAX_RVA_NAME+16];
+        Datum            values[5];
+        bool             nulls[5] = {false,false,false,false,false};
+        HeapTuple        tuple;
+
+        sprintf(rva_str,"%s=%d",s->rva.var,s->rva.val);
+        values[0] = CStringGetTextDatum(rva_str);
+        values[1] = Float8GetDatum(s->prob);
+        values[2] = Float8GetDatum(s->derivative);
+        values[3] = Float8GetDatum(s->cond);
+        values[4] = Float8GetDatum(s->banzhaf);
+        tuple = heap_form_tuple(funcctx->tuple_desc,values,nulls);
+        SRF_RETURN_NEXT(funcctx,HeapTupleGetDatum(tuple));
+    }
+    SRF_RETURN_DONE(funcctx);
+}
+
+static Datum pg_estimate_datum(FunctionCallInfo fcinfo, bdd_estimate* est) {
+    TupleDesc tupdesc;
+    Datum     values[5];
+    bool      nulls[5] = {false,false,false,false,false};
+
+    if ( get_call_result_type(fcinfo,NULL,&tupdesc) != TYPEFUNC_COMPOSITE )
+        ereport(ERROR,(errmsg("prob_approx: function returning record called in context that cannot accept type record")));
+    tupdesc   = BlessTupleDesc(tupdesc);
+    values[0] = Float8GetDatum(est->prob);
+    values[1] = Float8GetDatum(est->lower);
+    values[2] = Float8GetDatum(est->upper);
+    values[3] = Int32GetDatum(est->samples);
+    values[4] = CStringGetTextDatum(est->method);
+    return HeapTupleGetDatum(heap_form_tuple(tupdesc,values,nulls));
+}
+
+PG_FUNCTION_INFO_V1(bdd_pg_prob_approx);
+/**
+ * <code>prob_approx(dict dictionary, bdd bdd, epsilon double precision, delta double precision, max_samples integer, max_ms integer) returns (prob, lower, upper, samples, method)</code>
+ * Returns a Monte Carlo estimate of the probability of bdd which is within
+ * epsilon with probability 1-delta, and its confidence interval. Sampling
+ * stops early at max_samples samples or max_ms milliseconds (0 is no limit),
+ * the interval then reflects the samples drawn. The sampling tables of the
+ * dictionary are cached between calls.
+ *
+ */
+Datum
+bdd_pg_prob_approx(PG_FUNCTION_ARGS)
+{
+    dict_sampler *ds          = pg_getarg_dict_sampler_cached(fcinfo,0);
+    bdd          *par_bdd     = PG_GETARG_BDD(1);
+    double        epsilon     = PG_GETARG_FLOAT8(2);
+    double        delta       = PG_GETARG_FLOAT8(3);
+    int           max_samples = PG_GETARG_INT32(4);
+    int           max_ms      = PG_GETARG_INT32(5);
+    bdd_estimate  est;
+    char         *_errmsg     = NULL;
+
+    if ( !bdd_probability_approx(ds,par_bdd,epsilon,delta,max_samples,max_ms,&est,&_errmsg) )
+        ereport(ERROR,(errmsg("prob_approx: %s",(_errmsg ? _errmsg : "NULL"))));
+    PG_RETURN_DATUM(pg_estimate_datum(fcinfo,&est));
+}
+
+PG_FUNCTION_INFO_V1(bdd_pg_prob_approx_expr);
+/**
+ * <code>prob_approx(dict dictionary, expr text, epsilon double precision, delta double precision, max_samples integer, max_ms integer) returns (prob, lower, upper, samples, method)</code>
+ * As prob_approx(dictionary,bdd,...) for a boolean rva expression which is
+ * not built as a bdd when it is a DNF, these are estimated by Karp-Luby
+ * with epsilon relative to the probability.
+ *
+ */
+Datum
+bdd_pg_prob_approx_expr(PG_FUNCTION_ARGS)
+{
+    dict_sampler *ds          = pg_getarg_dict_sampler_cached(fcinfo,0);
+    char         *expr        = text_to_cstring(PG_GETARG_TEXT_PP(1));
+    double        epsilon     = PG_GETARG_FLOAT8(2);
+    double        delta       = PG_GETARG_FLOAT8(3);
+    int           max_samples = PG_GETARG_INT32(4);
+    int           max_ms      = PG_GETARG_INT32(5);
+    bdd_estimate  est;
+    char         *_errmsg     = NULL;
+
+    if ( !bdd_probability_approx_expr(ds,expr,epsilon,delta,max_samples,max_ms,&est,&_errmsg) )
+        ereport(ERROR,(errmsg("prob_approx: %s",(_errmsg ? _errmsg : "NULL"))));
+    PG_RETURN_DATUM(pg_estimate_datum(fcinfo,&est));
+}
+
+PG_FUNCTION_INFO_V1(bdd_pg_sample_eval);
+/**
+ * <code>sample_eval(dict dictionary, bdd bdd, n_samples integer, seed bigint) returns integer</code>
+ * Returns in how many of n_samples worlds sampled from dict bdd is true. The
+ * worlds only depend on seed, so all bdd's are evaluated in the same worlds.
+ *
+ */
+Datum
+bdd_pg_sample_eval(PG_FUNCTION_ARGS)
+{
+    dict_sampler *ds        = pg_getarg_dict_sampler_cached(fcinfo,0);
+    bdd          *par_bdd   = PG_GETARG_BDD(1);
+    int           n_samples = PG_GETARG_INT32(2);
+    int64         seed      = PG_GETARG_INT64(3);
+    char         *_errmsg   = NULL;
+    MemoryContext oldcontext;
+    int           count;
+
+    // the draws are kept in the sampler, allocate them with it
+    oldcontext = MemoryContextSwitchTo(GetMemoryChunkContext(ds));
+    count      = bdd_sample_count(ds,par_bdd,n_samples,(uint64_t)seed,&_errmsg);
+    MemoryContextSwitchTo(oldcontext);
+    if ( count < 0 )
+        ereport(ERROR,(errmsg("sample_eval: %s",(_errmsg ? _errmsg : "NULL"))));
+    PG_RETURN_INT32(count);
+}
+
+typedef struct pg_sample_state {
+    int       n_samples; // of the first row
+    uint64_t  seed;
+    int       n_rows;
+    int32    *count;     // count[k] is the number of rows true in world k
+    uint64_t *res;       // sample_eval scratch
+} pg_sample_state;
+
+PG_FUNCTION_INFO_V1(bdd_pg_sample_dist_accum);
+/**
+ * <code>_sample_count_distribution_accum(state internal, dict dictionary, bdd bdd, n_samples integer, seed bigint) returns internal</code>
+ * Transition function of sample_count_distribution(), evaluates bdd in the
+ * sampled worlds and counts the true rows per world. Rows with a NULL dict
+ * or bdd are skipped.
+ *
+ */
+Datum
+bdd_pg_sample_dist_accum(PG_FUNCTION_ARGS)
+{
+    MemoryContext    aggcontext, oldcontext;
+    pg_sample_state *state = PG_ARGISNULL(0) ? NULL : (pg_sample_state*)PG_GETARG_POINTER(0);
+    dict_sampler    *ds;
+    char            *_errmsg = NULL;
+    int              ok;
+
+    if ( !AggCheckCallContext(fcinfo,&aggcontext) )
+        ereport(ERROR,(errmsg("sample_count_distribution: called in non-aggregate context")));
+    if ( PG_ARGISNULL(1) || PG_ARGISNULL(2) || PG_ARGISNULL(3) || PG_ARGISNULL(4) )
+        PG_RETURN_POINTER(state);
+    if ( !state ) {
+        int n_samples = PG_GETARG_INT32(3);
+
+        if ( n_samples <= 0 )
+            ereport(ERROR,(errmsg("sample_count_distribution: number of samples must be positive (%d)",n_samples)));
+        oldcontext       = MemoryContextSwitchTo(aggcontext);
+        state            = (pg_sample_state*)palloc(sizeof(pg_sample_state));
+        state->n_samples = n_samples;
+        state->seed      = (uint64_t)PG_GETARG_INT64(4);
+        state->n_rows    = 0;
+        state->count     = (int32*)palloc0(n_samples*sizeof(int32));
+        state->res       = (uint64_t*)palloc(((n_samples+63)/64)*sizeof(uint64_t));
+        MemoryContextSwitchTo(oldcontext);
+    }
+    ds         = pg_getarg_dict_sampler_cached(fcinfo,1);
+    oldcontext = MemoryContextSwitchTo(GetMemoryChunkContext(ds)); // see sample_eval()
+    ok         = bdd_sample_eval(ds,PG_GETARG_BDD(2),state->n_samples,state->seed,state->res,&_errmsg);
+    MemoryContextSwitchTo(oldcontext);
+    if ( !ok )
+        ereport(ERROR,(errmsg("sample_count_distribution: %s",(_errmsg ? _errmsg : "NULL"))));
+    for(int b=0; b<(state->n_samples+63)/64; b++)
+        for(uint64_t m=state->res[b]; m; m&=m-1)
+            state->count[b*64+bdd_rightmost_one64(m)]++;
+    state->n_rows++;
+    PG_RETURN_POINTER(state);
+}
+
+PG_FUNCTION_INFO_V1(bdd_pg_sample_dist_final);
+/**
+ * <code>_sample_count_distribution_final(state internal) returns double precision[]</code>
+ * Final function of sample_count_distribution(), element k+1 of the result
+ * is the fraction of the sampled worlds in which exactly k rows are true.
+ *
+ */
+Datum
+bdd_pg_sample_dist_final(PG_FUNCTION_ARGS)
+{
+    pg_sample_state *state = PG_ARGISNULL(0) ? NULL : (pg_sample_state*)PG_GETARG_POINTER(0);
+    Datum           *res_datums;
+    double          *dist;
+    int              n = state ? state->n_rows : 0;
+
+    res_datums = (Datum*)palloc((n+1)*sizeof(Datum));
+    if ( !state ) {
+        res_datums[0] = Float8GetDatum(1.0); // no rows, count is 0
+    } else {
+        dist = (double*)palloc0((n+1)*sizeof(double));
+        for(int k=0; k<state->n_samples; k++)
+            dist[state->count[k]] += 1.0;
+        for(int c=0; c<=n; c++)
+            res_datums[c] = Float8GetDatum(dist[c]/(double)state->n_samples);
+        pfree(dist);
+    }
+    PG_RETURN_ARRAYTYPE_P(construct_array(res_datums,n+1,FLOAT8OID,sizeof(float8),FLOAT8PASSBYVAL,'d'));
+}
+
+typedef struct pg_topk_ctx {
+    bdd_topk *tk;
+    V_rva     world;
+} pg_topk_ctx;
+
+PG_FUNCTION_INFO_V1(bdd_pg_topk_worlds);
+/**
+ * <code>topk_worlds(dict dictionary, bdd bdd, k integer) returns setof (rank integer, world text, prob double precision)</code>
+ * Returns the k most probable worlds in which bdd is true. A world assigns
+ * one value to every var of bdd and is returned as a conjunction of rva's.
+ * The worlds are computed by a k-best dynamic program over the bdd and
+ * reconstructed one row at a time.
+ *
+ */
+Datum
+bdd_pg_topk_worlds(PG_FUNCTION_ARGS)
+{
+    FuncCallContext *funcctx;
+    pg_topk_ctx     *ctx;
+    char            *_errmsg = NULL;
+
+    if ( SRF_IS_FIRSTCALL() ) {
+        MemoryContext    oldcontext;
+        TupleDesc        tupdesc;
+        bdd_dictionary  *dict;
+        bdd             *par_bdd;
+        int              k;
+
+        funcctx    = SRF_FIRSTCALL_INIT();
+        oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+        if ( get_call_result_type(fcinfo,NULL,&tupdesc) != TYPEFUNC_COMPOSITE )
+            ereport(ERROR,(errmsg("topk_worlds: function returning record called in context that cannot accept type record")));
+        funcctx->tuple_desc = BlessTupleDesc(tupdesc);
+        // fn_extra is used by the SRF machinery, no cached dictionary here
+        dict    = PG_GETARG_DICTIONARY(0);
+        par_bdd = PG_GETARG_BDD(1);
+        k       = PG_GETARG_INT32(2);
+        ctx     = (pg_topk_ctx*)palloc(sizeof(pg_topk_ctx));
+        V_rva_init(&ctx->world);
+        if ( !(ctx->tk = bdd_topk_create(dict,par_bdd,k,&_errmsg)) )
+            ereport(ERROR,(errmsg("topk_worlds: %s",(_errmsg ? _errmsg : "NULL"))));
+        funcctx->user_fctx = ctx;
+        funcctx->max_calls = bdd_topk_count(ctx->tk);
+        MemoryContextSwitchTo(oldcontext);
+    }
+    funcctx = SRF_PERCALL_SETUP();
+    ctx     = (pg_topk_ctx*)funcctx->user_fctx;
+    if ( funcctx->call_cntr < funcctx->max_calls ) {
+        pbuff         pbuff_struct, *pbuff=pbuff_init(&pbuff_struct);
+        Datum         values[3];
+        bool          nulls[3] = {false,false,false};
+        double        prob;
+        HeapTuple     tuple;
+        MemoryContext oldcontext;
+
+        // the world vector lives as long as ctx
+        oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+        prob       = bdd_topk_world(ctx->tk,funcctx->call_cntr,&ctx->world,&_errmsg);
+        MemoryContextSwitchTo(oldcontext);
+        if ( prob < 0.0 )
+            ereport(ERROR,(errmsg("topk_worlds: %s",(_errmsg ? _errmsg : "NULL"))));
+        if ( ctx->world.size == 0 )
+            bprintf(pbuff,"1"); // bdd is TRUE, the empty conjunction
+        for(int i=0; i<ctx->world.size; i++)
+            bprintf(pbuff,"%s%s=%d",(i ? "&" : ""),ctx->world.items[i].var,ctx->world.items[i].val);
+        values[0] = Int32GetDatum(funcctx->call_cntr+1);
+        values[1] = CStringGetTextDatum(pbuff->buffer);
+        values[2] = Float8GetDatum(prob);
+        pbuff_free(pbuff);
+        tuple = heap_form_tuple(funcctx->tuple_desc,values,nulls);
+        SRF_RETURN_NEXT(funcctx,HeapTupleGetDatum(tuple));
+    }
+    bdd_topk_free(ctx->tk);
+    V_rva_free(&ctx->world);
+    SRF_RETURN_DONE(funcctx);
+}
+
+PG_FUNCTION_INFO_V1(bdd_pg_count_worlds);
+/**
+ * <code>count_worlds(bdd bdd) returns bigint</code>
+ * Returns the number of worlds over the vars of bdd in which bdd is true.
+ * The domain of a var are its values in bdd plus one value for all others.
+ *
+ */
+Datum
+bdd_pg_count_worlds(PG_FUNCTION_ARGS)
+{
+    bdd     *par_bdd  = PG_GETARG_BDD(0);
+    char    *_errmsg  = NULL;
+    int64_t  count;
+
+    if ( (count = bdd_count_worlds(NULL,par_bdd,&_errmsg)) < 0 )
+        ereport(ERROR,(errmsg("count_worlds: %s",(_errmsg ? _errmsg : "NULL"))));
+    PG_RETURN_INT64(count);
+}
+
+PG_FUNCTION_INFO_V1(bdd_pg_count_worlds_dict);
+/**
+ * <code>count_worlds(dict dictionary, bdd bdd) returns bigint</code>
+ * Returns the number of worlds over the vars of bdd in which bdd is true,
+ * the domain of a var are its values in dict.
+ *
+ */
+Datum
+bdd_pg_count_worlds_dict(PG_FUNCTION_ARGS)
+{
+    bdd_dictionary  *dict     = PG_GETARG_DICTIONARY_CACHED(0);
+    bdd             *par_bdd  = PG_GETARG_BDD(1);
+    char            *_errmsg  = NULL;
+    int64_t          count;
+
+    if ( (count = bdd_count_worlds(dict,par_bdd,&_errmsg)) < 0 )
+        ereport(ERROR,(errmsg("count_worlds: %s",(_errmsg ? _errmsg : "NULL"))));
+    PG_RETURN_INT64(count);
+}
+
+PG_FUNCTION_INFO_V1(bdd_pg_worlds);
+/**
+ * <code>worlds(bdd bdd) returns setof text</code>
+ * Returns the paths to TRUE of bdd as conjunctions of rva's, one row per
+ * path. The rows are disjoint partial worlds, together they are bdd. The
+ * paths are walked one row at a time with a stack of at most the size of bdd.
+ *
+ */
+Datum
+bdd_pg_worlds(PG_FUNCTION_ARGS)
+{
+    FuncCallContext *funcctx;
+    bdd_paths       *paths;
+    pbuff            pbuff_struct, *pbuff;
+    char            *_errmsg = NULL;
+
+    if ( SRF_IS_FIRSTCALL() ) {
+        MemoryContext oldcontext;
+
+        funcctx    = SRF_FIRSTCALL_INIT();
+        oldcontext = MemoryContextSwitchTo(funcctx->multi_call_memory_ctx);
+        if ( !(paths = bdd_paths_create(PG_GETARG_BDD(0),&_errmsg)) )
+            ereport(ERROR,(errmsg("worlds: %s",(_errmsg ? _errmsg : "NULL"))));
+        funcctx->user_fctx = paths;
+        MemoryContextSwitchTo(oldcontext);
+    }
+    funcctx = SRF_PERCALL_SETUP();
+    paths   = (bdd_paths*)funcctx->user_fctx;
+    pbuff   = pbuff_init(&pbuff_struct);
+    if ( bdd_paths_next(paths,pbuff) ) {
+        Datum path = CStringGetTextDatum(pbuff->buffer);
+
+        pbuff_free(pbuff);
+        SRF_RETURN_NEXT(funcctx,path);
+    }
+    pbuff_free(pbuff);
+    bdd_paths_free(paths);
+    SRF_RETURN_DONE(funcctx);
+}
+
 PG_FUNCTION_INFO_V1(pg_bdd_contains);
 /**
  * <code>bdd_contains(bdd bdd, var cstring, val int) returns boolean</code>
@@ -294,6 +1212,97 @@ pg_bdd_restrict(PG_FUNCTION_ARGS)
     PG_RETURN_BDD(return_bdd);
 }
 
+PG_FUNCTION_INFO_V1(pg_bdd_restrict_evidence);
+/**
+ * <code>restrict(bdd bdd, evidence text[]) returns bdd</code>
+ * Restrict a bdd on a set of rva assignments in one pass. "x=1" observes x=1,
+ * "!x=1" restricts only x=1 to FALSE and "!x=*" all values of x.
+ *
+ */
+Datum
+pg_bdd_restrict_evidence(PG_FUNCTION_ARGS)
+{       
+    bdd       *par_bdd     = PG_GETARG_BDD(0);
+    ArrayType *par_ev      = PG_GETARG_ARRAYTYPE_P(1);
+    Datum     *ev_datums;
+    bool      *ev_nulls;
+    int        n_ev;
+    char     **evidence;
+    bdd       *return_bdd  = NULL;
+    char      *_errmsg     = NULL;
+
+    deconstruct_array(par_ev,TEXTOID,-1,false,'i',&ev_datums,&ev_nulls,&n_ev);
+    evidence = (char**)palloc((n_ev>0?n_ev:1)*sizeof(char*));
+    for(int i=0; i<n_ev; i++) {
+        if ( ev_nulls[i] )
+            ereport(ERROR,(errmsg("bdd_restrict: NULL evidence not allowed")));
+        evidence[i] = TextDatumGetCString(ev_datums[i]);
+    }
+    if ( !(return_bdd = bdd_restrict_evidence(par_bdd,evidence,n_ev,0,&_errmsg)) )
+        ereport(ERROR,(errmsg("bdd_restrict: %s",(_errmsg ? _errmsg : "NULL"))));
+    SET_VARSIZE(return_bdd,return_bdd->bytesize);
+    PG_RETURN_BDD(return_bdd);
+}
+
+PG_FUNCTION_INFO_V1(pg_bdd_compose);
+/**
+ * <code>compose(f bdd, rva text, g bdd) returns bdd</code>
+ * Substitute every occurrence of rva (var=val) in f by the bdd g.
+ *
+ */
+Datum
+pg_bdd_compose(PG_FUNCTION_ARGS)
+{       
+    bdd  *par_f       = PG_GETARG_BDD(0);
+    char *par_rva     = text_to_cstring(PG_GETARG_TEXT_PP(1));
+    bdd  *par_g       = PG_GETARG_BDD(2);
+    bdd  *return_bdd  = NULL;
+    char *_errmsg     = NULL;
+
+    if ( !(return_bdd = bdd_compose(par_f,par_rva,par_g,0,&_errmsg)) )
+        ereport(ERROR,(errmsg("bdd_compose: %s: %s",par_rva,(_errmsg ? _errmsg : "NULL"))));
+    SET_VARSIZE(return_bdd,return_bdd->bytesize);
+    PG_RETURN_BDD(return_bdd);
+}
+
+PG_FUNCTION_INFO_V1(pg_bdd_compose_vector);
+/**
+ * <code>compose(f bdd, rva text[], g bdd[]) returns bdd</code>
+ * Substitute rva[i] in f by g[i], all substitutions are done at once.
+ *
+ */
+Datum
+pg_bdd_compose_vector(PG_FUNCTION_ARGS)
+{       
+    bdd       *par_f       = PG_GETARG_BDD(0);
+    ArrayType *par_rva     = PG_GETARG_ARRAYTYPE_P(1);
+    ArrayType *par_g       = PG_GETARG_ARRAYTYPE_P(2);
+    Datum     *rva_datums, *g_datums;
+    bool      *rva_nulls,  *g_nulls;
+    int        n_rva, n_g;
+    char     **rva_str;
+    bdd      **g;
+    bdd       *return_bdd  = NULL;
+    char      *_errmsg     = NULL;
+
+    deconstruct_array(par_rva,TEXTOID,-1,false,'i',&rva_datums,&rva_nulls,&n_rva);
+    deconstruct_array(par_g,ARR_ELEMTYPE(par_g),-1,false,'d',&g_datums,&g_nulls,&n_g);
+    if ( n_rva != n_g )
+        ereport(ERROR,(errmsg("bdd_compose: %d rva's and %d bdd's",n_rva,n_g)));
+    rva_str = (char**)palloc((n_rva>0?n_rva:1)*sizeof(char*));
+    g       = (bdd**)palloc((n_rva>0?n_rva:1)*sizeof(bdd*));
+    for(int i=0; i<n_rva; i++) {
+        if ( rva_nulls[i] || g_nulls[i] )
+            ereport(ERROR,(errmsg("bdd_compose: NULL substitution not allowed")));
+        rva_str[i] = TextDatumGetCString(rva_datums[i]);
+        g[i]       = DatumGetBdd(PG_DETOAST_DATUM(g_datums[i]));
+    }
+    if ( !(return_bdd = bdd_compose_vector(par_f,rva_str,g,n_rva,0,&_errmsg)) )
+        ereport(ERROR,(errmsg("bdd_compose: %s",(_errmsg ? _errmsg : "NULL"))));
+    SET_VARSIZE(return_bdd,return_bdd->bytesize);
+    PG_RETURN_BDD(return_bdd);
+}
+
 PG_FUNCTION_INFO_V1(bdd_has_property);
 /**
  * <code>bdd_has_property(bdd bdd, mode integer, s cstring) returns boolean</code>
@@ -370,3 +1379,41 @@ pg_bdd_fast_equiv(PG_FUNCTION_ARGS)
         ereport(ERROR,(errmsg("bdd_uiv: %s",(_errmsg ? _errmsg : "NULL"))));
     PG_RETURN_BOOL(res);
 }
+
+PG_FUNCTION_INFO_V1(pg_bdd_implies);
+/**
+ * <code>bdd_implies(bdd lhs_bdd, bdd rhs_bdd) returns boolean</code>
+ * Return if lhs_bdd implies rhs_bdd
+ *
+ */
+Datum
+pg_bdd_implies(PG_FUNCTION_ARGS)
+{       
+    bdd  *lhs_bdd     = PG_GETARG_BDD(0);
+    bdd  *rhs_bdd     = PG_GETARG_BDD(1);
+    int   res         = -1;
+    char *_errmsg     = NULL;
+
+    if ( (res = bdd_implies(lhs_bdd, rhs_bdd, &_errmsg)) < 0 )
+        ereport(ERROR,(errmsg("bdd_implies: %s",(_errmsg ? _errmsg : "NULL"))));
+    PG_RETURN_BOOL(res);
+}
+
+PG_FUNCTION_INFO_V1(pg_bdd_disjoint);
+/**
+ * <code>bdd_disjoint(bdd lhs_bdd, bdd rhs_bdd) returns boolean</code>
+ * Return if lhs_bdd and rhs_bdd can not be TRUE at the same time
+ *
+ */
+Datum
+pg_bdd_disjoint(PG_FUNCTION_ARGS)
+{       
+    bdd  *lhs_bdd     = PG_GETARG_BDD(0);
+    bdd  *rhs_bdd     = PG_GETARG_BDD(1);
+    int   res         = -1;
+    char *_errmsg     = NULL;
+
+    if ( (res = bdd_disjoint(lhs_bdd, rhs_bdd, &_errmsg)) < 0 )
+        ereport(ERROR,(errmsg("bdd_disjoint: %s",(_errmsg ? _errmsg : "NULL"))));
+    PG_RETURN_BOOL(res);
+}
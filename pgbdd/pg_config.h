@@ -19,9 +19,15 @@
 
 #include "postgres.h"
 #include "funcapi.h"
+#include "access/htup_details.h"
 #include "fmgr.h"
 #include "utils/builtins.h"
 #include "utils/numeric.h"
+#include "utils/array.h"
+#include "catalog/pg_type.h"
+#include "utils/lsyscache.h"
+#include "utils/datum.h"
+#include "port/pg_bitutils.h"
 
 #define PG_CONFIG
 
@@ -36,8 +42,22 @@
 #define PG_GETARG_DICTIONARY(x)      DatumGetDictionary(          \
                 PG_DETOAST_DATUM(PG_GETARG_DATUM(x)))
 
+/*
+ * A private copy of a dictionary argument for functions which modify it,
+ * PG_GETARG_DICTIONARY() may return the datum of the tuple itself.
+ */
+#define PG_GETARG_DICTIONARY_COPY(x) DatumGetDictionary(          \
+                PG_DETOAST_DATUM_COPY(PG_GETARG_DATUM(x)))
+
 #define PG_RETURN_DICTIONARY(x)      PG_RETURN_POINTER(x)
 
+/*
+ * Read-only access to a dictionary argument. The detoasted, relocated and
+ * indexed dictionary is cached in fn_extra as long as the argument datum
+ * stays the same, see pg_dictionary.c. Never modify the returned dictionary.
+ */
+#define PG_GETARG_DICTIONARY_CACHED(x) pg_getarg_dictionary_cached(fcinfo,x)
+
 
 
 #define DatumGetDictionaryRef(x)     ((bdd_dictionary_ref *) DatumGetPointer(x))
@@ -53,6 +73,13 @@
 
 #define PG_RETURN_BDD(x)      PG_RETURN_POINTER(x)
 
+#define DatumGetDdnnf(x)      relocate_ddnnf(((ddnnf *) x))
+
+#define PG_GETARG_DDNNF(x)    DatumGetDdnnf(        \
+                PG_DETOAST_DATUM(PG_GETARG_DATUM(x)))
+
+#define PG_RETURN_DDNNF(x)    PG_RETURN_POINTER(x)
+
 //
 //
 //
@@ -64,6 +91,7 @@
 
 typedef struct pbuff pbuff; // forward, defined in utils.h
 typedef struct bdd   bdd;   // ,,
+typedef struct bdd_dictionary bdd_dictionary; // forward, defined in dictionary.h
 
 char* pbuff2cstring(pbuff* pbuff, int maxsz);
 text* pbuff2text(pbuff* pbuff, int maxsz);
@@ -71,6 +99,27 @@ text* pbuff2text(pbuff* pbuff, int maxsz);
 text* bdd2text(bdd* bdd, int encapsulate);
 char* bdd2cstring(bdd* bdd, int encapsulate);
 
+/*
+ * A pg_arg_cache keeps a private detoasted copy of a function argument in
+ * fn_mcxt. The key is a copy of the datum as passed, for toasted values this
+ * is the toast pointer or the compressed value, so a new version of the value
+ * never matches. Only usable in functions which do not use fn_extra
+ * themselves, so not in set returning functions.
+ */
+typedef struct pg_arg_cache {
+    struct varlena* key;            // copy of the argument datum, NULL when empty
+    void*           value;          // the cached value in fn_mcxt
+    void          (*cleanup)(void*); // frees value, pfree() when NULL
+} pg_arg_cache;
+
+pg_arg_cache*   pg_arg_cache_lookup(FunctionCallInfo fcinfo, int argno, int stable_only, int* hit);
+bdd_dictionary* pg_getarg_dictionary_cached(FunctionCallInfo fcinfo, int argno);
+bdd_dictionary* pg_dictionary_indexed_copy(Datum datum);
+
+typedef struct dict_sampler dict_sampler; // forward, defined in dictionary.h
+
+dict_sampler*   pg_getarg_dict_sampler_cached(FunctionCallInfo fcinfo, int argno);
+
 //
 //
 //
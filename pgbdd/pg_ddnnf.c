@@ -0,0 +1,107 @@
+/* 
+ * This file is part of the Dubio distribution (https://github.com/utwente-db/DuBio).
+ * Copyright (c) 2020 Jan Flokstra & Maurice van Keulen
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pg_config.h"
+
+#include "ddnnf.c"
+
+PG_FUNCTION_INFO_V1(ddnnf_in);
+/**
+ * <code>ddnnf_in(expression cstring) returns ddnnf</code>
+ * Compile the expression from the argument string to a ddnnf.
+ *
+ */
+Datum
+ddnnf_in(PG_FUNCTION_ARGS)
+{
+    char  *expr      = PG_GETARG_CSTRING(0);
+    char  *_errmsg   = NULL;
+    ddnnf *return_dd = NULL;
+
+    if ( !(return_dd = create_ddnnf(expr,&_errmsg)) )
+        ereport(ERROR,(errmsg("ddnnf_in: %s",(_errmsg ? _errmsg : "NULL"))));
+    SET_VARSIZE(return_dd,return_dd->bytesize);
+    PG_RETURN_DDNNF(return_dd);
+}
+
+PG_FUNCTION_INFO_V1(ddnnf_out);
+/**
+ * <code>ddnnf_out(dd ddnnf) returns cstring</code>
+ * Create a text representation of a ddnnf.
+ *
+ */
+Datum
+ddnnf_out(PG_FUNCTION_ARGS)
+{
+    ddnnf *par_dd = PG_GETARG_DDNNF(0);
+    pbuff pbuff_struct, *pbuff=pbuff_init(&pbuff_struct);
+
+    ddnnf2string(pbuff,par_dd,1/*encapsulation*/);
+    PG_RETURN_CSTRING(pbuff2cstring(pbuff,-1));
+}
+
+PG_FUNCTION_INFO_V1(ddnnf_pg_tostring);
+/**
+ * <code>tostring(dd ddnnf) returns text</code>
+ * Create an rva expression equivalent to the ddnnf.
+ *
+ */
+Datum
+ddnnf_pg_tostring(PG_FUNCTION_ARGS)
+{
+    ddnnf *par_dd = PG_GETARG_DDNNF(0);
+    pbuff pbuff_struct, *pbuff=pbuff_init(&pbuff_struct);
+
+    ddnnf2string(pbuff,par_dd,0);
+    PG_RETURN_TEXT_P(pbuff2text(pbuff,-1));
+}
+
+PG_FUNCTION_INFO_V1(ddnnf_pg_info);
+/**
+ * <code>info(dd ddnnf) returns text</code>
+ * The number of nodes of each type and the size of the ddnnf.
+ *
+ */
+Datum
+ddnnf_pg_info(PG_FUNCTION_ARGS)
+{
+    ddnnf *par_dd = PG_GETARG_DDNNF(0);
+    pbuff pbuff_struct, *pbuff=pbuff_init(&pbuff_struct);
+
+    ddnnf_info(par_dd,pbuff);
+    PG_RETURN_TEXT_P(pbuff2text(pbuff,-1));
+}
+
+PG_FUNCTION_INFO_V1(ddnnf_pg_prob);
+/**
+ * <code>prob(dict dictionary, dd ddnnf) returns double precision</code>
+ * Computes the probability of the ddnnf in one pass over its nodes with the
+ * rva probabilities in the dictionary, bound like they are for a bdd.
+ *
+ */
+Datum
+ddnnf_pg_prob(PG_FUNCTION_ARGS)
+{
+    bdd_dictionary *dict    = PG_GETARG_DICTIONARY_CACHED(0);
+    ddnnf          *par_dd  = PG_GETARG_DDNNF(1);
+    char           *_errmsg = NULL;
+    double          prob;
+
+    if ( (prob = ddnnf_probability(dict,par_dd,&_errmsg)) < 0.0 )
+        ereport(ERROR,(errmsg("ddnnf_pg_prob: %s",(_errmsg ? _errmsg : "NULL"))));
+    PG_RETURN_FLOAT8(prob);
+}
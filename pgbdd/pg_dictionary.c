@@ -19,6 +19,83 @@
 
 #include "dictionary.c"
 
+bdd_dictionary* pg_dictionary_indexed_copy(Datum datum) {
+    /*
+     * A private copy of a dictionary datum in the current memory context with
+     * a dictionary index, a dictionary stored before the dictionary index
+     * existed gets its index here.
+     */
+    bdd_dictionary* dict;
+
+    dict = bdd_dictionary_relocate((bdd_dictionary*)PG_DETOAST_DATUM_COPY(datum));
+    if ( !get_dict_index(dict) )
+        dict = dictionary_add_index(dict);
+    if ( !dict )
+        ereport(ERROR,(errmsg("pg_dictionary_indexed_copy: %s","internal error index")));
+    return dict;
+}
+
+bdd_dictionary* pg_getarg_dictionary_cached(FunctionCallInfo fcinfo, int argno) {
+    /*
+     * Dictionaries are often large, toasted and the same for every row. Keep
+     * the detoasted dictionary in fn_extra so the per call cost is the
+     * comparison of the datum with the key.
+     */
+    pg_arg_cache*   ac;
+    MemoryContext   oldcontext;
+    int             hit;
+
+    if ( !(ac = pg_arg_cache_lookup(fcinfo,argno,0/*stable_only*/,&hit)) )
+        return PG_GETARG_DICTIONARY(argno);
+    if ( !hit ) {
+        oldcontext = MemoryContextSwitchTo(fcinfo->flinfo->fn_mcxt);
+        ac->value  = pg_dictionary_indexed_copy(PG_GETARG_DATUM(argno));
+        MemoryContextSwitchTo(oldcontext);
+    }
+    return (bdd_dictionary*)ac->value;
+}
+
+static void pg_dict_sampler_free(void* value) {
+    dict_sampler*   ds   = (dict_sampler*)value;
+    bdd_dictionary* dict = ds->dict;
+
+    dict_sampler_free(ds);
+    pfree(dict);
+}
+
+dict_sampler* pg_getarg_dict_sampler_cached(FunctionCallInfo fcinfo, int argno) {
+    /*
+     * The sampling tables of a dictionary argument, cached with a private
+     * copy of the dictionary like pg_getarg_dictionary_cached() so they are
+     * built once for all calls with the same dictionary.
+     */
+    pg_arg_cache*   ac;
+    dict_sampler*   ds;
+    bdd_dictionary* dict;
+    MemoryContext   oldcontext;
+    char*           _errmsg = NULL;
+    int             hit;
+
+    if ( (ac = pg_arg_cache_lookup(fcinfo,argno,0/*stable_only*/,&hit)) && hit )
+        return (dict_sampler*)ac->value;
+    if ( ac ) {
+        oldcontext = MemoryContextSwitchTo(fcinfo->flinfo->fn_mcxt);
+        dict = bdd_dictionary_relocate((bdd_dictionary*)PG_DETOAST_DATUM_COPY(PG_GETARG_DATUM(argno)));
+    } else {
+        oldcontext = CurrentMemoryContext;
+        dict = PG_GETARG_DICTIONARY(argno);
+    }
+    ds = dictionary_sampler(dict,&_errmsg);
+    MemoryContextSwitchTo(oldcontext);
+    if ( !ds )
+        ereport(ERROR,(errmsg("pg_getarg_dict_sampler_cached: %s",(_errmsg ? _errmsg : "NULL"))));
+    if ( ac ) {
+        ac->value   = ds;
+        ac->cleanup = pg_dict_sampler_free;
+    }
+    return ds;
+}
+
 PG_FUNCTION_INFO_V1(dictionary_in);
 /**
  * <code>dictionary_in(vardef cstring) returns dictionary</code>
@@ -56,7 +133,7 @@ PG_FUNCTION_INFO_V1(dictionary_out);
 Datum
 dictionary_out(PG_FUNCTION_ARGS)
 {
-    bdd_dictionary  *dict = PG_GETARG_DICTIONARY(0);
+    bdd_dictionary  *dict = PG_GETARG_DICTIONARY_CACHED(0);
 
     pbuff pbuff_struct, *pbuff=pbuff_init(&pbuff_struct);
     char* result;
@@ -79,7 +156,7 @@ PG_FUNCTION_INFO_V1(dictionary_print);
 Datum
 dictionary_print(PG_FUNCTION_ARGS)
 {
-    bdd_dictionary  *dict = PG_GETARG_DICTIONARY(0);
+    bdd_dictionary  *dict = PG_GETARG_DICTIONARY_CACHED(0);
     pbuff pbuff_struct, *pbuff=pbuff_init(&pbuff_struct);
     text* result;
 
@@ -100,7 +177,7 @@ PG_FUNCTION_INFO_V1(dictionary_debug);
 Datum
 dictionary_debug(PG_FUNCTION_ARGS)
 {
-    bdd_dictionary  *dict = PG_GETARG_DICTIONARY(0);
+    bdd_dictionary  *dict = PG_GETARG_DICTIONARY_CACHED(0);
     pbuff pbuff_struct, *pbuff=pbuff_init(&pbuff_struct);
     text* result;
 
@@ -148,7 +225,7 @@ PG_FUNCTION_INFO_V1(dictionary_modify);
 Datum
 dictionary_modify(PG_FUNCTION_ARGS)
 {
-    bdd_dictionary  *dict         = PG_GETARG_DICTIONARY(0);
+    bdd_dictionary  *dict         = PG_GETARG_DICTIONARY_COPY(0);
     char            mode          = PG_GETARG_INT32(1);
     char            *vardefs      = PG_GETARG_CSTRING(2);
     bdd_dictionary  *storage_dict = NULL;
@@ -245,7 +322,7 @@ PG_FUNCTION_INFO_V1(dictionary_lookup_alternatives);
 Datum
 dictionary_lookup_alternatives(PG_FUNCTION_ARGS)
 {
-    bdd_dictionary  *dict = PG_GETARG_DICTIONARY(0);
+    bdd_dictionary  *dict = PG_GETARG_DICTIONARY_CACHED(0);
     char*  var = PG_GETARG_CSTRING(1);
     pbuff pbuff_struct, *pbuff=pbuff_init(&pbuff_struct);
     text* result;
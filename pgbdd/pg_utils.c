@@ -60,3 +60,69 @@ char* bdd2cstring(bdd* bdd, int encapsulate) {
     return pbuff2cstring(pbuff,-1);
 }
 
+/*
+ *
+ *
+ */
+
+typedef struct pg_fn_cache {
+    int          nargs;
+    pg_arg_cache arg[FLEXIBLE_ARRAY_MEMBER];
+} pg_fn_cache;
+
+static void pg_arg_cache_reset(pg_arg_cache* ac) {
+    if ( ac->value ) {
+        if ( ac->cleanup )
+            ac->cleanup(ac->value);
+        else
+            pfree(ac->value);
+    }
+    if ( ac->key )
+        pfree(ac->key);
+    ac->key     = NULL;
+    ac->value   = NULL;
+    ac->cleanup = NULL;
+}
+
+pg_arg_cache* pg_arg_cache_lookup(FunctionCallInfo fcinfo, int argno, int stable_only, int* hit) {
+    /*
+     * Returns the cache slot of argument argno. When *hit is set the slot
+     * value belongs to the current argument, otherwise the key is set and the
+     * caller must fill in the value. Returns NULL when the argument should not
+     * be cached. Arguments which are stable during the query (constants and
+     * parameters) are always cached. Other arguments only when stable_only is
+     * not set and they are toasted: inline uncompressed values are used in
+     * place without cost and in-memory toast pointers have no stable identity.
+     */
+    struct varlena* raw = (struct varlena*)DatumGetPointer(PG_GETARG_DATUM(argno));
+    FmgrInfo*       flinfo = fcinfo->flinfo;
+    pg_fn_cache*    fc;
+    pg_arg_cache*   ac;
+    Size            keysz;
+
+    *hit = 0;
+    if ( !flinfo )
+        return NULL;
+    if ( !get_fn_expr_arg_stable(flinfo,argno) &&
+         (stable_only || !(VARATT_IS_EXTERNAL_ONDISK(raw) || VARATT_IS_COMPRESSED(raw))) )
+        return NULL;
+    if ( VARATT_IS_EXTERNAL(raw) && !VARATT_IS_EXTERNAL_ONDISK(raw) )
+        return NULL;
+    if ( !(fc = (pg_fn_cache*)flinfo->fn_extra) ) {
+        fc = (pg_fn_cache*)MemoryContextAllocZero(flinfo->fn_mcxt,offsetof(pg_fn_cache,arg)+PG_NARGS()*sizeof(pg_arg_cache));
+        fc->nargs = PG_NARGS();
+        flinfo->fn_extra = fc;
+    }
+    if ( argno >= fc->nargs )
+        return NULL;
+    ac    = &fc->arg[argno];
+    keysz = VARSIZE_ANY(raw);
+    if ( ac->value && (VARSIZE_ANY(ac->key) == keysz) && (memcmp(ac->key,raw,keysz) == 0) ) {
+        *hit = 1;
+        return ac;
+    }
+    pg_arg_cache_reset(ac);
+    ac->key = (struct varlena*)MemoryContextAlloc(flinfo->fn_mcxt,keysz);
+    memcpy(ac->key,raw,keysz);
+    return ac;
+}
@@ -98,6 +98,27 @@ function restrict(bdd bdd, var cstring, val integer, torf boolean) returns bdd
      as '$libdir/pgbdd', 'pg_bdd_restrict'
      language C immutable strict;
 
+create 
+function restrict(bdd bdd, evidence text[]) returns bdd
+     as '$libdir/pgbdd', 'pg_bdd_restrict_evidence'
+     language C immutable strict;
+comment on function restrict(bdd,text[]) is
+'Restrict a bdd on all evidence in one pass. An entry ''x=1'' observes x=1 (other values of x become FALSE), ''!x=1'' makes x=1 FALSE and ''!x=*'' makes all values of x FALSE. Contradicting evidence like ''x=1'' with ''x=2'', ''!x=1'' or ''!x=*'' raises an error.';
+
+create 
+function compose(f bdd, rva text, g bdd) returns bdd
+     as '$libdir/pgbdd', 'pg_bdd_compose'
+     language C immutable strict;
+comment on function compose(bdd,text,bdd) is
+'Substitute every occurrence of rva (var=val) in bdd f by bdd g.';
+
+create 
+function compose(f bdd, rva text[], g bdd[]) returns bdd
+     as '$libdir/pgbdd', 'pg_bdd_compose_vector'
+     language C immutable strict;
+comment on function compose(bdd,text[],bdd[]) is
+'Substitute rva[i] in bdd f by bdd g[i]. All substitutions are done at once, so rva''s introduced by a g[i] are not substituted again and the order of the arrays does not matter.';
+
 create 
 function _bdd_has_property(bdd bdd, prop integer, str_prop cstring) returns BOOLEAN
      as '$libdir/pgbdd', 'bdd_has_property'
@@ -171,6 +192,20 @@ function bdd_fast_equiv(lhs_bdd bdd,rhs_bdd bdd) returns BOOLEAN
      as '$libdir/pgbdd', 'pg_bdd_fast_equiv'
      language C immutable strict;
 
+create 
+function bdd_implies(lhs_bdd bdd,rhs_bdd bdd) returns BOOLEAN
+     as '$libdir/pgbdd', 'pg_bdd_implies'
+     language C immutable strict;
+comment on function bdd_implies(bdd,bdd) is
+'Returns TRUE if lhs_bdd implies rhs_bdd.';
+
+create 
+function bdd_disjoint(lhs_bdd bdd,rhs_bdd bdd) returns BOOLEAN
+     as '$libdir/pgbdd', 'pg_bdd_disjoint'
+     language C immutable strict;
+comment on function bdd_disjoint(bdd,bdd) is
+'Returns TRUE if lhs_bdd and rhs_bdd can not be TRUE at the same time.';
+
 /*------------------------------
  * Definition of DICTIONARY type.
  *-------------------------------
@@ -340,9 +375,324 @@ function prob(dict dictionary, bdd bdd) returns double precision
 comment on function prob(dictionary, bdd) is
 'return probability of bdd expression using rva/probabilities defined in dictionary.';
 
+create 
+function prob(dict dictionary, bdds bdd[]) returns double precision[]
+     as '$libdir/pgbdd', 'bdd_pg_prob_array'
+     language C immutable strict;
+comment on function prob(dictionary, bdd[]) is
+'return the probabilities of an array of bdd expressions, sub expressions shared by the bdds are computed once.';
+
+CREATE OR REPLACE FUNCTION prob_set(dict dictionary, bdds bdd[]) RETURNS TABLE(i bigint, prob double precision)
+    AS $$ SELECT p.i, p.prob FROM unnest(prob($1,$2)) WITH ORDINALITY AS p(prob,i); $$
+    LANGUAGE SQL IMMUTABLE STRICT;
+comment on function prob_set(dictionary, bdd[]) is
+'return the probabilities of an array of bdd expressions as a set of (position, probability) rows.';
+
+create 
+function prob_scenarios(dicts dictionary[], bdd bdd) returns double precision[]
+     as '$libdir/pgbdd', 'bdd_pg_prob_scenarios'
+     language C immutable strict;
+comment on function prob_scenarios(dictionary[], bdd) is
+'return the probability of bdd for every dictionary in dicts, computed in one pass over the bdd.';
+
+create 
+function prob_gradient(dict dictionary, bdd bdd) 
+     returns table(rva text, prob double precision, derivative double precision, cond_prob double precision, banzhaf double precision)
+     as '$libdir/pgbdd', 'bdd_pg_prob_gradient'
+     language C immutable strict;
+comment on function prob_gradient(dictionary, bdd) is
+'return for every rva in bdd its probability, the derivative of prob(dict,bdd) to it, the probability of bdd given the rva and its Banzhaf value P(bdd|rva)-P(bdd|!rva).';
+
+create 
+function cond_prob(dict dictionary, a bdd, b bdd) returns double precision
+     as '$libdir/pgbdd', 'bdd_pg_cond_prob'
+     language C immutable strict;
+comment on function cond_prob(dictionary, bdd, bdd) is
+'return the conditional probability P(a|b) = P(a&b)/P(b) computed in one walk over a and b without creating a&b, NULL when P(b) is 0.';
+
+create 
+function prob_expr(dict dictionary, expr text) returns double precision
+     as '$libdir/pgbdd', 'bdd_pg_prob_expr'
+     language C immutable strict;
+comment on function prob_expr(dictionary, text) is
+'return the probability of the rva expression expr, computed directly from the text when expr is read-once and by creating the bdd when not.';
+
+create 
+function _expected_sum_accum(state double precision, value double precision, dict dictionary, bdd bdd) returns double precision
+     as '$libdir/pgbdd', 'bdd_pg_expected_sum_accum'
+     language C immutable strict;
+
+create aggregate expected_sum (double precision, dictionary, bdd)
+(
+    sfunc    = _expected_sum_accum,
+    stype    = double precision,
+    initcond = '0'
+);
+comment on aggregate expected_sum(double precision, dictionary, bdd) is
+'return the expected SUM of value over the rows, the sum of value*prob(dict,bdd). Exact also when the lineage of the rows overlaps.';
+
+create 
+function _expected_count_accum(state double precision, dict dictionary, bdd bdd) returns double precision
+     as '$libdir/pgbdd', 'bdd_pg_expected_count_accum'
+     language C immutable strict;
+
+create aggregate expected_count (dictionary, bdd)
+(
+    sfunc    = _expected_count_accum,
+    stype    = double precision,
+    initcond = '0'
+);
+comment on aggregate expected_count(dictionary, bdd) is
+'return the expected COUNT of the rows, the sum of prob(dict,bdd). Exact also when the lineage of the rows overlaps.';
+
+create 
+function _count_distribution_accum(state internal, dict dictionary, bdd bdd) returns internal
+     as '$libdir/pgbdd', 'bdd_pg_count_dist_accum'
+     language C immutable;
+
+create 
+function _count_distribution_final(state internal) returns double precision[]
+     as '$libdir/pgbdd', 'bdd_pg_count_dist_final'
+     language C immutable;
+
+create aggregate count_distribution (dictionary, bdd)
+(
+    sfunc     = _count_distribution_accum,
+    stype     = internal,
+    finalfunc = _count_distribution_final
+);
+comment on aggregate count_distribution(dictionary, bdd) is
+'return the distribution of the COUNT of the rows, element k+1 is the probability that exactly k rows exist. The dictionary of the first row is used.';
+
+create 
+function _prob_exceeds(dict dictionary, bdd bdd, t double precision, strict boolean) returns boolean
+     as '$libdir/pgbdd', 'bdd_pg_prob_exceeds'
+     language C immutable strict;
+
+CREATE OR REPLACE FUNCTION prob_exceeds(dict dictionary, bdd bdd, t double precision) RETURNS BOOLEAN
+    AS $$ SELECT _prob_exceeds($1,$2,$3,true); $$
+    LANGUAGE SQL IMMUTABLE STRICT;
+comment on function prob_exceeds(dictionary, bdd, double precision) is
+'Returns prob(dict,bdd) > t, stops the computation as soon as bounds on the probability decide.';
+
+CREATE OR REPLACE FUNCTION prob_at_least(dict dictionary, bdd bdd, t double precision) RETURNS BOOLEAN
+    AS $$ SELECT _prob_exceeds($1,$2,$3,false); $$
+    LANGUAGE SQL IMMUTABLE STRICT;
+comment on function prob_at_least(dictionary, bdd, double precision) is
+'Returns prob(dict,bdd) >= t, stops the computation as soon as bounds on the probability decide.';
+
+--
+-- prob_of(dict,bdd) compared with a threshold uses the bounded comparison,
+-- WHERE prob_of(dict,bdd) > 0.8 is the fast form of WHERE prob(dict,bdd) > 0.8
+--
+
+create type prob_of as (dict dictionary, bdd bdd);
+
+CREATE OR REPLACE FUNCTION prob_of(dict dictionary, bdd bdd) RETURNS prob_of
+    AS $$ SELECT ROW($1,$2)::prob_of; $$
+    LANGUAGE SQL IMMUTABLE STRICT;
+comment on function prob_of(dictionary, bdd) is
+'Returns the pair (dict,bdd) for threshold comparisons with the operators >, >=, < and <=.';
+
+CREATE OR REPLACE FUNCTION _prob_of_gt(p prob_of, t double precision) RETURNS BOOLEAN
+    AS $$ SELECT _prob_exceeds(($1).dict,($1).bdd,$2,true); $$
+    LANGUAGE SQL IMMUTABLE STRICT;
+CREATE OR REPLACE FUNCTION _prob_of_ge(p prob_of, t double precision) RETURNS BOOLEAN
+    AS $$ SELECT _prob_exceeds(($1).dict,($1).bdd,$2,false); $$
+    LANGUAGE SQL IMMUTABLE STRICT;
+CREATE OR REPLACE FUNCTION _prob_of_lt(p prob_of, t double precision) RETURNS BOOLEAN
+    AS $$ SELECT NOT _prob_exceeds(($1).dict,($1).bdd,$2,false); $$
+    LANGUAGE SQL IMMUTABLE STRICT;
+CREATE OR REPLACE FUNCTION _prob_of_le(p prob_of, t double precision) RETURNS BOOLEAN
+    AS $$ SELECT NOT _prob_exceeds(($1).dict,($1).bdd,$2,true); $$
+    LANGUAGE SQL IMMUTABLE STRICT;
+
+create operator >  (procedure = _prob_of_gt, leftarg = prob_of, rightarg = double precision, negator = <=);
+create operator >= (procedure = _prob_of_ge, leftarg = prob_of, rightarg = double precision, negator = <);
+create operator <  (procedure = _prob_of_lt, leftarg = prob_of, rightarg = double precision, negator = >=);
+create operator <= (procedure = _prob_of_le, leftarg = prob_of, rightarg = double precision, negator = >);
+
+create 
+function _topk_prob_accum(state internal, dict dictionary, bdd bdd, payload anyelement, k integer) returns internal
+     as '$libdir/pgbdd', 'bdd_pg_topk_prob_accum'
+     language C immutable;
+
+create 
+function _topk_prob_final(state internal, dict dictionary, bdd bdd, payload anyelement, k integer) returns anyarray
+     as '$libdir/pgbdd', 'bdd_pg_topk_prob_final'
+     language C immutable;
+
+create aggregate topk_prob (dictionary, bdd, anyelement, integer)
+(
+    sfunc           = _topk_prob_accum,
+    stype           = internal,
+    finalfunc       = _topk_prob_final,
+    finalfunc_extra
+);
+comment on aggregate topk_prob(dictionary, bdd, anyelement, integer) is
+'return the payloads of the k rows with the most probable bdd in descending probability, like ORDER BY prob(dict,bdd) DESC LIMIT k. Rows which can not reach the top k are rejected by bounds without computing their probability.';
+
+create 
+function prob_approx(dict dictionary, bdd bdd, epsilon double precision, delta double precision,
+                     max_samples integer default 1000000, max_ms integer default 0,
+                     out prob double precision, out lower double precision, out upper double precision,
+                     out samples integer, out method text)
+     returns record
+     as '$libdir/pgbdd', 'bdd_pg_prob_approx'
+     language C volatile strict;
+comment on function prob_approx(dictionary, bdd, double precision, double precision, integer, integer) is
+'return a Monte Carlo estimate of the probability of bdd within epsilon with probability 1-delta and its confidence interval [lower,upper], sampling stops at max_samples or after max_ms milliseconds (0 is no limit).';
+
+create 
+function prob_approx(dict dictionary, expr text, epsilon double precision, delta double precision,
+                     max_samples integer default 1000000, max_ms integer default 0,
+                     out prob double precision, out lower double precision, out upper double precision,
+                     out samples integer, out method text)
+     returns record
+     as '$libdir/pgbdd', 'bdd_pg_prob_approx_expr'
+     language C volatile strict;
+comment on function prob_approx(dictionary, text, double precision, double precision, integer, integer) is
+'return an estimate of the probability of a boolean rva expression as prob_approx(dictionary,bdd,...), DNF expressions are estimated by Karp-Luby without building the bdd, then epsilon is relative: the estimate is within epsilon*prob.';
+
+create 
+function sample_eval(dict dictionary, bdd bdd, n_samples integer, seed bigint default 0) returns integer
+     as '$libdir/pgbdd', 'bdd_pg_sample_eval'
+     language C immutable strict;
+comment on function sample_eval(dictionary, bdd, integer, bigint) is
+'return in how many of n_samples worlds sampled from dict bdd is true, 64 worlds are evaluated at once. The worlds only depend on seed, all bdd''s are evaluated in the same worlds.';
+
+create 
+function _sample_count_distribution_accum(state internal, dict dictionary, bdd bdd, n_samples integer, seed bigint) returns internal
+     as '$libdir/pgbdd', 'bdd_pg_sample_dist_accum'
+     language C immutable;
+
+create 
+function _sample_count_distribution_final(state internal) returns double precision[]
+     as '$libdir/pgbdd', 'bdd_pg_sample_dist_final'
+     language C immutable;
+
+create aggregate sample_count_distribution (dictionary, bdd, integer, bigint)
+(
+    sfunc     = _sample_count_distribution_accum,
+    stype     = internal,
+    finalfunc = _sample_count_distribution_final
+);
+comment on aggregate sample_count_distribution(dictionary, bdd, integer, bigint) is
+'return the Monte Carlo estimate of count_distribution() from n_samples worlds sampled with seed, element k+1 is the fraction of the worlds in which exactly k rows exist. n_samples and seed of the first row are used.';
+
+create 
+function topk_worlds(dict dictionary, bdd bdd, k integer) 
+     returns table(rank integer, world text, prob double precision)
+     as '$libdir/pgbdd', 'bdd_pg_topk_worlds'
+     language C immutable strict;
+comment on function topk_worlds(dictionary, bdd, integer) is
+'return the k most probable worlds (one value for every var of bdd) in which bdd is true, with their probability.';
+
+CREATE OR REPLACE FUNCTION mpe(dict dictionary, bdd bdd)
+    RETURNS TABLE(world text, prob double precision)
+    AS $$ SELECT world, prob FROM topk_worlds(dict, bdd, 1) $$
+    LANGUAGE SQL IMMUTABLE STRICT;
+comment on function mpe(dictionary, bdd) is
+'return the most probable world (one value for every var of bdd) in which bdd is true, with its probability.';
+
+create 
+function mpe_prob(dict dictionary, bdd bdd) returns double precision
+     as '$libdir/pgbdd', 'bdd_pg_mpe_prob'
+     language C immutable strict;
+comment on function mpe_prob(dictionary, bdd) is
+'return the probability of the most probable world in which bdd is true, as mpe() but computed in one pass without the world.';
+
+create 
+function count_worlds(bdd bdd) returns bigint
+     as '$libdir/pgbdd', 'bdd_pg_count_worlds'
+     language C immutable strict;
+comment on function count_worlds(bdd) is
+'return the number of worlds (one value for every var of bdd) in which bdd is true, the values of a var are its values in bdd plus one for all other values.';
+
+create 
+function count_worlds(dict dictionary, bdd bdd) returns bigint
+     as '$libdir/pgbdd', 'bdd_pg_count_worlds_dict'
+     language C immutable strict;
+comment on function count_worlds(dictionary, bdd) is
+'return the number of worlds (one value from dict for every var of bdd) in which bdd is true.';
+
+create 
+function worlds(bdd bdd) returns setof text
+     as '$libdir/pgbdd', 'bdd_pg_worlds'
+     language C immutable strict;
+comment on function worlds(bdd) is
+'return the paths of bdd to true, one row per path, as disjoint conjunctions of rva''s (partial worlds).';
+
 create 
 function prob(dict_ref dictionary_ref, bdd bdd) returns double precision
      as '$libdir/pgbdd', 'bdd_pg_prob_by_ref'
      language C immutable strict;
 comment on function prob(dictionary_ref, bdd) is
 'return probability of bdd expression using rva/probabilities defined in dictionary reference.';
+
+create 
+function _prob_op(dict dictionary, operator cstring, lhs_bdd bdd, rhs_bdd bdd) returns double precision
+     as '$libdir/pgbdd', 'bdd_pg_prob_op'
+     language C immutable strict;
+
+CREATE OR REPLACE FUNCTION prob_and(dict dictionary, lbdd bdd, rbdd bdd) RETURNS double precision
+    AS $$ SELECT _prob_op($1,'&',$2,$3); $$
+    LANGUAGE SQL IMMUTABLE STRICT;
+comment on function prob_and(dictionary, bdd, bdd) is
+'return probability of (lbdd & rbdd), computed as a product when lbdd and rbdd share no variables.';
+
+CREATE OR REPLACE FUNCTION prob_or(dict dictionary, lbdd bdd, rbdd bdd) RETURNS double precision
+    AS $$ SELECT _prob_op($1,'|',$2,$3); $$
+    LANGUAGE SQL IMMUTABLE STRICT;
+comment on function prob_or(dictionary, bdd, bdd) is
+'return probability of (lbdd | rbdd), computed without creating the combined bdd when lbdd and rbdd share no variables.';
+
+/*------------------------
+ * Definition of DDNNF type.
+ *------------------------
+ */ 
+
+create 
+function ddnnf_in(expression cstring) returns ddnnf
+     as '$libdir/pgbdd', 'ddnnf_in'
+     language C immutable strict;
+comment on function ddnnf_in(cstring) is
+'Compile a ddnnf from the rva expression in the argument string.';
+
+create 
+function ddnnf_out(dd ddnnf) returns cstring
+     as '$libdir/pgbdd', 'ddnnf_out'
+     language C immutable strict;
+comment on function ddnnf_out(ddnnf) is
+'create a serialised TEXT representation of a ddnnf.';
+
+CREATE TYPE ddnnf (
+    input = ddnnf_in,
+    output = ddnnf_out,
+    internallength = variable,
+    alignment = double,
+    storage = main
+);
+comment on type ddnnf is
+'A decision-DNNF circuit over rva''s, an alternative for a bdd when every var order gives a big bdd. Compare pg_column_size() to store the smaller one.';
+
+create 
+function tostring(dd ddnnf) returns text
+     as '$libdir/pgbdd', 'ddnnf_pg_tostring'
+     language C immutable strict;
+comment on function tostring(ddnnf) is
+'get an rva expression equivalent to the ddnnf.';
+
+create 
+function info(dd ddnnf) returns text
+     as '$libdir/pgbdd', 'ddnnf_pg_info'
+     language C immutable strict;
+comment on function info(ddnnf) is
+'get the number of nodes of each type and the size of the ddnnf.';
+
+create 
+function prob(dict dictionary, dd ddnnf) returns double precision
+     as '$libdir/pgbdd', 'ddnnf_pg_prob'
+     language C immutable strict;
+comment on function prob(dictionary, ddnnf) is
+'return probability of the ddnnf using rva/probabilities defined in dictionary, in one pass over the nodes.';
@@ -24,6 +24,7 @@
 #include "bdd.c"
 
 #include <time.h>
+#include <math.h>
 static clock_t _clock_start, _clock_stop;
 #define CLOCK_START() _clock_start = clock()
 #define CLOCK_STOP()  _clock_stop  = clock()
@@ -142,6 +143,39 @@ static bdd_dictionary* get_test_dictionary(char* dict_vars, char** _errmsg) {
     return res;
 }
 
+/*
+ * The dictionary of the random tests, vars genvar(0..n_vars-1) with values
+ * 0..n_vals. Without weights the probability of value i is proportional to
+ * i+1 so the values of a var sum to 1, otherwise it is
+ * ((i*mul_i+v*mul_v)%mod+1)/div. The dictionary string extra is added when
+ * not NULL.
+ */
+typedef struct test_weights {
+    int    mul_i, mul_v, mod;
+    double div;
+} test_weights;
+
+static bdd_dictionary* random_test_dictionary(char* test, int n_vars, int n_vals, test_weights* w, char* extra) {
+    pbuff pb_struct, *pb=pbuff_init(&pb_struct);
+    char  *_errmsg = NULL;
+    bdd_dictionary* dict;
+
+    for (int v=0; v<n_vars; v++) {
+        for (int i=0; i<=n_vals; i++) {
+            double p = w ? (double)((i*w->mul_i+v*w->mul_v)%w->mod+1)/w->div
+                         : (double)(i+1)/(double)((n_vals+1)*(n_vals+2)/2);
+
+            bprintf(pb,"%s=%d:%f;",genvar(v),i,p);
+        }
+    }
+    if ( extra )
+        bprintf(pb,"%s",extra);
+    if ( !(dict = get_test_dictionary(pb->buffer,&_errmsg)) )
+        pg_fatal("%s: error creating dictionary: %s",test,_errmsg);
+    pbuff_free(pb);
+    return dict;
+}
+
 static bdd* get_test_bdd(char* expr, int verbose, char** _errmsg) {
     return create_bdd(BDD_DEFAULT,expr,_errmsg,verbose);
 }
@@ -519,6 +553,123 @@ static void test_restrict(){
     }
 }
 
+static struct {
+    char* expr;
+    char* evidence[4];
+    char* expected;
+} restrict_evidence_tests[] = {
+    {"(x=1&y=1)|(x=2&z=1)|w=1",  {"x=1","!w=1",NULL},    "y=1"},
+    {"(x=1&y=1)|(x=2&z=1)|w=1",  {"x=3",NULL},           "w=1"},
+    {"(x=1&y=1)|(x=2&y=2)",      {" y = 2 ",NULL},       "!x=1&x=2"},
+    {"(x=1|x=2)&(y=1|z=1)",      {"!x=1","z=1",NULL},    "x=2"},
+    {"(x=1&y=1)|(x=2&z=1)",      {"!x=*",NULL},          "0"},
+    {"(x=1&y=1)|(x=2&z=1)",      {"y=1","z=1",NULL},     "x=1|x=2"},
+    {"(x=1&y=1)|(x=2&z=1)|x=3",  {"x=2","!x=1","x=2",NULL}, "z=1"},
+    {NULL,                       {NULL},                 NULL}
+};
+
+static void test_restrict_evidence(){
+    char* _errmsg = NULL;
+
+    for(int i=0; restrict_evidence_tests[i].expr; i++) {
+        pbuff pbuff_struct, *pb=pbuff_init(&pbuff_struct);
+        bdd  *test_bdd, *restr_bdd;
+        char *restr_str;
+        int   n_ev = 0;
+
+        while ( restrict_evidence_tests[i].evidence[n_ev] )
+            n_ev++;
+        if ( !(test_bdd = create_bdd(BDD_DEFAULT,restrict_evidence_tests[i].expr,&_errmsg,0)) )
+            pg_fatal("test_restrict_evidence: create error: %s",_errmsg);
+        if ( !(restr_bdd = bdd_restrict_evidence(test_bdd,restrict_evidence_tests[i].evidence,n_ev,0,&_errmsg)) )
+            pg_fatal("test_restrict_evidence: restrict error: %s",_errmsg);
+        bdd2string(pb,restr_bdd,0);
+        restr_str = pbuff_preserve_or_alloc(pb);
+        if ( bdd_test_equivalence(restr_str,restrict_evidence_tests[i].expected,&_errmsg) != 1 )
+            pg_fatal("test_restrict_evidence:assert: %s restricted to \"%s\", expected \"%s\"",restrict_evidence_tests[i].expr,restr_str,restrict_evidence_tests[i].expected);
+        FREE(restr_str);
+        FREE(restr_bdd);
+        FREE(test_bdd);
+    }
+    {   // conflicting observations and a bare wildcard must be rejected
+        char* conflict[][2] = {{"x=1","x=2"},{"x=1","!x=1"},{"!x=1","x=1"},{"x=1","!x=*"},{"!x=*","x=2"},{"x=*",NULL}};
+        bdd*  test_bdd      = create_bdd(BDD_DEFAULT,"x=1|x=2",&_errmsg,0);
+
+        for(int i=0; i<(int)(sizeof(conflict)/sizeof(conflict[0])); i++) {
+            if ( !test_bdd || bdd_restrict_evidence(test_bdd,conflict[i],(conflict[i][1]?2:1),0,&_errmsg) )
+                pg_fatal("test_restrict_evidence:assert: conflict %d not detected",i);
+        }
+        FREE(test_bdd);
+    }
+}
+
+static struct {
+    char* f;
+    char* rva[3];
+    char* g[3];
+    char* expected;
+} compose_tests[] = {
+    {"(x=1&y=1)|z=1",  {"x=1",NULL},        {"(a=1|b=1)",NULL},        "((a=1|b=1)&y=1)|z=1"},
+    {"(x=1&y=1)|z=1",  {"x=2",NULL},        {"a=1",NULL},              "(x=1&y=1)|z=1"},
+    {"!x=1&(y=1|x=1)", {"x=1",NULL},        {"a=1&b=2",NULL},          "!(a=1&b=2)&y=1"},
+    {"x=1|y=1",        {"x=1","y=1",NULL},  {"a=1&b=1","c=1",NULL},    "(a=1&b=1)|c=1"},
+    {"x=1&y=1",        {"x=1","a=1",NULL},  {"a=1|b=1","c=1",NULL},    "(a=1|b=1)&y=1"},
+    {"x=1&!y=1",       {"x=1","y=1",NULL},  {"y=1","x=1",NULL},        "y=1&!x=1"},
+    {"x=1|x=2|y=1",    {"x=2","y=1",NULL},  {"x=1&z=1","x=3",NULL},    "x=1|x=3"},
+    {NULL,             {NULL},              {NULL},                    NULL}
+};
+
+static void test_compose(){
+    char* _errmsg = NULL;
+
+    for(int i=0; compose_tests[i].f; i++) {
+        pbuff pbuff_struct, *pb=pbuff_init(&pbuff_struct);
+        bdd  *f, *g[3], *res;
+        char *res_str;
+        int   n = 0;
+
+        if ( !(f = create_bdd(BDD_DEFAULT,compose_tests[i].f,&_errmsg,0)) )
+            pg_fatal("test_compose: create error: %s",_errmsg);
+        while ( compose_tests[i].rva[n] ) {
+            if ( !(g[n] = create_bdd(BDD_DEFAULT,compose_tests[i].g[n],&_errmsg,0)) )
+                pg_fatal("test_compose: create error: %s",_errmsg);
+            n++;
+        }
+        if ( n == 1 )
+            res = bdd_compose(f,compose_tests[i].rva[0],g[0],0,&_errmsg);
+        else
+            res = bdd_compose_vector(f,compose_tests[i].rva,g,n,0,&_errmsg);
+        if ( !res )
+            pg_fatal("test_compose: compose error: %s",_errmsg);
+        bdd2string(pb,res,0);
+        res_str = pbuff_preserve_or_alloc(pb);
+        if ( bdd_test_equivalence(res_str,compose_tests[i].expected,&_errmsg) != 1 )
+            pg_fatal("test_compose:assert: %s composed to \"%s\", expected \"%s\"",compose_tests[i].f,res_str,compose_tests[i].expected);
+        FREE(res_str);
+        FREE(res);
+        if ( n > 1 ) { // the substitution is simultaneous, the order does not matter
+            char* rev_rva[3];
+            bdd*  rev_g[3];
+
+            for(int j=0; j<n; j++) {
+                rev_rva[j] = compose_tests[i].rva[n-1-j];
+                rev_g[j]   = g[n-1-j];
+            }
+            if ( !(res = bdd_compose_vector(f,rev_rva,rev_g,n,0,&_errmsg)) )
+                pg_fatal("test_compose: compose error: %s",_errmsg);
+            bdd2string(pbuff_init(pb),res,0); // res_str owns the old buffer
+            res_str = pbuff_preserve_or_alloc(pb);
+            if ( bdd_test_equivalence(res_str,compose_tests[i].expected,&_errmsg) != 1 )
+                pg_fatal("test_compose:assert: %s reversed composed to \"%s\", expected \"%s\"",compose_tests[i].f,res_str,compose_tests[i].expected);
+            FREE(res_str);
+            FREE(res);
+        }
+        for(int j=0; j<n; j++)
+            FREE(g[j]);
+        FREE(f);
+    }
+}
+
 static void test_bdd_creation(){
     // char* expr = "(x=1 & y=1 & z=1 )";
     // char* expr = "(x=1&y=1) |(z=5)";
@@ -751,6 +902,1317 @@ static void random_test(int n, long seed, int verbose) {
 
 
 
+/*
+ * Check that apply and the text based operators produce bdd's with the same
+ * probability and that apply never creates a path where two values of the
+ * same var hold.
+ */
+
+static int has_samevar_high(bdd* bdd) {
+    for(nodei i=0; i<BDD_TREESIZE(bdd); i++) {
+        rva_node* node = BDD_NODE(bdd,i);
+        if ( !IS_LEAF(node) && !IS_LEAF_I(bdd,node->high) && IS_SAMEVAR(&node->rva,BDD_RVA(bdd,node->high)) )
+            return 1;
+    }
+    return 0;
+}
+
+static void random_apply_test(int n, long seed) {
+    pbuff pb_struct, *pb=pbuff_init(&pb_struct);
+    char  *_errmsg = NULL;
+    bdd_dictionary* dict;
+
+    dict = random_test_dictionary("random_apply_test",RANDEXPR.N_VARS+1,RANDEXPR.N_VALS,NULL,NULL);
+    srand(seed);
+    for (int i=0; i<n; i++) {
+        char  op = (i%2) ? '&' : '|';
+        bdd  *l, *r, *by_text, *by_apply;
+        double p_text, p_apply;
+
+        if ( !(l = create_bdd(BDD_DEFAULT,random_expression(&RANDEXPR,pb),&_errmsg,0)) )
+            pg_fatal("random_apply_test: error: %s",_errmsg);
+        if ( !(r = create_bdd(BDD_DEFAULT,random_expression(&RANDEXPR,pb),&_errmsg,0)) )
+            pg_fatal("random_apply_test: error: %s",_errmsg);
+        if ( !(by_text = bdd_operator(op,BY_TEXT,l,r,&_errmsg)) )
+            pg_fatal("random_apply_test: error: %s",_errmsg);
+        if ( !(by_apply = bdd_operator(op,BY_APPLY,l,r,&_errmsg)) )
+            pg_fatal("random_apply_test: error: %s",_errmsg);
+        if ( has_samevar_high(by_apply) )
+            pg_fatal("random_apply_test:assert: same var on high branch");
+        p_text  = bdd_probability(dict,by_text,NULL,0,&_errmsg);
+        p_apply = bdd_probability(dict,by_apply,NULL,0,&_errmsg);
+        if ( (p_text < 0.0) || (p_apply < 0.0) )
+            pg_fatal("random_apply_test: error computing prob: %s",_errmsg);
+        if ( fabs(p_text-p_apply) > 1e-9 )
+            pg_fatal("random_apply_test:assert: prob text=%f apply=%f",p_text,p_apply);
+        FREE(l); FREE(r); FREE(by_text); FREE(by_apply);
+    }
+    FREE(dict);
+    pbuff_free(pb);
+}
+
+/*
+ * Check the support based fast paths. The rhs expression gets its vars
+ * shifted to w..z (disjoint and ordered after a..d) for the even tests and
+ * keeps sharing vars with the lhs for the odd tests.
+ */
+
+static void random_support_test(int n, long seed) {
+    pbuff pb_struct, *pb=pbuff_init(&pb_struct);
+    char  *_errmsg = NULL;
+    bdd_dictionary* dict;
+
+    for (int v=0; v<=RANDEXPR.N_VARS; v++) {
+        for (int i=0; i<=RANDEXPR.N_VALS; i++) {
+            double p = (double)(i+1)/(double)((RANDEXPR.N_VALS+1)*(RANDEXPR.N_VALS+2)/2);
+            bprintf(pb,"%s=%d:%f;",genvar(v),i,p);
+            bprintf(pb,"%c=%d:%f;",genvar(v)[0]+22,i,p);
+        }
+    }
+    if ( !(dict = get_test_dictionary(pb->buffer,&_errmsg)) )
+        pg_fatal("random_support_test: error creating dictionary: %s",_errmsg);
+    srand(seed);
+    for (int i=0; i<n; i++) {
+        char  op = ((i/2)%2) ? '&' : '|';
+        bdd  *l, *r, *by_text, *by_apply;
+        double p_text, p_apply, p_op;
+
+        if ( !(l = create_bdd(BDD_DEFAULT,random_expression(&RANDEXPR,pb),&_errmsg,0)) )
+            pg_fatal("random_support_test: error: %s",_errmsg);
+        random_expression(&RANDEXPR,pb);
+        if ( (i%2) == 0 ) {
+            for (char* c=pb->buffer; *c; c++)
+                if ( islower(*c) ) *c += 22;
+        }
+        if ( !(r = create_bdd(BDD_DEFAULT,pb->buffer,&_errmsg,0)) )
+            pg_fatal("random_support_test: error: %s",_errmsg);
+        if ( !(by_text = bdd_operator(op,BY_TEXT,l,r,&_errmsg)) )
+            pg_fatal("random_support_test: error: %s",_errmsg);
+        if ( !(by_apply = bdd_operator(op,BY_APPLY,(i%4)<2?l:r,(i%4)<2?r:l,&_errmsg)) )
+            pg_fatal("random_support_test: error: %s",_errmsg);
+        p_text  = bdd_probability(dict,by_text,NULL,0,&_errmsg);
+        p_apply = bdd_probability(dict,by_apply,NULL,0,&_errmsg);
+        p_op    = bdd_probability_op(dict,op,l,r,0,&_errmsg);
+        if ( (p_text < 0.0) || (p_apply < 0.0) || (p_op < 0.0) )
+            pg_fatal("random_support_test: error computing prob: %s",_errmsg);
+        if ( (fabs(p_text-p_apply) > 1e-9) || (fabs(p_text-p_op) > 1e-9) )
+            pg_fatal("random_support_test:assert: prob text=%f apply=%f op=%f",p_text,p_apply,p_op);
+        { // l as a stable operand, support and probability prepared once
+            V_rva  sl_struct, *sl = V_rva_init(&sl_struct);
+            V_rva  sr_struct, *sr = V_rva_init(&sr_struct);
+            double pl = -1.0;
+
+            if ( !bdd_support(l,sl,&_errmsg) || !bdd_support(r,sr,&_errmsg) )
+                pg_fatal("random_support_test: error: %s",_errmsg);
+            if ( (bdd_precedes(l,r) != support_precedes(sl,sr)) || (bdd_precedes(r,l) != support_precedes(sr,sl)) )
+                pg_fatal("random_support_test:assert: var range and support order differ");
+            V_rva_free(sr);
+            for (int k=0; k<2; k++) {
+                double p_stable = bdd_probability_op_support(dict,op,l,sl,&pl,r,NULL,NULL,0,&_errmsg);
+                if ( p_stable < 0.0 )
+                    pg_fatal("random_support_test: error computing prob: %s",_errmsg);
+                if ( fabs(p_text-p_stable) > 1e-9 )
+                    pg_fatal("random_support_test:assert: prob text=%f stable=%f",p_text,p_stable);
+            }
+            V_rva_free(sl);
+        }
+        FREE(l); FREE(r); FREE(by_text); FREE(by_apply);
+    }
+    FREE(dict);
+    pbuff_free(pb);
+}
+
+/*
+ * The original top-down recursive probability algorithm, used as reference
+ * for the linear bottom-up bdd_probability().
+ */
+
+static double reference_probability_node(bdd_dictionary* dict, bdd* bdd, nodei T, char** extra,int verbose,char** _errmsg) {
+    nodei TT;
+    rva_node *n_T, *n_TT;
+    double m;
+    double p, P_n;
+
+    n_T = n_TT = BDD_NODE(bdd,T);
+    if ( IS_LEAF(n_T) ) {
+        p = P_n = LEAF_BOOLVALUE(n_T) ? 1.0 : 0.0;
+#ifdef BDD_VERBOSE
+        if ( verbose )
+            fprintf(stdout,"+NODE[#%d]:LEAF=%f)\n",T,p);
+#endif
+    } else {
+        double P_check = -1.0;
+
+        P_n = lookup_probability(dict,&n_T->rva);
+        if ( P_n < 0.0 ) {
+            char *str_rep;
+
+            pbuff pbuff_struct, *pbuff=pbuff_init(&pbuff_struct);
+            bdd2string(pbuff,bdd,0);
+            str_rep = MALLOC(pbuff->size+1);
+            memcpy(str_rep, pbuff->buffer, pbuff->size+1);
+            pbuff_free(pbuff);
+            pg_error(_errmsg,"dictionary_lookup: rva[\'%s\'] not found in %s.",n_T->rva.var, str_rep);
+            return -1.0;
+        }
+        m = 1.0 - P_n;
+        P_check = reference_probability_node(dict,bdd,n_TT->high,extra,verbose,_errmsg) * P_n;
+        if ( P_check < 0 )
+            return P_check;
+        p = P_check;
+#ifdef BDD_VERBOSE
+        if ( verbose )
+            fprintf(stdout,"+NODE[#%d]:START: %s=%d, m=%f, p=%f\n",T,n_T->rva.var,n_T->rva.val,m,p);
+#endif
+        if ( IS_SAMEVAR(BDD_RVA(bdd,n_TT->high),&n_T->rva) ) {
+            pg_error(_errmsg,"probabilty_alg:loop: unexpected var \'%s\' high branch",n_T->rva.var);
+            return -1.0;
+        }
+        while ( IS_SAMEVAR(BDD_RVA(bdd,n_TT->low),&n_T->rva) ) {
+            TT = n_TT->low;
+            n_TT = BDD_NODE(bdd,TT);
+            if ( IS_SAMEVAR(BDD_RVA(bdd,n_TT->high),&n_T->rva) ) {
+                pg_error(_errmsg,"probabilty_alg: unexpected var \'%s\' high branch",n_T->rva.var);
+                return -1.0;
+            }
+            P_n = lookup_probability(dict,&n_TT->rva);
+            if ( P_n < 0.0 ) {
+                pg_error(_errmsg,"dictionary_lookup: rva[\'%s\'] not found.",n_TT->rva.var);
+                return -1.0;
+            }
+            m = m - P_n;
+            P_check = reference_probability_node(dict,bdd,n_TT->high,extra,verbose,_errmsg);
+            if ( P_check < 0 )
+                return P_check;
+            p =  p + P_check * P_n;
+#ifdef BDD_VERBOSE
+            if ( verbose )
+                fprintf(stdout,"+NODE[#%d]:SAMEVAR-LOOP: %s=%d, P_n=%f, m=%f, p=%f\n",T,n_TT->rva.var, n_TT->rva.val, P_n, m, p);
+#endif
+        }
+        p =  p + reference_probability_node(dict,bdd,n_TT->low,extra,verbose,_errmsg) * m;
+#ifdef BDD_VERBOSE
+        if ( verbose )
+            fprintf(stdout,"+NODE[#%d]:END: p=%f\n",T, p);
+#endif
+   }
+   if ( extra )
+       sprintf(extra[T],"<i>(%.3f)<br/>%.3f<br/>%d</i>",lookup_probability(dict,BDD_RVA(bdd,T)),p,T);
+#ifdef BDD_VERBOSE
+        if ( verbose )
+            fprintf(stdout, "+**NODE[#%d]:result=%f\n",T,p);
+#endif
+   /* INCOMPLETE: check if prob is a very small negative number and if soo make it 0
+    */
+   if ( p < 0.0 || p > 1.0 ) {
+       char *str_rep;
+
+       pbuff pbuff_struct, *pbuff=pbuff_init(&pbuff_struct);
+       bdd2string(pbuff,bdd,0);
+       str_rep = MALLOC(pbuff->size+1);
+       memcpy(str_rep, pbuff->buffer, pbuff->size+1);
+       pbuff_free(pbuff);
+       pg_error(_errmsg,"probability_check: probvalue %f out of range: %s", p, str_rep);
+       return -1.0;
+   }
+   return p;
+}
+
+static void random_probability_test(int n, long seed) {
+    pbuff pb_struct, *pb=pbuff_init(&pb_struct);
+    char  *_errmsg = NULL;
+    bdd_dictionary* dict;
+
+    dict = random_test_dictionary("random_probability_test",RANDEXPR.N_VARS+1,RANDEXPR.N_VALS,NULL,NULL);
+    srand(seed);
+    for (int i=0; i<n; i++) {
+        bdd   *pbdd;
+        double p_ref, p;
+
+        if ( !(pbdd = create_bdd(BDD_DEFAULT,random_expression(&RANDEXPR,pb),&_errmsg,0)) )
+            pg_fatal("random_probability_test: error: %s",_errmsg);
+        p_ref = reference_probability_node(dict,pbdd,BDD_ROOT(pbdd),NULL,0,&_errmsg);
+        p     = bdd_probability(dict,pbdd,NULL,0,&_errmsg);
+        if ( (p_ref < 0.0) || (p < 0.0) )
+            pg_fatal("random_probability_test: error computing prob: %s",_errmsg);
+        if ( fabs(p_ref-p) > 1e-9 )
+            pg_fatal("random_probability_test:assert: prob reference=%f linear=%f",p_ref,p);
+        FREE(pbdd);
+    }
+    FREE(dict);
+    pbuff_free(pb);
+}
+
+/*
+ * bdd_probability_parallel() must give the same results as bdd_probability(),
+ * with min_level 1 every level is done in parallel, with the default the
+ * small bdd's here are done by one worker.
+ */
+static randexpr  RANDEXPR_PAR = {
+    .MAX_LEVELS       =  2,
+    .MAX_CLUSTER      =  4,
+    .MAX_CLUSTER_SIZE =  3,
+    .NOT_MODULO       =  5,
+    .N_VARS           =  7,
+    .N_VALS           =  4
+};
+
+static void random_probability_parallel_test(int n, long seed) {
+    pbuff pb_struct, *pb=pbuff_init(&pb_struct);
+    char  *_errmsg = NULL;
+    bdd_dictionary* dict;
+    bdd   *pbdd;
+
+    dict = random_test_dictionary("random_probability_parallel_test",RANDEXPR_PAR.N_VARS+1,RANDEXPR_PAR.N_VALS,NULL,NULL);
+    srand(seed);
+    for (int i=0; i<n; i++) {
+        double p, p_par;
+
+        if ( !(pbdd = create_bdd(BDD_DEFAULT,random_expression(&RANDEXPR_PAR,pb),&_errmsg,0)) )
+            pg_fatal("random_probability_parallel_test: error: %s",_errmsg);
+        if ( (p = bdd_probability(dict,pbdd,NULL,0,&_errmsg)) < 0.0 )
+            pg_fatal("random_probability_parallel_test: error computing prob: %s",_errmsg);
+        for (int t=1; t<=4; t++) {
+            for (int min_level=0; min_level<=1; min_level++) {
+                if ( (p_par = bdd_probability_parallel(dict,pbdd,t,min_level,&_errmsg)) < 0.0 )
+                    pg_fatal("random_probability_parallel_test: error computing prob: %s",_errmsg);
+                if ( p_par != p )
+                    pg_fatal("random_probability_parallel_test:assert: prob=%f parallel(%d)=%f",p,t,p_par);
+            }
+        }
+        FREE(pbdd);
+    }
+    if ( !(pbdd = create_bdd(BDD_DEFAULT,"a=1&z=1",&_errmsg,0)) )
+        pg_fatal("random_probability_parallel_test: error: %s",_errmsg);
+    _errmsg = NULL;
+    if ( (bdd_probability_parallel(dict,pbdd,4,1,&_errmsg) >= 0.0) || !_errmsg || !strstr(_errmsg,"'z=1'") )
+        pg_fatal("random_probability_parallel_test:assert: missing rva not detected");
+    FREE(pbdd);
+    FREE(dict);
+    pbuff_free(pb);
+}
+
+/*
+ * bdd_probability_vector() must give the same results as bdd_probability()
+ * for every bdd, the vector contains duplicates, combinations sharing
+ * sub-bdd's, constants and NULL entries.
+ */
+static void random_probability_vector_test(int n, long seed) {
+    pbuff pb_struct, *pb=pbuff_init(&pb_struct);
+    char  *_errmsg = NULL;
+    bdd_dictionary* dict;
+    bdd   **bdds;
+    double *res;
+    bdd    *missing;
+
+    dict = random_test_dictionary("random_probability_vector_test",RANDEXPR.N_VARS+1,RANDEXPR.N_VALS,NULL,NULL);
+    bdds = (bdd**)MALLOC(n*sizeof(bdd*));
+    res  = (double*)MALLOC(n*sizeof(double));
+    srand(seed);
+    for (int i=0; i<n; i++) {
+        if ( (i%10) == 9 )
+            bdds[i] = NULL;
+        else if ( (i%10) == 8 )
+            bdds[i] = create_bdd(BDD_DEFAULT,(i%20) ? "1" : "0",&_errmsg,0);
+        else if ( ((i%4) == 3) && bdds[i-1] && bdds[i-2] )
+            bdds[i] = bdd_operator((i%8)==3 ? '&' : '|',BY_APPLY,bdds[i-1],bdds[i-2],&_errmsg);
+        else if ( ((i%7) == 6) && bdds[i-3] )
+            bdds[i] = serialize_bdd(bdds[i-3]);
+        else
+            bdds[i] = create_bdd(BDD_DEFAULT,random_expression(&RANDEXPR,pb),&_errmsg,0);
+        if ( ((i%10) != 9) && !bdds[i] )
+            pg_fatal("random_probability_vector_test: error: %s",_errmsg);
+        res[i] = -1.0;
+    }
+    if ( !bdd_probability_vector(dict,bdds,n,res,&_errmsg) )
+        pg_fatal("random_probability_vector_test: error computing prob: %s",_errmsg);
+    for (int i=0; i<n; i++) {
+        double p;
+
+        if ( !bdds[i] ) {
+            if ( res[i] != -1.0 )
+                pg_fatal("random_probability_vector_test:assert: NULL entry %d set",i);
+            continue;
+        }
+        if ( (p = bdd_probability(dict,bdds[i],NULL,0,&_errmsg)) < 0.0 )
+            pg_fatal("random_probability_vector_test: error computing prob: %s",_errmsg);
+        if ( fabs(p-res[i]) > 1e-9 )
+            pg_fatal("random_probability_vector_test:assert: prob[%d] vector=%f scalar=%f",i,res[i],p);
+    }
+    if ( !(missing = create_bdd(BDD_DEFAULT,"(x=1&q=3)",&_errmsg,0)) )
+        pg_fatal("random_probability_vector_test: error: %s",_errmsg);
+    bdds[0] = missing;
+    _errmsg = NULL;
+    if ( bdd_probability_vector(dict,bdds,1,res,&_errmsg) || !_errmsg || !strstr(_errmsg,"'q=3'") )
+        pg_fatal("random_probability_vector_test:assert: missing rva not reported: %s",_errmsg);
+    FREE(missing);
+    for (int i=1; i<n; i++)
+        if ( bdds[i] )
+            FREE(bdds[i]);
+    FREE(bdds);
+    FREE(res);
+    FREE(dict);
+    pbuff_free(pb);
+}
+
+/*
+ * bdd_probability_scenarios() must give for every lane the probability with
+ * that dictionary. The number of scenarios is not a multiple of the lanes.
+ */
+#define N_SCENARIOS 7
+
+static void random_scenarios_test(int n, long seed) {
+    pbuff pb_struct, *pb=pbuff_init(&pb_struct);
+    char  *_errmsg = NULL;
+    bdd_dictionary* dicts[N_SCENARIOS];
+    double res[N_SCENARIOS];
+
+    for (int j=0; j<N_SCENARIOS; j++) {
+        pbuff_reset(pb);
+        for (int v=0; v<=RANDEXPR.N_VARS; v++) {
+            int total = 0;
+            for (int i=0; i<=RANDEXPR.N_VALS; i++)
+                total += (i+j+v)%5+1;
+            for (int i=0; i<=RANDEXPR.N_VALS; i++)
+                bprintf(pb,"%s=%d:%f;",genvar(v),i,(double)((i+j+v)%5+1)/(double)total);
+        }
+        if ( !(dicts[j] = get_test_dictionary(pb->buffer,&_errmsg)) )
+            pg_fatal("random_scenarios_test: error creating dictionary: %s",_errmsg);
+    }
+    srand(seed);
+    for (int i=0; i<n; i++) {
+        bdd *pbdd;
+
+        if ( !(pbdd = create_bdd(BDD_DEFAULT,random_expression(&RANDEXPR,pb),&_errmsg,0)) )
+            pg_fatal("random_scenarios_test: error: %s",_errmsg);
+        if ( !bdd_probability_scenarios(dicts,N_SCENARIOS,pbdd,res,&_errmsg) )
+            pg_fatal("random_scenarios_test: error computing prob: %s",_errmsg);
+        for (int j=0; j<N_SCENARIOS; j++) {
+            double p = bdd_probability(dicts[j],pbdd,NULL,0,&_errmsg);
+
+            if ( p < 0.0 )
+                pg_fatal("random_scenarios_test: error computing prob: %s",_errmsg);
+            if ( fabs(p-res[j]) > 1e-9 )
+                pg_fatal("random_scenarios_test:assert: scenario %d lanes=%f scalar=%f",j,res[j],p);
+        }
+        FREE(pbdd);
+    }
+    // an rva missing in one of the dictionaries fails the whole call
+    {
+        bdd_dictionary* full = dicts[N_SCENARIOS-1];
+        bdd *pbdd;
+
+        pbuff_reset(pb);
+        bprintf(pb,"(%s=1|zz=1)",genvar(0));
+        if ( !(pbdd = create_bdd(BDD_DEFAULT,pb->buffer,&_errmsg,0)) )
+            pg_fatal("random_scenarios_test: error: %s",_errmsg);
+        if ( !(dicts[N_SCENARIOS-1] = get_test_dictionary("zz=1:0.5;zz=2:0.5",&_errmsg)) )
+            pg_fatal("random_scenarios_test: error creating dictionary: %s",_errmsg);
+        if ( bdd_probability_scenarios(dicts,N_SCENARIOS,pbdd,res,&_errmsg) || !_errmsg || !strstr(_errmsg,"zz=1") )
+            pg_fatal("random_scenarios_test:assert: missing rva not reported: %s",(_errmsg ? _errmsg : "NULL"));
+        FREE(_errmsg);
+        _errmsg = NULL;
+        FREE(dicts[N_SCENARIOS-1]);
+        dicts[N_SCENARIOS-1] = full;
+        FREE(pbdd);
+    }
+    for (int j=0; j<N_SCENARIOS; j++)
+        FREE(dicts[j]);
+    pbuff_free(pb);
+}
+
+/*
+ * bdd_probability_gradient() checked against finite differences of the bound
+ * probabilities (the dictionary normalizes, so it can not be used for this).
+ * P is affine in p(rva) so these are exact up to rounding. P(bdd|rva) is
+ * checked against the probability of the bdd restricted with evidence rva.
+ */
+static void random_gradient_test(int n, long seed) {
+    pbuff pb_struct, *pb=pbuff_init(&pb_struct);
+    char  *_errmsg = NULL;
+    bdd_dictionary* dict;
+    double delta = 0.01;
+
+    dict = random_test_dictionary("random_gradient_test",RANDEXPR.N_VARS+1,RANDEXPR.N_VALS,NULL,NULL);
+    srand(seed);
+    for (int i=0; i<n; i++) {
+        bdd             *pbdd;
+        bdd_sensitivity *sens;
+        int              n_sens;
+        double           P, *prob;
+        prob_sr         *sr;
+
+        if ( !(pbdd = create_bdd(BDD_DEFAULT,random_expression(&RANDEXPR,pb),&_errmsg,0)) )
+            pg_fatal("random_gradient_test: error: %s",_errmsg);
+        if ( !(sens = bdd_probability_gradient(dict,pbdd,&n_sens,&P,&_errmsg)) )
+            pg_fatal("random_gradient_test: error computing gradient: %s",_errmsg);
+        sr   = (prob_sr*)MALLOC(BDD_TREESIZE(pbdd)*(sizeof(prob_sr)+sizeof(double)));
+        prob = (double*)&sr[BDD_TREESIZE(pbdd)];
+        for (int s=0; s<n_sens; s++) {
+            char   evidence[MAX_RVA_NAME+16], *ev = evidence;
+            double P_d, P_cond;
+            bdd   *restricted;
+
+            if ( !bdd_bind_probabilities(dict,pbdd,prob,&_errmsg) )
+                pg_fatal("random_gradient_test: error: %s",_errmsg);
+            for (nodei k=0; k<BDD_TREESIZE(pbdd); k++)
+                if ( !IS_LEAF_I(pbdd,k) && (cmpRva(BDD_RVA(pbdd,k),&sens[s].rva) == 0) )
+                    prob[k] -= delta;
+            if ( (P_d = bdd_probability_pass(pbdd,prob,sr,NULL,0,&_errmsg)) < 0.0 )
+                pg_fatal("random_gradient_test: error computing prob: %s",_errmsg);
+            if ( fabs((P-P_d)/delta - sens[s].derivative) > 1e-6 )
+                pg_fatal("random_gradient_test:assert: %s=%d derivative=%f difference=%f",sens[s].rva.var,sens[s].rva.val,sens[s].derivative,(P-P_d)/delta);
+            sprintf(evidence,"%s=%d",sens[s].rva.var,sens[s].rva.val);
+            if ( !(restricted = bdd_restrict_evidence(pbdd,&ev,1,0,&_errmsg)) )
+                pg_fatal("random_gradient_test: error: %s",_errmsg);
+            if ( (P_cond = bdd_probability(dict,restricted,NULL,0,&_errmsg)) < 0.0 )
+                pg_fatal("random_gradient_test: error computing prob: %s",_errmsg);
+            if ( fabs(P_cond - sens[s].cond) > 1e-9 )
+                pg_fatal("random_gradient_test:assert: %s=%d cond=%f restricted=%f",sens[s].rva.var,sens[s].rva.val,sens[s].cond,P_cond);
+            if ( (sens[s].prob < 1.0) &&
+                 (fabs(sens[s].banzhaf - (P_cond - (P - sens[s].prob*P_cond)/(1.0-sens[s].prob))) > 1e-9) )
+                pg_fatal("random_gradient_test:assert: %s=%d banzhaf=%f",sens[s].rva.var,sens[s].rva.val,sens[s].banzhaf);
+            FREE(restricted);
+        }
+        FREE(sr);
+        FREE(sens);
+        FREE(pbdd);
+    }
+    FREE(dict);
+    pbuff_free(pb);
+}
+
+/*
+ * Evaluate the bdd in a world, world must assign all vars of the support.
+ */
+static int eval_world(bdd* pbdd, V_rva* world) {
+    nodei i = BDD_ROOT(pbdd);
+
+    while ( !IS_LEAF_I(pbdd,i) ) {
+        rva_node* node = BDD_NODE(pbdd,i);
+        int w;
+
+        for (w=0; w<world->size; w++)
+            if ( IS_SAMEVAR(&world->items[w],&node->rva) )
+                break;
+        if ( w == world->size )
+            pg_fatal("eval_world: var %s not in world",node->rva.var);
+        i = (world->items[w].val == node->rva.val) ? node->high : node->low;
+    }
+    return LEAF_BOOLVALUE(BDD_NODE(pbdd,i));
+}
+
+static int cmpDoubleDesc(const void* l, const void* r) {
+    double ld = *(const double*)l, rd = *(const double*)r;
+
+    return (ld > rd) ? -1 : ((ld < rd) ? 1 : 0);
+}
+
+/*
+ * The k best worlds of the bdd_topk dp checked against enumeration of all
+ * worlds over the support of the bdd. With a large k the worlds sum up to
+ * the probability of the bdd. The max-product pass gives the best world.
+ */
+#define TOPK_K 5
+
+static void random_topk_test(int n, long seed) {
+    pbuff pb_struct, *pb=pbuff_init(&pb_struct);
+    char  *_errmsg = NULL;
+    bdd_dictionary* dict;
+    V_rva support, world;
+    double *brute = (double*)MALLOC(10000*sizeof(double));
+
+    dict = random_test_dictionary("random_topk_test",RANDEXPR.N_VARS+1,RANDEXPR.N_VALS,&(test_weights){7,3,11,50.0},NULL);
+    V_rva_init(&support);
+    V_rva_init(&world);
+    srand(seed);
+    for (int i=0; i<n; i++) {
+        bdd      *pbdd;
+        bdd_topk *tk;
+        int       n_brute = 0, n_world = 1;
+        double    P, mpe, total = 0.0;
+
+        if ( !(pbdd = create_bdd(BDD_DEFAULT,random_expression(&RANDEXPR,pb),&_errmsg,0)) )
+            pg_fatal("random_topk_test: error: %s",_errmsg);
+        if ( !bdd_support(pbdd,&support,&_errmsg) )
+            pg_fatal("random_topk_test: error: %s",_errmsg);
+        for (int v=0; v<support.size; v++)
+            n_world *= (RANDEXPR.N_VALS+1);
+        for (int w=0; w<n_world; w++) {
+            double prob = 1.0;
+            int    code = w;
+
+            V_rva_reset(&world);
+            for (int v=0; v<support.size; v++) {
+                rva a = support.items[v];
+
+                a.val = code % (RANDEXPR.N_VALS+1);
+                code /= (RANDEXPR.N_VALS+1);
+                prob *= lookup_probability(dict,&a);
+                V_rva_add(&world,&a);
+            }
+            if ( eval_world(pbdd,&world) )
+                brute[n_brute++] = prob;
+        }
+        qsort(brute,n_brute,sizeof(double),cmpDoubleDesc);
+        if ( !(tk = bdd_topk_create(dict,pbdd,TOPK_K,&_errmsg)) )
+            pg_fatal("random_topk_test: error: %s",_errmsg);
+        if ( bdd_topk_count(tk) != ((n_brute < TOPK_K) ? n_brute : TOPK_K) )
+            pg_fatal("random_topk_test:assert: count=%d brute=%d",bdd_topk_count(tk),n_brute);
+        for (int r=0; r<bdd_topk_count(tk); r++) {
+            double prob = bdd_topk_world(tk,r,&world,&_errmsg), check = 1.0;
+
+            if ( prob < 0.0 )
+                pg_fatal("random_topk_test: error: %s",_errmsg);
+            if ( fabs(prob - brute[r]) > 1e-12 )
+                pg_fatal("random_topk_test:assert: rank %d prob=%f brute=%f",r,prob,brute[r]);
+            if ( !eval_world(pbdd,&world) )
+                pg_fatal("random_topk_test:assert: rank %d world is not a model",r);
+            for (int v=0; v<world.size; v++)
+                check *= lookup_probability(dict,&world.items[v]);
+            if ( fabs(prob - check) > 1e-12 )
+                pg_fatal("random_topk_test:assert: rank %d prob=%f world=%f",r,prob,check);
+        }
+        if ( (mpe = bdd_probability_mpe(dict,pbdd,&_errmsg)) < 0.0 )
+            pg_fatal("random_topk_test: error: %s",_errmsg);
+        if ( fabs(mpe - (n_brute ? brute[0] : 0.0)) > 1e-12 )
+            pg_fatal("random_topk_test:assert: mpe=%f brute=%f",mpe,(n_brute ? brute[0] : 0.0));
+        bdd_topk_free(tk);
+        if ( !(tk = bdd_topk_create(dict,pbdd,n_world,&_errmsg)) )
+            pg_fatal("random_topk_test: error: %s",_errmsg);
+        for (int r=0; r<bdd_topk_count(tk); r++)
+            total += bdd_topk_world(tk,r,&world,&_errmsg);
+        if ( (P = bdd_probability(dict,pbdd,NULL,0,&_errmsg)) < 0.0 )
+            pg_fatal("random_topk_test: error computing prob: %s",_errmsg);
+        if ( fabs(P - total) > 1e-9 )
+            pg_fatal("random_topk_test:assert: sum of worlds=%f prob=%f",total,P);
+        bdd_topk_free(tk);
+        FREE(pbdd);
+    }
+    V_rva_free(&support);
+    V_rva_free(&world);
+    FREE(brute);
+    FREE(dict);
+    pbuff_free(pb);
+}
+
+/*
+ * bdd_count_worlds() checked against enumeration of the worlds over the
+ * support, with the domains of the dictionary and with the values in the
+ * bdd plus one other value. The paths of bdd_paths are disjoint and their
+ * probabilities sum up to the probability of the bdd.
+ */
+#define COUNT_MAX_DOM 16
+
+static void random_count_worlds_test(int n, long seed) {
+    pbuff pb_struct, *pb=pbuff_init(&pb_struct);
+    pbuff path_struct, *path=pbuff_init(&path_struct);
+    char  *_errmsg = NULL;
+    bdd_dictionary* dict;
+    V_rva support, world;
+
+    dict = random_test_dictionary("random_count_worlds_test",RANDEXPR.N_VARS+1,RANDEXPR.N_VALS,&(test_weights){3,5,7,20.0},NULL);
+    V_rva_init(&support);
+    V_rva_init(&world);
+    srand(seed);
+    for (int i=0; i<n; i++) {
+        bdd       *pbdd, *pbdd_path;
+        bdd_paths *paths;
+        int        dom[COUNT_MAX_DOM][COUNT_MAX_DOM], n_dom[COUNT_MAX_DOM];
+        int64_t    n_dict = 0, n_other = 0, n_world;
+        double     P, total = 0.0;
+
+        if ( !(pbdd = create_bdd(BDD_DEFAULT,random_expression(&RANDEXPR,pb),&_errmsg,0)) )
+            pg_fatal("random_count_worlds_test: error: %s",_errmsg);
+        if ( !bdd_support(pbdd,&support,&_errmsg) )
+            pg_fatal("random_count_worlds_test: error: %s",_errmsg);
+        // the dictionary domains
+        n_world = 1;
+        for (int v=0; v<support.size; v++) {
+            n_world *= (RANDEXPR.N_VALS+1);
+            n_dom[v] = 0;
+            for (int u=0; u<=RANDEXPR.N_VALS; u++)
+                dom[v][n_dom[v]++] = u;
+        }
+        for (int w=0; w<n_world; w++) {
+            int code = w;
+
+            V_rva_reset(&world);
+            for (int v=0; v<support.size; v++) {
+                rva a = support.items[v];
+
+                a.val = dom[v][code % n_dom[v]];
+                code /= n_dom[v];
+                V_rva_add(&world,&a);
+            }
+            n_dict += eval_world(pbdd,&world);
+        }
+        // the values in the bdd and the other value N_VALS+1
+        n_world = 1;
+        for (int v=0; v<support.size; v++) {
+            n_dom[v] = 0;
+            for (int u=0; u<=RANDEXPR.N_VALS+1; u++) {
+                rva a = support.items[v];
+
+                a.val = u;
+                if ( (u > RANDEXPR.N_VALS) || (bdd_contains(pbdd,a.var,a.val,&_errmsg) == 1) )
+                    dom[v][n_dom[v]++] = u;
+            }
+            n_world *= n_dom[v];
+        }
+        for (int w=0; w<n_world; w++) {
+            int code = w;
+
+            V_rva_reset(&world);
+            for (int v=0; v<support.size; v++) {
+                rva a = support.items[v];
+
+                a.val = dom[v][code % n_dom[v]];
+                code /= n_dom[v];
+                V_rva_add(&world,&a);
+            }
+            n_other += eval_world(pbdd,&world);
+        }
+        if ( bdd_count_worlds(dict,pbdd,&_errmsg) != n_dict )
+            pg_fatal("random_count_worlds_test:assert: dictionary count=%ld brute=%ld",(long)bdd_count_worlds(dict,pbdd,&_errmsg),(long)n_dict);
+        if ( bdd_count_worlds(NULL,pbdd,&_errmsg) != n_other )
+            pg_fatal("random_count_worlds_test:assert: count=%ld brute=%ld",(long)bdd_count_worlds(NULL,pbdd,&_errmsg),(long)n_other);
+        if ( !(paths = bdd_paths_create(pbdd,&_errmsg)) )
+            pg_fatal("random_count_worlds_test: error: %s",_errmsg);
+        pbuff_flush(path,NULL);
+        while ( bdd_paths_next(paths,path) ) {
+            if ( !(pbdd_path = create_bdd(BDD_DEFAULT,path->buffer,&_errmsg,0)) )
+                pg_fatal("random_count_worlds_test: error: %s",_errmsg);
+            total += bdd_probability(dict,pbdd_path,NULL,0,&_errmsg);
+            FREE(pbdd_path);
+            pbuff_flush(path,NULL);
+        }
+        if ( bdd_paths_next(paths,path) )
+            pg_fatal("random_count_worlds_test:assert: path after the last path");
+        bdd_paths_free(paths);
+        if ( (P = bdd_probability(dict,pbdd,NULL,0,&_errmsg)) < 0.0 )
+            pg_fatal("random_count_worlds_test: error computing prob: %s",_errmsg);
+        if ( fabs(P - total) > 1e-9 )
+            pg_fatal("random_count_worlds_test:assert: sum of paths=%f prob=%f",total,P);
+        FREE(pbdd);
+    }
+    // with 100 values per var w0=1|..|wN=1 is true in 100^(N+1)-99^(N+1) worlds
+    FREE(dict);
+    pbuff_flush(pb,NULL);
+    for (int v=0; v<10; v++)
+        for (int u=0; u<100; u++)
+            bprintf(pb,"w%d=%d:0.01;",v,u);
+    if ( !(dict = get_test_dictionary(pb->buffer,&_errmsg)) )
+        pg_fatal("random_count_worlds_test: error creating dictionary: %s",_errmsg);
+    for (int n_vars=9; n_vars<=10; n_vars++) {
+        bdd    *pbdd;
+        int64_t count;
+
+        pbuff_flush(pb,NULL);
+        for (int v=0; v<n_vars; v++)
+            bprintf(pb,"%sw%d=1",(v ? "|" : ""),v);
+        if ( !(pbdd = create_bdd(BDD_DEFAULT,pb->buffer,&_errmsg,0)) )
+            pg_fatal("random_count_worlds_test: error: %s",_errmsg);
+        _errmsg = NULL;
+        count   = bdd_count_worlds(dict,pbdd,&_errmsg);
+        if ( (n_vars == 9) && (count != 86482752516359101L) )
+            pg_fatal("random_count_worlds_test:assert: count=%ld",(long)count);
+        if ( (n_vars == 10) && ((count >= 0) || !_errmsg) ) // 9561792499119550999
+            pg_fatal("random_count_worlds_test:assert: overflow not detected");
+        FREE(pbdd);
+    }
+    V_rva_free(&support);
+    V_rva_free(&world);
+    FREE(dict);
+    pbuff_free(path);
+    pbuff_free(pb);
+}
+
+/*
+ * bdd_probability_approx*() checked against the exact probability. Random
+ * expressions are mostly not DNF and use the bdd estimator, the generated
+ * DNF expressions use Karp-Luby. With delta=0.001 the exact probability must
+ * be in the confidence interval, the estimates are deterministic.
+ */
+static void check_estimate(char* expr, bdd_estimate* est, double P, double epsilon, int max_samples) {
+    if ( (P < est->lower-1e-9) || (P > est->upper+1e-9) )
+        pg_fatal("random_approx_test:assert: %s: P=%f not in [%f,%f] (%s)",expr,P,est->lower,est->upper,est->method);
+    if ( (est->samples > 0) && (est->samples < max_samples) && (fabs(est->prob-P) > epsilon) )
+        pg_fatal("random_approx_test:assert: %s: P=%f estimate=%f (%s)",expr,P,est->prob,est->method);
+    if ( est->samples > max_samples )
+        pg_fatal("random_approx_test:assert: %s: samples=%d > %d",expr,est->samples,max_samples);
+}
+
+static void random_approx_test(int n, long seed) {
+    pbuff pb_struct, *pb=pbuff_init(&pb_struct);
+    char  *_errmsg = NULL;
+    bdd_dictionary* dict;
+    dict_sampler*   ds;
+    double epsilon = 0.02, delta = 0.001;
+    int    n_kl = 0;
+
+    dict = random_test_dictionary("random_approx_test",RANDEXPR.N_VARS+1,RANDEXPR.N_VALS,&(test_weights){3,1,7,20.0},NULL);
+    if ( !(ds = dictionary_sampler(dict,&_errmsg)) )
+        pg_fatal("random_approx_test: error: %s",_errmsg);
+    srand(seed);
+    for (int i=0; i<n; i++) {
+        bdd          *pbdd;
+        bdd_estimate  est;
+        double        P;
+        int           max_samples = (i%4) ? 1000000 : 500;
+
+        pbuff_reset(pb);
+        if ( i%2 ) {
+            random_expression(&RANDEXPR,pb);
+        } else { // DNF
+            int n_clause = randInRange(1,6);
+
+            for (int c=0; c<n_clause; c++) {
+                int n_lit = randInRange(1,3);
+
+                bprintf(pb,"%s(",(c ? "|" : ""));
+                for (int l=0; l<n_lit; l++)
+                    bprintf(pb,"%s%s=%d",(l ? "&" : ""),rand_var(&RANDEXPR),rand_val(&RANDEXPR));
+                bprintf(pb,")");
+            }
+        }
+        if ( !(pbdd = create_bdd(BDD_DEFAULT,pb->buffer,&_errmsg,0)) )
+            pg_fatal("random_approx_test: error: %s",_errmsg);
+        if ( (P = bdd_probability(dict,pbdd,NULL,0,&_errmsg)) < 0.0 )
+            pg_fatal("random_approx_test: error computing prob: %s",_errmsg);
+        if ( !bdd_probability_approx(ds,pbdd,epsilon,delta,max_samples,0,&est,&_errmsg) )
+            pg_fatal("random_approx_test: error: %s",_errmsg);
+        check_estimate(pb->buffer,&est,P,epsilon,max_samples);
+        if ( !bdd_probability_approx_expr(ds,pb->buffer,epsilon,delta,max_samples,0,&est,&_errmsg) )
+            pg_fatal("random_approx_test: error: %s",_errmsg);
+        check_estimate(pb->buffer,&est,P,epsilon,max_samples);
+        if ( !(i%2) && (strcmp(est.method,"karp-luby") == 0) ) {
+            if ( (est.samples < max_samples) && (fabs(est.prob-P) > epsilon*P) )
+                pg_fatal("random_approx_test:assert: %s: P=%f karp-luby=%f not relative",pb->buffer,P,est.prob);
+            n_kl++;
+        }
+        FREE(pbdd);
+    }
+    if ( n_kl == 0 )
+        pg_fatal("random_approx_test:assert: no karp-luby estimates");
+    if ( (approx_samples(1e-5,delta,0) != INT_MAX) || (approx_samples(1e-5,delta,1000) != 1000) )
+        pg_fatal("random_approx_test:assert: number of samples not clamped");
+    dict_sampler_free(ds);
+    FREE(dict);
+    pbuff_free(pb);
+}
+
+/*
+ * The bit counting of the sample masks checked against a loop over the bits.
+ */
+static void bitcount_test(int n, long seed) {
+    bdd_rng rng;
+
+    bdd_rng_seed(&rng,(uint64_t)seed);
+    for (int i=0; i<n; i++) {
+        uint64_t x = bdd_rng_next(&rng) >> (i%64);
+        int      count = 0, first = -1;
+
+        for (int k=0; k<64; k++)
+            if ( (x >> k) & 1 ) {
+                count++;
+                if ( first < 0 ) first = k;
+            }
+        if ( bdd_popcount64(x) != count )
+            pg_fatal("bitcount_test:assert: popcount(%lx)=%d, expected %d",(unsigned long)x,bdd_popcount64(x),count);
+        if ( x && (bdd_rightmost_one64(x) != first) )
+            pg_fatal("bitcount_test:assert: rightmost_one(%lx)=%d, expected %d",(unsigned long)x,bdd_rightmost_one64(x),first);
+    }
+}
+
+/*
+ * bdd_sample_eval() checked against eval_world() in the sampled worlds, the
+ * worlds are the same for every bdd so the samples of a&b are the samples of
+ * a and of b. The fraction of true worlds estimates the probability.
+ */
+#define SAMPLE_N     (64*8+13)
+#define SAMPLE_BLOCK ((SAMPLE_N+63)/64)
+#define SAMPLE_MAX_DOM 16
+
+static void random_sample_eval_test(int n, long seed) {
+    pbuff pb_struct, *pb=pbuff_init(&pb_struct);
+    pbuff ab_struct, *ab=pbuff_init(&ab_struct);
+    char  *_errmsg = NULL;
+    bdd_dictionary* dict;
+    dict_sampler*   ds;
+    V_rva support, world;
+
+    dict = random_test_dictionary("random_sample_eval_test",RANDEXPR.N_VARS+1,RANDEXPR.N_VALS,&(test_weights){5,1,7,20.0},NULL);
+    if ( !(ds = dictionary_sampler(dict,&_errmsg)) )
+        pg_fatal("random_sample_eval_test: error: %s",_errmsg);
+    V_rva_init(&support);
+    V_rva_init(&world);
+    srand(seed);
+    for (int i=0; i<n; i++) {
+        bdd      *a, *b, *a_b;
+        uint64_t  ra[SAMPLE_BLOCK], rb[SAMPLE_BLOCK], rab[SAMPLE_BLOCK], again[SAMPLE_BLOCK];
+        uint64_t  s_seed = (uint64_t)i * 7919;
+        double    P;
+        int       count;
+
+        pbuff_reset(ab);
+        bprintf(ab,"(%s)",random_expression(&RANDEXPR,pb));
+        if ( !(a = create_bdd(BDD_DEFAULT,pb->buffer,&_errmsg,0)) )
+            pg_fatal("random_sample_eval_test: error: %s",_errmsg);
+        bprintf(ab,"&(%s)",random_expression(&RANDEXPR,pb));
+        if ( !(b = create_bdd(BDD_DEFAULT,pb->buffer,&_errmsg,0)) )
+            pg_fatal("random_sample_eval_test: error: %s",_errmsg);
+        if ( !(a_b = create_bdd(BDD_DEFAULT,ab->buffer,&_errmsg,0)) )
+            pg_fatal("random_sample_eval_test: error: %s",_errmsg);
+        if ( !bdd_sample_eval(ds,a,SAMPLE_N,s_seed,ra,&_errmsg) ||
+             !bdd_sample_eval(ds,b,SAMPLE_N,s_seed,rb,&_errmsg) ||
+             !bdd_sample_eval(ds,a_b,SAMPLE_N,s_seed,rab,&_errmsg) ||
+             !bdd_sample_eval(ds,a,SAMPLE_N,s_seed,again,&_errmsg) )
+            pg_fatal("random_sample_eval_test: error: %s",_errmsg);
+        if ( memcmp(ra,again,sizeof(ra)) != 0 )
+            pg_fatal("random_sample_eval_test:assert: same seed, other samples");
+        { // the draws kept in ds are the worlds of a fresh sampler, also for less blocks
+            dict_sampler* fresh;
+            uint64_t      r_fresh[SAMPLE_BLOCK], r_short[1];
+
+            if ( !(fresh = dictionary_sampler(dict,&_errmsg)) ||
+                 !bdd_sample_eval(fresh,a,SAMPLE_N,s_seed,r_fresh,&_errmsg) ||
+                 !bdd_sample_eval(ds,a,64,s_seed,r_short,&_errmsg) )
+                pg_fatal("random_sample_eval_test: error: %s",_errmsg);
+            if ( (memcmp(ra,r_fresh,sizeof(ra)) != 0) || (r_short[0] != ra[0]) || (!IS_LEAF_I(a,BDD_ROOT(a)) && (ds->draw_seed != s_seed)) )
+                pg_fatal("random_sample_eval_test:assert: kept draws differ from a fresh sampler");
+            dict_sampler_free(fresh);
+        }
+        for (int blk=0; blk<SAMPLE_BLOCK; blk++)
+            if ( rab[blk] != (ra[blk] & rb[blk]) )
+                pg_fatal("random_sample_eval_test:assert: block %d of %s",blk,ab->buffer);
+        if ( ra[SAMPLE_BLOCK-1] >> (SAMPLE_N % 64) )
+            pg_fatal("random_sample_eval_test:assert: bits after n_samples");
+        // the worlds of the first two blocks
+        if ( !bdd_support(a,&support,&_errmsg) )
+            pg_fatal("random_sample_eval_test: error: %s",_errmsg);
+        for (int blk=0; blk<2; blk++) {
+            uint64_t vmask[SAMPLE_MAX_DOM][SAMPLE_MAX_DOM];
+            dict_val* vals[SAMPLE_MAX_DOM];
+            int       card[SAMPLE_MAX_DOM];
+
+            for (int v=0; v<support.size; v++) {
+                double* cum = dict_sampler_lookup(ds,support.items[v].var,&card[v],&vals[v]);
+
+                sample_block(cum,card[v],support.items[v].var,s_seed,blk,vmask[v]);
+            }
+            for (int k=0; k<64; k++) {
+                V_rva_reset(&world);
+                for (int v=0; v<support.size; v++) {
+                    rva a_v = support.items[v];
+
+                    for (int u=0; u<card[v]; u++)
+                        if ( (vmask[v][u] >> k) & 1 )
+                            a_v.val = vals[v][u].value;
+                    V_rva_add(&world,&a_v);
+                }
+                if ( eval_world(a,&world) != (int)((ra[blk] >> k) & 1) )
+                    pg_fatal("random_sample_eval_test:assert: world %d of %s",blk*64+k,ab->buffer);
+            }
+        }
+        if ( (P = bdd_probability(dict,a,NULL,0,&_errmsg)) < 0.0 )
+            pg_fatal("random_sample_eval_test: error computing prob: %s",_errmsg);
+        if ( (count = bdd_sample_count(ds,a,64000,s_seed,&_errmsg)) < 0 )
+            pg_fatal("random_sample_eval_test: error: %s",_errmsg);
+        if ( fabs((double)count/64000.0 - P) > 0.02 )
+            pg_fatal("random_sample_eval_test:assert: %d of 64000 samples, prob=%f",count,P);
+        FREE(a);
+        FREE(b);
+        FREE(a_b);
+    }
+    {
+        bdd *pbdd;
+        uint64_t r[1];
+
+        if ( !(pbdd = create_bdd(BDD_DEFAULT,"a=1&z=1",&_errmsg,0)) )
+            pg_fatal("random_sample_eval_test: error: %s",_errmsg);
+        _errmsg = NULL;
+        if ( bdd_sample_eval(ds,pbdd,64,0,r,&_errmsg) || !_errmsg )
+            pg_fatal("random_sample_eval_test:assert: missing var not detected");
+        FREE(pbdd);
+    }
+    V_rva_free(&support);
+    V_rva_free(&world);
+    dict_sampler_free(ds);
+    FREE(dict);
+    pbuff_free(ab);
+    pbuff_free(pb);
+}
+
+/*
+ * bdd_probability_cond() checked against the probability of the applied
+ * bdd a&b and of b.
+ */
+static void random_cond_test(int n, long seed) {
+    pbuff pb_struct, *pb=pbuff_init(&pb_struct);
+    char  *_errmsg = NULL;
+    bdd_dictionary* dict;
+    bdd   *a = NULL, *b = NULL;
+
+    dict = random_test_dictionary("random_cond_test",RANDEXPR.N_VARS+1,RANDEXPR.N_VALS,&(test_weights){5,1,9,30.0},NULL);
+    srand(seed);
+    for (int i=0; i<n; i++) {
+        bdd    *ab;
+        double  p_ab, p_b, P_ab, P_b;
+
+        if ( a ) FREE(a);
+        a = b;
+        if ( !(b = create_bdd(BDD_DEFAULT,random_expression(&RANDEXPR,pb),&_errmsg,0)) )
+            pg_fatal("random_cond_test: error: %s",_errmsg);
+        if ( !a )
+            continue;
+        if ( !bdd_probability_cond(dict,a,b,&p_ab,&p_b,&_errmsg) )
+            pg_fatal("random_cond_test: error: %s",_errmsg);
+        if ( !(ab = bdd_apply('&',a,b,0,&_errmsg)) )
+            pg_fatal("random_cond_test: error: %s",_errmsg);
+        if ( (P_ab = bdd_probability(dict,ab,NULL,0,&_errmsg)) < 0.0 )
+            pg_fatal("random_cond_test: error computing prob: %s",_errmsg);
+        if ( (P_b = bdd_probability(dict,b,NULL,0,&_errmsg)) < 0.0 )
+            pg_fatal("random_cond_test: error computing prob: %s",_errmsg);
+        if ( fabs(p_ab-P_ab) > 1e-9 )
+            pg_fatal("random_cond_test:assert: P(a&b)=%f walk=%f",P_ab,p_ab);
+        if ( fabs(p_b-P_b) > 1e-9 )
+            pg_fatal("random_cond_test:assert: P(b)=%f walk=%f",P_b,p_b);
+        FREE(ab);
+    }
+    if ( a ) FREE(a);
+    if ( b ) FREE(b);
+    FREE(dict);
+    pbuff_free(pb);
+}
+
+/*
+ * bdd_count_distribution() checked against enumeration of all worlds. The
+ * bdd's over x and y are independent of the random ones, which share their
+ * vars, so both the convolution and the exact component code are used.
+ */
+#define COUNT_N 6
+
+static void random_count_test(int n, long seed) {
+    pbuff pb_struct, *pb=pbuff_init(&pb_struct);
+    char  *_errmsg = NULL;
+    bdd_dictionary* dict;
+    V_rva  support, world, s;
+    bdd   *bdds[COUNT_N+2];
+    double brute[COUNT_N+3];
+
+    dict = random_test_dictionary("random_count_test",RANDEXPR.N_VARS+1,RANDEXPR.N_VALS,&(test_weights){5,1,9,30.0},"x=1:0.3; x=2:0.7; y=1:0.6; y=2:0.4;");
+    V_rva_init(&support);
+    V_rva_init(&world);
+    V_rva_init(&s);
+    srand(seed);
+    for (int i=0; i<n; i++) {
+        double *dist;
+        int     n_world = 1;
+
+        for (int b=0; b<COUNT_N; b++)
+            if ( !(bdds[b] = create_bdd(BDD_DEFAULT,random_expression(&RANDEXPR,pb),&_errmsg,0)) )
+                pg_fatal("random_count_test: error: %s",_errmsg);
+        bdds[COUNT_N]   = create_bdd(BDD_DEFAULT,(i%2) ? "x=1" : "x=2|y=1",&_errmsg,0);
+        bdds[COUNT_N+1] = (i%3) ? create_bdd(BDD_DEFAULT,"y=2",&_errmsg,0) : NULL;
+        V_rva_reset(&support);
+        for (int b=0; b<COUNT_N+2; b++) {
+            if ( !bdds[b] )
+                continue;
+            bdd_support(bdds[b],&s,&_errmsg);
+            for (int v=0; v<s.size; v++)
+                if ( V_rva_find(&support,cmpRva,&s.items[v]) < 0 )
+                    V_rva_add(&support,&s.items[v]);
+        }
+        for (int v=0; v<support.size; v++) {
+            int card;
+
+            if ( !lookup_var_values(dict,support.items[v].var,&card) )
+                pg_fatal("random_count_test: var %s not found",support.items[v].var);
+            n_world *= card;
+        }
+        for (int k=0; k<=COUNT_N+2; k++)
+            brute[k] = 0.0;
+        for (int w=0; w<n_world; w++) {
+            double prob = 1.0;
+            int    code = w, count = 0;
+
+            V_rva_reset(&world);
+            for (int v=0; v<support.size; v++) {
+                int       card;
+                dict_val* vals = lookup_var_values(dict,support.items[v].var,&card);
+                rva       a    = support.items[v];
+
+                a.val = vals[code % card].value;
+                prob *= vals[code % card].prob;
+                code /= card;
+                V_rva_add(&world,&a);
+            }
+            for (int b=0; b<COUNT_N+2; b++)
+                if ( bdds[b] && eval_world(bdds[b],&world) )
+                    count++;
+            brute[count] += prob;
+        }
+        if ( !(dist = bdd_count_distribution(dict,bdds,COUNT_N+2,&_errmsg)) )
+            pg_fatal("random_count_test: error: %s",_errmsg);
+        for (int k=0; k<=COUNT_N+2; k++)
+            if ( fabs(dist[k]-brute[k]) > 1e-9 )
+                pg_fatal("random_count_test:assert: P(count=%d)=%f brute=%f",k,dist[k],brute[k]);
+        FREE(dist);
+        for (int b=0; b<COUNT_N+2; b++)
+            if ( bdds[b] )
+                FREE(bdds[b]);
+    }
+    V_rva_free(&support);
+    V_rva_free(&world);
+    V_rva_free(&s);
+    FREE(dict);
+    pbuff_free(pb);
+}
+
+/*
+ * bdd_probability_exceeds() checked against the exact probability for
+ * thresholds near the probability and random thresholds.
+ */
+static void random_exceeds_test(int n, long seed) {
+    pbuff pb_struct, *pb=pbuff_init(&pb_struct);
+    char  *_errmsg = NULL;
+    bdd_dictionary* dict;
+
+    dict = random_test_dictionary("random_exceeds_test",RANDEXPR.N_VARS+1,RANDEXPR.N_VALS,&(test_weights){5,1,9,30.0},NULL);
+    srand(seed);
+    for (int i=0; i<n; i++) {
+        bdd    *pbdd;
+        double  P, t[6];
+
+        if ( !(pbdd = create_bdd(BDD_DEFAULT,random_expression(&RANDEXPR,pb),&_errmsg,0)) )
+            pg_fatal("random_exceeds_test: error: %s",_errmsg);
+        if ( (P = bdd_probability(dict,pbdd,NULL,0,&_errmsg)) < 0.0 )
+            pg_fatal("random_exceeds_test: error computing prob: %s",_errmsg);
+        t[0] = P - 0.01;
+        t[1] = P + 0.01;
+        t[2] = P - 1e-6;
+        t[3] = P + 1e-6;
+        t[4] = (double)rand()/(double)RAND_MAX;
+        t[5] = (i%2) ? -0.5 : 1.5;
+        for (int j=0; j<6; j++) {
+            for (int strict=0; strict<=1; strict++) {
+                int res = bdd_probability_exceeds(dict,pbdd,t[j],strict,&_errmsg);
+
+                if ( res < 0 )
+                    pg_fatal("random_exceeds_test: error: %s",_errmsg);
+                if ( res != (strict ? (P > t[j]) : (P >= t[j])) )
+                    pg_fatal("random_exceeds_test:assert: P=%f t=%f strict=%d res=%d",P,t[j],strict,res);
+            }
+        }
+        FREE(pbdd);
+    }
+    FREE(dict);
+    pbuff_free(pb);
+}
+
+/*
+ * The bdd_prob_heap top-k checked against sorting all probabilities. Most
+ * bdd's should be pruned by the bounds without computing the probability.
+ */
+#define TOPK_PROB_N 500
+#define TOPK_PROB_K 10
+
+static void random_topk_prob_test(int n, long seed) {
+    pbuff pb_struct, *pb=pbuff_init(&pb_struct);
+    char  *_errmsg = NULL;
+    bdd_dictionary* dict;
+    double all[TOPK_PROB_N], slot_prob[TOPK_PROB_K], probs[TOPK_PROB_K];
+    int    slots[TOPK_PROB_K];
+
+    dict = random_test_dictionary("random_topk_prob_test",RANDEXPR.N_VARS+1,RANDEXPR.N_VALS,&(test_weights){5,1,9,30.0},NULL);
+    srand(seed);
+    for (int i=0; i<n; i++) {
+        bdd_prob_heap *h;
+        int            n_res;
+
+        if ( !(h = bdd_prob_heap_create(TOPK_PROB_K,&_errmsg)) )
+            pg_fatal("random_topk_prob_test: error: %s",_errmsg);
+        for (int j=0; j<TOPK_PROB_N; j++) {
+            bdd *pbdd;
+            int  slot;
+
+            if ( !(pbdd = create_bdd(BDD_DEFAULT,random_expression(&RANDEXPR,pb),&_errmsg,0)) )
+                pg_fatal("random_topk_prob_test: error: %s",_errmsg);
+            if ( (all[j] = bdd_probability(dict,pbdd,NULL,0,&_errmsg)) < 0.0 )
+                pg_fatal("random_topk_prob_test: error computing prob: %s",_errmsg);
+            if ( (slot = bdd_prob_heap_offer(h,dict,pbdd,&_errmsg)) < -1 )
+                pg_fatal("random_topk_prob_test: error: %s",_errmsg);
+            if ( slot >= 0 )
+                slot_prob[slot] = all[j]; // the payload
+            FREE(pbdd);
+        }
+        if ( h->pruned < TOPK_PROB_N/2 )
+            pg_fatal("random_topk_prob_test:assert: only %ld of %d pruned",h->pruned,TOPK_PROB_N);
+        n_res = bdd_prob_heap_sorted(h,slots,probs);
+        qsort(all,TOPK_PROB_N,sizeof(double),cmpDoubleDesc);
+        if ( n_res != TOPK_PROB_K )
+            pg_fatal("random_topk_prob_test:assert: %d results",n_res);
+        for (int r=0; r<n_res; r++) {
+            if ( fabs(probs[r]-all[r]) > 1e-12 )
+                pg_fatal("random_topk_prob_test:assert: rank %d prob=%f sorted=%f",r,probs[r],all[r]);
+            if ( fabs(slot_prob[slots[r]]-probs[r]) > 1e-12 )
+                pg_fatal("random_topk_prob_test:assert: rank %d payload mismatch",r);
+        }
+        if ( (h->n != n_res) || (bdd_prob_heap_sorted(h,slots,probs) != n_res) || (probs[0] != all[0]) )
+            pg_fatal("random_topk_prob_test:assert: heap emptied by sorting");
+        FREE(h);
+    }
+    FREE(dict);
+    pbuff_free(pb);
+}
+
+/*
+ * The read-once probability of an expression checked against the bdd. The
+ * first half are random expressions, mostly not read-once, the second half
+ * read-once expressions with single var factors like (x=1|x=2).
+ */
+#define RO_VARS 10
+
+static void read_once_expression(pbuff* pb, int* next_var, int depth) {
+    if ( *next_var == RO_VARS ) {
+        bprintf(pb,"%d",rand()%2);
+    } else if ( (depth == 0) || (rand()%4 == 0) ) {
+        char* var = genvar((*next_var)++);
+
+        if ( rand()%2 ) 
+            bprintf(pb,"%s%s=%d",rand_not(&RANDEXPR),var,rand_val(&RANDEXPR));
+        else
+            bprintf(pb,"(%s=%d|%s%s=%d)",var,rand_val(&RANDEXPR),rand_not(&RANDEXPR),var,rand_val(&RANDEXPR));
+    } else {
+        bprintf(pb,"%s(",rand_not(&RANDEXPR));
+        read_once_expression(pb,next_var,depth-1);
+        bprintf(pb,"%s",rand_and_or(&RANDEXPR));
+        read_once_expression(pb,next_var,depth-1);
+        bprintf(pb,")");
+    }
+}
+
+static void random_prob_expr_test(int n, long seed) {
+    pbuff pb_struct, *pb=pbuff_init(&pb_struct);
+    char  *_errmsg = NULL;
+    bdd_dictionary* dict;
+    int   n_read_once = 0;
+
+    dict = random_test_dictionary("random_prob_expr_test",RO_VARS,RANDEXPR.N_VALS,&(test_weights){5,1,9,30.0},NULL);
+    srand(seed);
+    for (int i=0; i<n; i++) {
+        bdd    *pbdd;
+        char   *expr;
+        double  P, p;
+        int     read_once, next_var = 0;
+
+        if ( i < n/2 )
+            expr = random_expression(&RANDEXPR,pb);
+        else {
+            pbuff_flush(pb,NULL);
+            read_once_expression(pb,&next_var,4);
+            expr = pb->buffer;
+        }
+        if ( !(pbdd = create_bdd(BDD_DEFAULT,expr,&_errmsg,0)) )
+            pg_fatal("random_prob_expr_test: error: %s",_errmsg);
+        if ( (P = bdd_probability(dict,pbdd,NULL,0,&_errmsg)) < 0.0 )
+            pg_fatal("random_prob_expr_test: error computing prob: %s",_errmsg);
+        _errmsg = NULL;
+        if ( (p = bdd_probability_expr(dict,expr,&read_once,&_errmsg)) < 0.0 )
+            pg_fatal("random_prob_expr_test: error: %s",_errmsg);
+        if ( _errmsg )
+            pg_fatal("random_prob_expr_test:assert: error message \"%s\" left after success",_errmsg);
+        if ( fabs(P-p) > 1e-9 )
+            pg_fatal("random_prob_expr_test:assert: P(%s)=%f read_once=%d expr=%f",expr,P,read_once,p);
+        if ( (i >= n/2) && !read_once )
+            pg_fatal("random_prob_expr_test:assert: %s not read-once",expr);
+        n_read_once += read_once;
+        FREE(pbdd);
+    }
+    if ( bdd_probability_expr(dict,"a=1&(b=2|",NULL,&_errmsg) >= 0.0 )
+        pg_fatal("random_prob_expr_test:assert: syntax error not detected");
+    if ( bdd_probability_expr(dict,"a=1&z=2",NULL,&_errmsg) >= 0.0 )
+        pg_fatal("random_prob_expr_test:assert: missing rva not detected");
+    if ( n_read_once == n/2 )
+        pg_fatal("random_prob_expr_test:assert: no random expression read-once");
+    FREE(dict);
+    pbuff_free(pb);
+}
+
+static void test_bind_probabilities() {
+    char  *_errmsg = NULL;
+    bdd_dictionary* dict;
+    bdd   *pbdd;
+
+    if ( !(dict = get_test_dictionary("a=1:0.4; a=2:0.6;",&_errmsg)) )
+        pg_fatal("test_bind_probabilities: error creating dictionary: %s",_errmsg);
+    if ( !(pbdd = create_bdd(BDD_DEFAULT,"(x=1&a=1)|y=2|(x=1&a=2)",&_errmsg,0)) )
+        pg_fatal("test_bind_probabilities: error: %s",_errmsg);
+    _errmsg = NULL;
+    if ( bdd_probability(dict,pbdd,NULL,0,&_errmsg) >= 0.0 )
+        pg_fatal("test_bind_probabilities:assert: missing rva's not detected");
+    if ( !_errmsg || !strstr(_errmsg,"'x=1'") || !strstr(_errmsg,"'y=2'") || strstr(_errmsg,"'a=") )
+        pg_fatal("test_bind_probabilities:assert: bad error message: %s",(_errmsg ? _errmsg : "NULL"));
+    FREE(pbdd);
+    {   // a garbage node with an rva missing in the dictionary is not bound
+        bdd_runtime rt_struct, *rt;
+        rva         z1 = {.var = "z", .val = 1}, a1 = {.var = "a", .val = 1};
+        double      P;
+
+        if ( !(rt = bdd_rt_init(&rt_struct,NULL,0,&_errmsg)) ||
+             (bdd_create_node(&rt->core,&RVA_0,NODEI_NONE,NODEI_NONE) != 0) ||
+             (bdd_create_node(&rt->core,&RVA_1,NODEI_NONE,NODEI_NONE) != 1) ||
+             (bdd_create_node(&rt->core,&z1,0,1) != 2) ||
+             (bdd_create_node(&rt->core,&a1,0,1) != 3) ||
+             !(pbdd = serialize_bdd(&rt->core)) )
+            pg_fatal("test_bind_probabilities: error creating garbage bdd");
+        bdd_rt_free(rt);
+        _errmsg = NULL;
+        if ( fabs((P = bdd_probability(dict,pbdd,NULL,0,&_errmsg))-0.4) > 1e-12 )
+            pg_fatal("test_bind_probabilities:assert: garbage node bound: P=%f %s",P,(_errmsg ? _errmsg : ""));
+        if ( fabs((P = bdd_probability_parallel(dict,pbdd,2,1,&_errmsg))-0.4) > 1e-12 )
+            pg_fatal("test_bind_probabilities:assert: garbage node bound in parallel: P=%f %s",P,(_errmsg ? _errmsg : ""));
+        FREE(pbdd);
+    }
+    FREE(dict);
+}
+
+static void random_decide_test(int n, long seed) {
+    pbuff pb_struct, *pb=pbuff_init(&pb_struct);
+    char  *_errmsg = NULL;
+
+    srand(seed);
+    for (int i=0; i<n; i++) {
+        bdd  *l, *r, *l_and_r, *l_or_r, *by_text, *not_l;
+
+        if ( !(l = create_bdd(BDD_DEFAULT,random_expression(&RANDEXPR,pb),&_errmsg,0)) )
+            pg_fatal("random_decide_test: error: %s",_errmsg);
+        if ( !(r = create_bdd(BDD_DEFAULT,random_expression(&RANDEXPR,pb),&_errmsg,0)) )
+            pg_fatal("random_decide_test: error: %s",_errmsg);
+        if ( !(l_and_r = bdd_operator('&',BY_APPLY,l,r,&_errmsg)) )
+            pg_fatal("random_decide_test: error: %s",_errmsg);
+        if ( !(l_or_r  = bdd_operator('|',BY_APPLY,l,r,&_errmsg)) )
+            pg_fatal("random_decide_test: error: %s",_errmsg);
+        if ( !(by_text = bdd_operator('|',BY_TEXT,r,l,&_errmsg)) )
+            pg_fatal("random_decide_test: error: %s",_errmsg);
+        if ( !(not_l   = bdd_operator('!',BY_APPLY,l,NULL,&_errmsg)) )
+            pg_fatal("random_decide_test: error: %s",_errmsg);
+        if ( bdd_equiv(l_or_r,by_text,&_errmsg) != 1 )
+            pg_fatal("random_decide_test:assert: apply and text result not equivalent");
+        if ( (bdd_implies(l_and_r,l,&_errmsg) != 1) || (bdd_implies(r,l_or_r,&_errmsg) != 1) )
+            pg_fatal("random_decide_test:assert: implication fails");
+        if ( bdd_disjoint(l,not_l,&_errmsg) != 1 )
+            pg_fatal("random_decide_test:assert: l and !l not disjoint");
+        if ( bdd_equiv(l,r,&_errmsg) != (bdd_implies(l,r,&_errmsg) && bdd_implies(r,l,&_errmsg)) )
+            pg_fatal("random_decide_test:assert: equiv differs from implies both ways");
+        if ( bdd_disjoint(l,r,&_errmsg) != bdd_implies(l_and_r,not_l,&_errmsg) )
+            pg_fatal("random_decide_test:assert: disjoint differs from l&r -> !l");
+        FREE(l); FREE(r); FREE(l_and_r); FREE(l_or_r); FREE(by_text); FREE(not_l);
+    }
+    pbuff_free(pb);
+}
+
 #define EQV_HUNT_LHS_SIZE 10000
 #define EQV_HUNT_RHS_SIZE 10000
 
@@ -782,10 +2244,10 @@ static int test_fast_equivalence() {
     if ( !(r_bdd = create_bdd(BDD_DEFAULT,r,&_errmsg,0)) )
         return 0;
 
-    eqv = bdd_fast_quivalence(l_bdd, r_bdd, &_errmsg);
+    eqv = bdd_fast_equiv(l_bdd, r_bdd, &_errmsg);
 
     if ( eqv < 0 )
-        pg_fatal("test_equivalence: error during bdd_fast_quivalence");
+        pg_fatal("test_equivalence: error during bdd_fast_equiv");
     else if ( eqv )
         fprintf(stdout, "TRUE\n");
     else
@@ -982,6 +2444,27 @@ void test_bdd() {
     if (1) test_regenerate(); // do these 3 tests always, catches many errors
     if (1) random_test(1000/*n*/, 888/*seed*/, 0/*verbose*/);
     if (1) test_trio();       
+    if (1) test_restrict_evidence();
+    if (1) test_compose();
+    if (1) random_apply_test(1000/*n*/, 777/*seed*/);
+    if (1) random_support_test(1000/*n*/, 555/*seed*/);
+    if (1) random_decide_test(1000/*n*/, 333/*seed*/);
+    if (1) random_probability_test(1000/*n*/, 222/*seed*/);
+    if (1) random_probability_vector_test(1000/*n*/, 111/*seed*/);
+    if (1) random_probability_parallel_test(200/*n*/, 888/*seed*/);
+    if (1) random_scenarios_test(1000/*n*/, 444/*seed*/);
+    if (1) random_gradient_test(200/*n*/, 666/*seed*/);
+    if (1) random_topk_test(300/*n*/, 999/*seed*/);
+    if (1) random_approx_test(200/*n*/, 123/*seed*/);
+    if (1) bitcount_test(10000/*n*/, 42/*seed*/);
+    if (1) random_sample_eval_test(200/*n*/, 369/*seed*/);
+    if (1) random_cond_test(1000/*n*/, 321/*seed*/);
+    if (1) random_count_test(100/*n*/, 654/*seed*/);
+    if (1) random_exceeds_test(1000/*n*/, 987/*seed*/);
+    if (1) random_topk_prob_test(10/*n*/, 246/*seed*/);
+    if (1) random_prob_expr_test(1000/*n*/, 135/*seed*/);
+    if (1) random_count_worlds_test(500/*n*/, 579/*seed*/);
+    if (1) test_bind_probabilities();
     if (0) test_nested_apply();       
     //
     if (0) random_equiv_hunt(999);
@@ -0,0 +1,163 @@
+/*
+ * This file is part of the Dubio distribution (https://github.com/utwente-db/DuBio).
+ * Copyright (c) 2020 Jan Flokstra & Maurice van Keulen
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "test_config.h"
+
+#include "ddnnf.c"
+
+#include <math.h>
+
+extern char *BDD_EXPR[]; // see test_bdd.c
+
+static bdd_dictionary* get_test_dictionary(char* dict_vars, char** _errmsg) {
+    bdd_dictionary dict_struct, *new_dict;
+
+    if ( ! (new_dict = bdd_dictionary_create(&dict_struct)) ) {
+        pg_error(_errmsg,"get_test_dictionary: error creating dictionary");
+        return NULL;
+    }
+    if ( ! modify_dictionary(new_dict,DICT_ADD,dict_vars,_errmsg))
+        return NULL;
+    return dictionary_prepare2store(new_dict);
+}
+
+/*
+ * Check the probability of the ddnnf of expr against the bdd, also of the
+ * ddnnf created from its text representation.
+ */
+static void check_ddnnf(bdd_dictionary* dict, char* expr) {
+    pbuff  pb_struct, *pb=pbuff_init(&pb_struct);
+    char   *_errmsg = NULL;
+    ddnnf  *dd, *dd_text;
+    bdd    *pbdd;
+    double P, p, p_text;
+
+    if ( !(dd = create_ddnnf(expr,&_errmsg)) )
+        pg_fatal("check_ddnnf: error: %s",_errmsg);
+    if ( !(pbdd = create_bdd(BDD_DEFAULT,expr,&_errmsg,0)) )
+        pg_fatal("check_ddnnf: error: %s",_errmsg);
+    if ( (P = bdd_probability(dict,pbdd,NULL,0,&_errmsg)) < 0.0 )
+        pg_fatal("check_ddnnf: error computing prob: %s",_errmsg);
+    if ( (p = ddnnf_probability(dict,dd,&_errmsg)) < 0.0 )
+        pg_fatal("check_ddnnf: error computing prob: %s",_errmsg);
+    if ( fabs(P-p) > 1e-9 )
+        pg_fatal("check_ddnnf:assert: P(%s) bdd=%f ddnnf=%f",expr,P,p);
+    ddnnf2string(pb,dd,0);
+    if ( !(dd_text = create_ddnnf(pb->buffer,&_errmsg)) )
+        pg_fatal("check_ddnnf: error: %s",_errmsg);
+    if ( (p_text = ddnnf_probability(dict,dd_text,&_errmsg)) < 0.0 )
+        pg_fatal("check_ddnnf: error computing prob: %s",_errmsg);
+    if ( fabs(P-p_text) > 1e-9 )
+        pg_fatal("check_ddnnf:assert: P(%s) bdd=%f ddnnf(%s)=%f",expr,P,pb->buffer,p_text);
+    FREE(dd_text);
+    FREE(dd);
+    FREE(pbdd);
+    pbuff_free(pb);
+}
+
+static void random_ddnnf_expression(pbuff* pb, int depth) {
+    if ( (depth == 0) || (rand()%3 == 0) ) {
+        bprintf(pb,"%s%c=%d",((rand()%4) ? "" : "!"),'a'+rand()%5,rand()%4);
+    } else {
+        char* op = (rand()%2) ? "&" : "|";
+        int   n  = 2 + rand()%3;
+
+        bprintf(pb,"%s(",((rand()%5) ? "" : "!"));
+        for(int i=0; i<n; i++) {
+            if ( i ) bprintf(pb,"%s",op);
+            random_ddnnf_expression(pb,depth-1);
+        }
+        bprintf(pb,")");
+    }
+}
+
+static void test_ddnnf_probability(int n, long seed) {
+    pbuff pb_struct, *pb=pbuff_init(&pb_struct);
+    char  *_errmsg = NULL;
+    bdd_dictionary* dict;
+
+    for(char v='a'; v<='z'; v++)
+        for(int i=0; i<=9; i++)
+            bprintf(pb,"%c=%d:%f;",v,i,(double)((i*5+v)%9+1)/(double)30.0);
+    if ( !(dict = get_test_dictionary(pb->buffer,&_errmsg)) )
+        pg_fatal("test_ddnnf_probability: error creating dictionary: %s",_errmsg);
+    for(int i=0; BDD_EXPR[i]; i++)
+        check_ddnnf(dict,BDD_EXPR[i]);
+    srand(seed);
+    for(int i=0; i<n; i++) {
+        pbuff_flush(pb,NULL);
+        random_ddnnf_expression(pb,3);
+        check_ddnnf(dict,pb->buffer);
+    }
+    _errmsg = NULL;
+    if ( create_ddnnf("a=1&(b=2|",&_errmsg) || !_errmsg )
+        pg_fatal("test_ddnnf_probability:assert: syntax error not detected");
+    FREE(dict);
+    pbuff_free(pb);
+}
+
+/*
+ * The bdd of (a0=1&b0=1)|..|(aN=1&bN=1) with order a0..aN,b0..bN is
+ * exponential, the ddnnf is linear.
+ */
+#define DDNNF_PAIRS 8
+
+static void test_ddnnf_size() {
+    pbuff pb_struct, *pb=pbuff_init(&pb_struct);
+    char  *_errmsg = NULL;
+    bdd_dictionary* dict;
+    ddnnf *dd;
+    bdd   *pbdd;
+    double P, p;
+
+    for(int i=0; i<DDNNF_PAIRS; i++)
+        bprintf(pb,"a%d=1:0.5;a%d=2:0.5;b%d=1:0.3;b%d=2:0.7;",i,i,i,i);
+    if ( !(dict = get_test_dictionary(pb->buffer,&_errmsg)) )
+        pg_fatal("test_ddnnf_size: error creating dictionary: %s",_errmsg);
+    pbuff_flush(pb,NULL);
+    for(int i=0; i<DDNNF_PAIRS; i++)
+        bprintf(pb,"%s(a%d=1&b%d=1)",(i ? "|" : ""),i,i);
+    if ( !(dd = create_ddnnf(pb->buffer,&_errmsg)) )
+        pg_fatal("test_ddnnf_size: error: %s",_errmsg);
+    if ( !(pbdd = create_bdd(BDD_DEFAULT,pb->buffer,&_errmsg,0)) )
+        pg_fatal("test_ddnnf_size: error: %s",_errmsg);
+    if ( DDNNF_TREESIZE(dd) > 6*DDNNF_PAIRS )
+        pg_fatal("test_ddnnf_size:assert: ddnnf has %d nodes",DDNNF_TREESIZE(dd));
+    if ( DDNNF_TREESIZE(dd) >= BDD_TREESIZE(pbdd) )
+        pg_fatal("test_ddnnf_size:assert: ddnnf %d nodes, bdd %d nodes",DDNNF_TREESIZE(dd),BDD_TREESIZE(pbdd));
+    if ( (P = bdd_probability(dict,pbdd,NULL,0,&_errmsg)) < 0.0 )
+        pg_fatal("test_ddnnf_size: error computing prob: %s",_errmsg);
+    if ( (p = ddnnf_probability(dict,dd,&_errmsg)) < 0.0 )
+        pg_fatal("test_ddnnf_size: error computing prob: %s",_errmsg);
+    if ( fabs(P-p) > 1e-9 )
+        pg_fatal("test_ddnnf_size:assert: bdd=%f ddnnf=%f",P,p);
+    FREE(dd);
+    FREE(pbdd);
+    if ( !(dd = create_ddnnf("a0=1&z=1",&_errmsg)) )
+        pg_fatal("test_ddnnf_size: error: %s",_errmsg);
+    _errmsg = NULL;
+    if ( (ddnnf_probability(dict,dd,&_errmsg) >= 0.0) || !_errmsg || !strstr(_errmsg,"'z=1'") )
+        pg_fatal("test_ddnnf_size:assert: missing rva not detected");
+    FREE(dd);
+    FREE(dict);
+    pbuff_free(pb);
+}
+
+void test_ddnnf() {
+    if (1) test_ddnnf_probability(1000/*n*/, 753/*seed*/);
+    if (1) test_ddnnf_size();
+}
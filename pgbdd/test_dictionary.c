@@ -190,10 +190,70 @@ static int test_bdd_dictionary_v3() {
     return 1;
 }
 
+static void check_dictionary_index(bdd_dictionary* d) {
+    bdd_dictionary* plain;
+    rva             rva;
+
+    if ( !get_dict_index(d) )
+        pg_fatal("check_dictionary_index: no index after prepare2store");
+    if ( !(plain = (bdd_dictionary*)MALLOC(d->bytesize)) )
+        pg_fatal("check_dictionary_index: malloc failed");
+    memcpy(plain,d,d->bytesize);
+    bdd_dictionary_relocate(plain);
+    invalidate_dict_index(plain);
+    if ( get_dict_index(plain) )
+        pg_fatal("check_dictionary_index: index not invalidated");
+    for(int i=0; i<26; i++) {
+        for(int v=-2; v<1200; v+=((v<64) ? 1 : 37)) {
+            sprintf(rva.var,"%c%d",'a'+i,i%3);
+            rva.val = v;
+            if ( lookup_probability(d,&rva) != lookup_probability(plain,&rva) )
+                pg_fatal("check_dictionary_index: %s=%d differs",rva.var,v);
+        }
+    }
+    strcpy(rva.var,"nosuchvar");
+    if ( lookup_probability(d,&rva) != -1.0 )
+        pg_fatal("check_dictionary_index: found nosuchvar");
+    FREE(plain);
+}
+
+static int test_bdd_dictionary_index() {
+    pbuff pbuff_struct, *pbuff=pbuff_init(&pbuff_struct);
+    bdd_dictionary dict_struct, *dict, *d, *old;
+    char* _errmsg = NULL;
+
+    if ( !(dict = bdd_dictionary_create(&dict_struct)) )
+        return 0;
+    for(int i=0; i<26; i++) {
+        // even vars dense values, odd vars sparse values
+        int card = 1 + (i*7)%40;
+        for(int j=0; j<card; j++)
+            bprintf(pbuff,"%c%d=%d:%f;",'a'+i,i%3,(i%2) ? j*j*j+1 : j,1.0/card);
+    }
+    if ( !modify_dictionary(dict,DICT_ADD,pbuff->buffer,&_errmsg) )
+        pg_fatal("test_bdd_dictionary_index: %s",_errmsg);
+    if ( !(d = dictionary_prepare2store(dict)) )
+        return 0;
+    check_dictionary_index(d);
+    if ( !modify_dictionary(d,DICT_DEL,"b1=2;c2=*;e1=3",&_errmsg) )
+        pg_fatal("test_bdd_dictionary_index: %s",_errmsg);
+    if ( get_dict_index(d) )
+        pg_fatal("test_bdd_dictionary_index: index valid after modify");
+    if ( !(d = dictionary_prepare2store(old = d)) )
+        return 0;
+    FREE(old);
+    check_dictionary_index(d);
+    bdd_dictionary_free(d);
+    FREE(d);
+    pbuff_free(pbuff);
+    return 1;
+}
+
 int test_dictionary() {
     if (1) test_bdd_dictionary_v0();
     if (0) test_bdd_dictionary_v1();
     if (0) test_bdd_dictionary_v2();
     if (0) test_bdd_dictionary_v3();
+    if (1) test_bdd_dictionary_index();
     return 1;
 }
@@ -24,6 +24,7 @@
 #include "utils.h"
 #include "dictionary.h"
 #include "bdd.h"
+#include "ddnnf.h"
 
 /*
  *
@@ -44,4 +45,5 @@ int main() {
     if (0) test_utils();
     if (0) test_dictionary();
     if (1) test_bdd(); /* INCOMPLETE, SHOULD BE SWITCHED ON AGAIN */
+    if (1) test_ddnnf();
 }
@@ -126,6 +126,54 @@ double bdd_atof(char* a) {
         return d;
 }
 
+void bdd_rng_seed(bdd_rng* rng, uint64_t seed) {
+    rng->state = seed;
+}
+
+uint64_t bdd_rng_next(bdd_rng* rng) {
+    uint64_t z = (rng->state += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+double bdd_rng_double(bdd_rng* rng) {
+    return (double)(bdd_rng_next(rng) >> 11) * (1.0 / 9007199254740992.0); // 2^-53
+}
+
+/*
+ * Bit counting on 64 bit masks, in Postgres with the (hardware accelerated
+ * when available) versions of port/pg_bitutils.h.
+ */
+
+int bdd_popcount64(uint64_t x) {
+#ifdef PG_CONFIG
+    return pg_popcount64(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (int)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+int bdd_rightmost_one64(uint64_t x) {
+#ifdef PG_CONFIG
+    return pg_rightmost_one_pos64(x);
+#else
+    int pos = 0;
+
+    for(int shift=32; shift>0; shift/=2) {
+        if ( !(x & (((uint64_t)1 << shift) - 1)) ) {
+            x   >>= shift;
+            pos  += shift;
+        }
+    }
+    return pos;
+#endif
+}
+
 static u_int16_t const str100p[100] = {
   0x3030,0x3130,0x3230,0x3330,0x3430,0x3530,0x3630,0x3730,0x3830,0x3930,
   0x3031,0x3131,0x3231,0x3331,0x3431,0x3531,0x3631,0x3731,0x3831,0x3931,
@@ -17,6 +17,8 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <stdint.h>
+
 /*
  * Debugging functions for use 'in' the posgres engine
  */
@@ -84,6 +86,22 @@ void   fast_itoa(char *buf, u_int32_t val);
 
 char* bdd_replace_str(char*,char*,char*,char);
 
+/*
+ * Small deterministic random generator (splitmix64) for sampling, the same
+ * seed gives the same sequence on every platform.
+ */
+
+typedef struct bdd_rng {
+    uint64_t state;
+} bdd_rng;
+
+void     bdd_rng_seed(bdd_rng*,uint64_t);
+uint64_t bdd_rng_next(bdd_rng*);
+double   bdd_rng_double(bdd_rng*); // uniform in [0,1)
+
+int bdd_popcount64(uint64_t);
+int bdd_rightmost_one64(uint64_t); // position of the lowest 1 bit, x != 0
+
 /* 
  * The fast boolean expression evaluator (BEE)
  */